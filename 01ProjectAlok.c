@@ -1,11 +1,66 @@
+// Build: gcc 01ProjectAlok.c -o 01ProjectAlok -pthread
+
 #include <stdio.h>    // For standard input/output functions (printf, scanf, fopen, etc.)
 #include <stdlib.h>   // For general utility functions (exit, system, etc.)
 #include <string.h>   // For string manipulation functions (strcpy, strcmp, strlen, etc.)
 #include <ctype.h>    // For character type functions (isdigit, tolower, toupper, etc.)
+#include <stddef.h>   // For offsetof
+#include <limits.h>   // For UINT_MAX (student IDs)
+#include <time.h>     // For clock_gettime (benchmarks)
+#include <pthread.h>  // For worker threads (bulk import)
+#include <math.h>     // For INFINITY (fee policy tiers)
+#include <unistd.h>   // For fsync, ftruncate, access
+#include <fcntl.h>    // For open flags
+#include <sys/mman.h> // For mmap/msync (binary storage)
+#include <sys/stat.h> // For fstat, mkdir
+#include <sys/resource.h> // For getrusage (benchmark peak memory)
+#include <sys/socket.h> // For the server socket
+#include <sys/un.h>     // For sockaddr_un
+#include <signal.h>     // For stopping the server on SIGINT/SIGTERM
+#include <errno.h>      // For EINTR
 
 // Constants for file names
 #define FILENAME "students.txt"
 #define TEMP_FILENAME "temp_students.txt"
+#define LOG_FILENAME "students.log"       // Append-only log of modifications and deletions not yet merged into FILENAME
+#define BIN_FILENAME "students.bin"       // Binary storage; when present it is used instead of FILENAME
+#define TEMP_BIN_FILENAME "temp_students.bin"
+#define FEE_POLICY_FILENAME "fee_policy.cfg"  // Optional fee policy; built-in defaults are used without it
+#define AGG_FILENAME "students.agg"       // Saved fee and enrollment totals (a cache; rebuilt when out of date)
+#define TEMP_AGG_FILENAME "temp_students.agg"
+#define SNAPSHOT_FILENAME "students.snap"  // Saved store and indexes of the text storage, for a fast load (a cache)
+#define TEMP_SNAPSHOT_FILENAME "temp_students.snap"
+#define METRICS_FILENAME "students.metrics" // Operation metrics, machine-readable (written when metrics are enabled)
+#define TEMP_METRICS_FILENAME "temp_students.metrics"
+
+// Change log compaction: the log is merged into the data file once it grows past
+// LOG_COMPACT_MIN_BYTES and past 1/LOG_COMPACT_RATIO of the data file size
+#define LOG_COMPACT_MIN_BYTES (64L * 1024)
+#define LOG_COMPACT_RATIO 4
+
+// Group commit: appends to the data file and change log go through a journal that keeps both files open
+// and syncs them at most once per COMMIT_WINDOW_MS, or as soon as COMMIT_MAX_RECORDS appends are pending
+#define COMMIT_WINDOW_MS 10                       // 0 syncs after every append
+#define COMMIT_MAX_RECORDS 256
+#define COMMIT_WINDOW_ENV "STUDENT_COMMIT_WINDOW_MS"  // Environment overrides of the two limits
+#define COMMIT_RECORDS_ENV "STUDENT_COMMIT_RECORDS"
+#define JOURNAL_BUFFER (1 << 16)                  // stdio buffer of each journal file
+
+// Binary storage format
+#define BIN_MAGIC "STUDBIN"     // File signature (8 bytes including the terminating NUL)
+#define BIN_SCHEMA_VERSION 3    // Bumped whenever BinaryHeader, BinaryDictionary or BinarySlot changes
+#define BIN_SLOT_LIVE 1u        // BinarySlot.flags bit: the slot holds a record (clear = deleted)
+#define BIN_GROW_SLOTS 1024     // Minimum number of slots added when the file grows
+#define BIN_SLOTS_OFFSET (sizeof(BinaryHeader) + sizeof(BinaryDictionary)) // Slot 0 follows the dictionaries
+#define BIN_DICT_ENTRIES 1024   // Courses (and domiciles) the tables of a binary file can hold
+
+// Index snapshot: written at exit once the data file has at least SNAPSHOT_MIN_BYTES and more than
+// 1/SNAPSHOT_STALE_RATIO of it (data file and change log bytes) would have to be replayed on top of the last one
+#define SNAPSHOT_MAGIC "STUDSNP"     // File signature (8 bytes including the terminating NUL)
+#define SNAPSHOT_VERSION 2           // Bumped whenever SnapshotHeader or the layout after it changes
+#define SNAPSHOT_MIN_BYTES (1L << 20)
+#define SNAPSHOT_STALE_RATIO 8
+#define SNAPSHOT_CHECK_BYTES (64L << 10) // Bytes hashed at each end of the data file to recognize it (a partial check)
 
 // Constants for admin credentials (Hardcoded for simplicity in this example)
 #define USERNAME "a"
@@ -20,7 +75,77 @@
 #define DOMICILE_LEN 30
 #define COURSE_LEN 50
 #define DOB_LEN 20          // Max length for Date of Birth string (e.g., "DD/MM/YYYY")
+#define DOB_MIN_YEAR 1900   // Earliest year of birth accepted at registration
 #define MAX_LINE_LEN 512    // Buffer size for reading lines from the student data file
+#define STUDENT_TEXT_FIELDS 8   // Name .. DOB
+#define STUDENT_FEE_FIELDS 4    // TotalFee .. FinalFee
+#define BENCH_PARSE_DEFAULT_ROWS 1000000 // Rows parsed by --bench-parse when no count is given
+#define BENCH_DIR "bench_data"          // Working directory of --bench-ops (its synthetic rosters live there)
+#define BENCH_QUERIES 200               // Searches timed per search kind and roster size
+#define BENCH_WRITES 200                // Modifies and deletes timed per roster size
+#define BENCH_DISPLAY_REPS 3            // Full listings timed per roster size
+
+// Fee policy limits
+#define POLICY_MAX_ENTRIES 32     // Courses (or domiciles) a policy can list
+#define POLICY_MAX_SLOTS 2048     // Largest perfect hash table (power of two >= 2 * entries^2)
+#define POLICY_MAX_TIERS 8        // Percentage discount tiers
+
+// Bulk CSV import
+#define IMPORT_REJECTS_FILENAME "import_rejects.txt" // Every rejected CSV row, with the reason
+#define IMPORT_BATCH_ROWS 8192        // CSV rows read, validated and written per batch
+#define IMPORT_MIN_ROWS_PER_THREAD 512 // Smaller batches are not worth splitting across threads
+#define IMPORT_WRITE_BUFFER (1 << 20) // stdio buffer for writing the data file in one pass
+#define IMPORT_SHOWN_REJECTS 20       // Rejected rows listed on screen (all go to IMPORT_REJECTS_FILENAME)
+#define MAX_WORKERS 32                // Upper bound on worker threads
+#define WORKERS_ENV "STUDENT_WORKERS" // Environment variable overriding the worker count (e.g. to measure scaling)
+#define LOAD_BLOCK_BYTES (4 << 20)    // The data file is loaded in blocks of whole lines of about this size
+#define LOAD_MIN_BYTES_PER_THREAD (64 << 10) // Smaller shares of a block are not worth a thread
+#define SCAN_MIN_ROWS_PER_THREAD 16384       // Same for the records checked by a full-scan search
+
+// Batch mode
+#define BATCH_MAX_ARGS 16             // Command name plus arguments on one batch line
+#define BATCH_OUTPUT_BUFFER (1 << 16) // stdio buffer for batch answers
+
+// Operation metrics
+#define METRICS_ENV "STUDENT_METRICS" // Set (to anything but 0) to enable the metrics (see Metrics)
+#define METRICS_BUCKETS 32            // Latency histogram buckets: bucket b counts 2^b to 2^(b+1) microseconds
+
+// Server mode
+#define SERVER_SOCKET "students.sock" // Default Unix domain socket of --serve and --client
+#define SERVER_BACKLOG 64             // Connections waiting to be accepted
+
+// Display
+#define DISPLAY_PAGE_ROWS 25           // Default rows per page of the student listing
+#define DISPLAY_BUFFER_SIZE (1 << 16)  // The listing is written to the terminal in chunks of up to this size
+
+// CSV and JSON export
+#define EXPORT_BUFFER_SIZE (1 << 20)   // Exported rows are rendered here and written out in blocks of this size
+#define EXPORT_ROW_BYTES 4096          // Room one rendered row may need (every character escaped as \u00XX)
+
+// Sizing for the in-memory student store
+#define STORE_INITIAL_CAPACITY 1024 // Initial number of record slots (grows by doubling)
+#define INDEX_INITIAL_BUCKETS 1024  // Initial bucket count for hash indexes (always a power of two)
+#define NGRAM_INITIAL_SLOTS 4096    // Initial slot count of the trigram table (always a power of two)
+#define NGRAM_LEN 3                 // Substring search terms shorter than this fall back to a scan
+#define QUERY_MAX_PREDICATES 8      // Predicates in one compound query
+#define AGG_MAX_GROUPS 64           // Courses (and domiciles) with their own totals; the rest share "(other)"
+#define AGG_SIGNATURE_LEN 256       // Buffer for the storage signature that tags AGG_FILENAME
+#define BLOOM_BITS_PER_KEY 10       // Bloom filter size: about 1% false positives with BLOOM_PROBES probes
+#define BLOOM_PROBES 7
+#define BLOOM_BLOCK_BITS 512        // The probes of a key stay in one block of this many bits (one cache line)
+#define FUZZY_MAX_DISTANCE 3        // Names further than this many edits from the one typed are not suggested
+#define FUZZY_CANDIDATES 5          // Closest names offered when no student has the name typed
+#define AGE_BUCKET_YEARS 1          // Years per bucket of an age histogram, unless asked otherwise
+#define AGE_MAX_YEARS 150           // Age histograms stop here; older dates of birth count as unusable
+#define DICT_MAX_ENTRIES 65535      // Distinct courses (and domiciles) a value dictionary can hold: codes are 16-bit
+#define DICT_CHUNK_ENTRIES 1024     // Dictionary values are allocated this many at a time, as they are needed
+#define DICT_CODE_BYTES ((DICT_MAX_ENTRIES + 7) / 8) // Bitmap with a bit per code
+#define DICT_VALUE_LEN COURSE_LEN   // Room for the longest value of a dictionary-encoded field
+#define DICT_SLOTS (1 << 17)        // Hash slots of a dictionary (a power of two; at most half used)
+#define STORE_TEXT_FIELDS 6         // Text fields packed into the record arena: name, mother, father, mobile, percent, dob
+#define ARENA_BLOCK_BITS 24         // Arena blocks are 2^ARENA_BLOCK_BITS bytes (16 MB); a reference is block << bits | offset
+#define ARENA_BLOCK_BYTES (1u << ARENA_BLOCK_BITS)
+#define ARENA_MAX_BLOCKS 256        // 32-bit references: up to 4 GB of record text
 
 // Structure to hold student form data
 typedef struct {
@@ -29,8 +154,8 @@ typedef struct {
     char father[FATHER_LEN];
     char mobile[MOBILE_LEN];
     char percent[PERCENT_LEN]; // Store as string for easier input and initial validation
-    char domicile[DOMICILE_LEN];
-    char course[COURSE_LEN];
+    unsigned short domicileCode; // Code of the domicile in domicileDict
+    unsigned short courseCode;   // Code of the course in courseDict
     char dob[DOB_LEN];
     float totalFee, discount, domicileDiscount, finalFee;  
     /*    
@@ -39,8 +164,323 @@ typedef struct {
     float domicileDiscount; // Calculated discount based on domicile
     float finalFee;         // Final fee after all discounts
     */     
+    unsigned int id;        // Student ID, given out once at registration (see In-memory student store); 0 = none yet
 } StudentForm;
 
+// Field numbers: positions of the fields in a student line (and in the studentFields table)
+enum {
+    FIELD_NAME, FIELD_MOTHER, FIELD_FATHER, FIELD_MOBILE, FIELD_PERCENT, FIELD_DOMICILE, FIELD_COURSE, FIELD_DOB,
+    FIELD_TOTAL_FEE, FIELD_DISCOUNT, FIELD_DOMICILE_DISCOUNT, FIELD_FINAL_FEE,
+    FIELD_ID  // Optional last field of a line (not in studentFields: it is not text and never a search key)
+};
+
+// A student record as the store holds it (40 bytes instead of sizeof(StudentForm)). The text fields are
+// stored back to back, each NUL-terminated, in the record arena; the record keeps where they start.
+typedef struct {
+    unsigned int text;                        // Arena reference of the text fields (see arenaText)
+    unsigned char start[STORE_TEXT_FIELDS];   // Offset of each text field in the text (order of packedFields)
+    unsigned short domicileCode, courseCode;  // As in StudentForm
+    unsigned short textBytes;                 // Length of the text, terminators included
+    float totalFee, discount, domicileDiscount, finalFee;
+    unsigned int id;                          // Student ID (kept when the record is deleted)
+    unsigned int dob;                         // Date of birth as a packed date (see packDate); 0 if the text is not a date
+} PackedStudent;
+
+// Bump allocator for the text of the store's records: large blocks filled front to back and freed all
+// at once. Text replaced or deleted is only counted as wasted, until the arena is compacted.
+typedef struct {
+    char* blocks[ARENA_MAX_BLOCKS];
+    int blockCount;
+    unsigned int used;      // Bytes used in the last block
+    long long bytes;        // Bytes handed out in all blocks
+    long long wasted;       // Bytes of them no live record refers to any more
+} RecordArena;
+
+// Dictionary of the distinct values of a low-cardinality text field (course, domicile). Each value is
+// stored once and records hold its code, so comparing or grouping records by the field compares integers.
+// Codes are given out in order of first use and never change while the program runs. Values match
+// exactly, as typed, so "BCA" and "bca" get different codes (and are listed and exported as typed);
+// searches and the fee policy compare them ignoring case. Lookups take no lock (load and import workers
+// intern values in parallel); adding a value takes 'lock'. Values are kept in chunks that never move,
+// allocated as codes are given out.
+typedef struct {
+    char (*chunks[(DICT_MAX_ENTRIES + DICT_CHUNK_ENTRIES - 1) / DICT_CHUNK_ENTRIES])[DICT_VALUE_LEN]; // Code -> value
+    int count;                                     // Codes given out
+    unsigned short slots[DICT_SLOTS];              // Open-addressing hash table of code + 1 (0 = empty slot)
+    pthread_mutex_t lock;                          // Serializes additions
+} ValueDict;
+
+// Chained hash index over store records.
+// Chains are linked through record indices, so the index holds no pointers and no per-entry allocations.
+typedef struct {
+    int *heads;          // Bucket -> first record index in the chain (-1 if empty)
+    int *next;           // Record index -> next record index in the same chain (-1 at the end)
+    unsigned int mask;   // Bucket count - 1 (bucket count is a power of two)
+} HashIndex;
+
+// A line of the data file that could not be parsed. Kept verbatim so compaction does not lose it.
+typedef struct {
+    int slot;    // Line number (0-based) of the line in the data file
+    char *text;  // Line contents without the trailing newline
+} RawLine;
+
+// Sorted list of record indices (one per trigram).
+typedef struct {
+    int *ids;
+    int count, capacity;
+} PostingList;
+
+// Inverted index from (field, lowercase trigram) to the records containing it, for substring search.
+// Open-addressing table of keys; each key owns a posting list.
+typedef struct {
+    unsigned int *keys;  // field << 24 | trigram bytes (0 = empty slot; trigrams never contain NUL)
+    PostingList *lists;  // Posting list of each slot
+    unsigned int mask;   // Slot count - 1 (slot count is a power of two)
+    int used;            // Occupied slots
+    int complete;        // 0 if an insert ever failed (searches then scan instead)
+    int stale;           // Records modified or deleted since the lists were built (their old entries remain)
+} TrigramIndex;
+
+// Head count and fee totals of a group of records (all of them, one course or one domicile).
+// Fees are kept in paise so that adding and subtracting records never accumulates rounding errors.
+typedef struct {
+    char name[COURSE_LEN];      // Course or domicile as first seen
+    unsigned int hash;          // hashString(name, 1)
+    long count;
+    long long totalFee, discount, domicileDiscount, finalFee;
+} AggregateGroup;
+
+// Running totals over the live records, kept up to date by every change to the store.
+typedef struct {
+    AggregateGroup all;
+    AggregateGroup courses[AGG_MAX_GROUPS];
+    int courseCount;
+    AggregateGroup domiciles[AGG_MAX_GROUPS];
+    int domicileCount;
+    unsigned char courseGroup[DICT_MAX_ENTRIES];   // Course code -> index in courses + 1 (0: not looked up yet)
+    unsigned char domicileGroup[DICT_MAX_ENTRIES]; // Same for domicile codes
+    int dirty;                  // 1 if they differ from what AGG_FILENAME holds
+} Aggregates;
+
+// Sort keys of the sorted views and top-K listings (order matches sortKeyNames).
+enum { SORT_PERCENT, SORT_FINAL_FEE, SORT_NAME, SORT_DOB, SORT_KEYS };
+
+// Live records in the order of a sort key, kept so repeated sorted listings do not sort the roster again.
+// Records added, modified or deleted afterwards are queued and merged in when the view is next used.
+typedef struct {
+    int *order;                 // Live record indices in the key's order (NULL: not built)
+    int count;                  // Entries in order
+    int *pending;               // Records changed since the order was last brought up to date (may repeat)
+    int pendingCount, pendingCapacity;
+} SortedView;
+
+// Bloom filter over 32-bit key hashes: answers "definitely absent" or "maybe present".
+// Keys cannot be removed; the filter is rebuilt (twice as large) once more keys were added than it was sized for.
+typedef struct {
+    unsigned long long *bits;
+    unsigned int mask;   // Bit count - 1 (bit count is a power of two)
+    long keys;           // Keys added since the last rebuild
+    long capacity;       // Keys the filter was sized for
+} BloomFilter;
+
+// Node of the BK-tree of names (see Fuzzy name lookup): one 64-byte cache line, name included.
+typedef struct {
+    char name[NAME_LEN + 2];    // Case-folded
+    unsigned char distance;     // Edit distance to the parent
+    unsigned char length;       // strlen(name)
+    int child;                  // First child, or -1
+    int sibling;                // Next child of the same parent (children in order of distance), or -1
+} NameNode;
+
+// BK-tree of the distinct case-folded names of the records; node 0 is the root.
+typedef struct {
+    NameNode* nodes;            // Cache-line aligned
+    int count, capacity;
+} NameTree;
+
+// A name offered by a fuzzy lookup.
+typedef struct {
+    char name[NAME_LEN];    // Case-folded
+    int distance;           // Edits from the name looked up
+    int students;           // Live records with this name
+} NameMatch;
+
+// In-memory table of all student records, loaded once from the data file and kept in sync on every write.
+// Record index == line number in the data file ("slot"), which is also how the change log refers to records.
+// Deleted and unparsable lines keep their slot (alive = 0) so slots stay stable until the next load. A compaction
+// leaves the records where they are and notes the line each one moved to in 'lines' instead.
+typedef struct {
+    PackedStudent *records; // Records in file order (their text lives in 'arena')
+    RecordArena arena;      // Text fields of the records
+    unsigned char *alive;   // 1 if the slot holds a live record, 0 if it was deleted
+    int count;              // Number of slots in use (live + deleted)
+    int capacity;           // Number of slots allocated
+    int liveCount;          // Number of live records
+    HashIndex byMobile;     // Exact mobile number -> records
+    HashIndex byName;       // Case-folded full name -> records
+    HashIndex byId;         // Student ID -> record (unnumbered records are filed under 0 until storeNumberRecords)
+    unsigned int nextId;    // ID the next registration gets: above every ID ever given out
+    int unnumbered;         // Live records loaded without an ID (or with one already taken)
+    TrigramIndex ngrams;    // Trigrams of name, mother and father -> records
+    BloomFilter applicants; // Duplicate-check keys (mobile; name + date of birth) of the records
+    Aggregates totals;      // Head counts and fee totals of the live records
+    SortedView sorted[SORT_KEYS]; // Record orders for sorted listings, built on first use
+    NameTree names;         // Names for fuzzy lookup, built on first use
+    RawLine *rawLines;      // Unparsable lines of the data file
+    int rawCount, rawCapacity;
+    int *lines;             // Line of each record in the data file (-1: not in it); NULL while equal to the index
+    int lineCount;          // Lines in the data file, while 'lines' is in use
+    long baseBytes;         // Size of the data file
+    unsigned int baseHash;  // Hash of the data file contents (identifies which data file the change log belongs to)
+    long logBytes;          // Size of the change log
+    long snapshotData;      // Data file bytes the saved index snapshot covers (0: none)
+    long snapshotLog;       // Change log bytes it covers
+    int loaded;             // 1 once the data file has been loaded
+} StudentStore;
+
+// Case-insensitive name -> value table with a collision-free ("perfect") hash.
+// The seed and size are chosen when the table is built so that every name gets its own slot;
+// a lookup is then one hash, one slot read and one comparison.
+typedef struct {
+    char names[POLICY_MAX_ENTRIES][COURSE_LEN]; // As written in the policy (used for display)
+    float values[POLICY_MAX_ENTRIES];
+    int count;
+    short slots[POLICY_MAX_SLOTS];              // Slot -> entry (-1 if empty)
+    unsigned int mask;                          // Slot count - 1
+    unsigned int seed;                          // Hash seed that makes the table collision-free
+} PolicyTable;
+
+// Fees and discounts applied at registration (see FEE_POLICY_FILENAME).
+typedef struct {
+    PolicyTable courses;                       // Course -> total course fee (Rs)
+    PolicyTable domiciles;                     // Domicile -> discount (%)
+    float tierAbove[POLICY_MAX_TIERS];         // Ascending percentage thresholds (unused ones are +infinity)
+    float tierDiscount[POLICY_MAX_TIERS + 1];  // Discount (%) when the percentage is above exactly i thresholds
+    int tierCount;
+} FeePolicy;
+
+// Header at the start of the binary storage file (64 bytes).
+typedef struct {
+    char magic[8];              // BIN_MAGIC
+    unsigned int version;       // BIN_SCHEMA_VERSION
+    unsigned int headerSize;    // sizeof(BinaryHeader)
+    unsigned int slotSize;      // sizeof(BinarySlot)
+    unsigned int recordCount;   // Slots in use (live + deleted); the file may hold spare slots beyond these
+    unsigned int dictCount[2];  // Entries in use in BinaryDictionary: courses, domiciles
+    unsigned int nextId;        // Student ID the next registration gets (IDs of deleted slots are not given out again)
+    unsigned int reserved[7];   // Zero; room for future fields
+} BinaryHeader;
+
+// Course and domicile values of the binary storage file, right after the header. The course and domicile
+// codes in the slots index these tables, which are the file's own: codes are translated to and from
+// those of the in-memory dictionaries as records are written and loaded.
+typedef struct {
+    char values[2][BIN_DICT_ENTRIES][DICT_VALUE_LEN]; // [0]: courses, [1]: domiciles
+} BinaryDictionary;
+
+// One fixed-size record slot of the binary storage file. Slot i holds record index i.
+typedef struct {
+    unsigned int flags;         // BIN_SLOT_LIVE if the slot holds a record
+    StudentForm s;
+} BinarySlot;
+
+// Record layout of schema version 1 (course and domicile stored as text), read only to migrate old files.
+typedef struct {
+    char name[NAME_LEN];
+    char mother[MOTHER_LEN];
+    char father[FATHER_LEN];
+    char mobile[MOBILE_LEN];
+    char percent[PERCENT_LEN];
+    char domicile[DOMICILE_LEN];
+    char course[COURSE_LEN];
+    char dob[DOB_LEN];
+    float totalFee, discount, domicileDiscount, finalFee;
+} StudentFormV1;
+
+typedef struct {
+    unsigned int flags;
+    StudentFormV1 s;
+} BinarySlotV1;
+
+// Size of a slot of schema version 2: the flags and a StudentForm without its trailing student ID.
+#define BIN_SLOT_V2_SIZE (sizeof(unsigned int) + offsetof(StudentForm, id))
+
+// Header of the index snapshot file (see Index snapshot). The store's arrays follow it, in the order
+// saveSnapshot writes them.
+typedef struct {
+    char magic[8];                // SNAPSHOT_MAGIC
+    unsigned int version;         // SNAPSHOT_VERSION
+    unsigned int recordSize;      // sizeof(PackedStudent)
+    long long dataBytes;          // Size of the data file it was taken of (lines appended later are replayed)
+    long long dataMtime;          // Modification time of the data file then (ns)
+    unsigned long long dataInode; // A rewritten data file (compaction, conversion) is a new file
+    unsigned int dataHash;        // Hash of the whole data file (store.baseHash)
+    unsigned int dataCheck;       // Partial checksum: hash of its first and last SNAPSHOT_CHECK_BYTES only (see dataFileCheck)
+    long long logBytes;           // Change log bytes applied (0: there was no change log)
+    long long logBaseBytes;       // Header of that change log
+    unsigned int logBaseHash;
+    int count, liveCount, unnumbered, rawCount;
+    unsigned int nextId;
+    unsigned int indexMask[3];    // Of byMobile, byName and byId
+    unsigned int ngramMask;
+    int ngramUsed, ngramComplete;
+    int arenaBlocks;
+    unsigned int arenaUsed;
+    long long arenaBytes, arenaWasted;
+    int dictCount[2];             // Courses, domiciles
+    int sortedCount[SORT_KEYS];   // Entries of each sorted view (-1: not built)
+} SnapshotHeader;
+
+// Comparison operators of query predicates (order matches queryOpText) and ways of finding the candidates.
+enum { QUERY_CONTAINS, QUERY_EQ, QUERY_LT, QUERY_LE, QUERY_GT, QUERY_GE };
+enum { QUERY_SCAN, QUERY_NAME_INDEX, QUERY_MOBILE_INDEX, QUERY_TRIGRAM_INDEX, QUERY_DOB_INDEX };
+
+// One "<field> <op> <value>" condition of a compound query.
+typedef struct {
+    int field;              // FIELD_*
+    int op;                 // QUERY_CONTAINS .. QUERY_GE
+    char text[NAME_LEN];    // Value, lowercase
+    float number;           // Value of a numeric comparison
+    long estimate;          // Records this predicate's index would produce (liveCount if it has none)
+    unsigned char codes[DICT_CODE_BYTES];      // Course or domicile: bitmap of the matching codes (set by planQuery)
+    int codeCount;                             // Codes set in 'codes'
+} QueryPredicate;
+
+// A parsed compound query (predicates joined by "and") and its plan.
+typedef struct {
+    QueryPredicate preds[QUERY_MAX_PREDICATES];
+    int count;
+    int driver;                        // Predicate whose index produces the candidates (-1: scan every record)
+    int access;                        // QUERY_SCAN .. QUERY_DOB_INDEX
+    long estimate;                     // Candidates expected from the driver
+    unsigned int dobFrom, dobTo;       // Dates of birth all the dob comparisons allow (packed, inclusive)
+    int checks[QUERY_MAX_PREDICATES];  // Predicates checked on each candidate, cheapest first
+    int checkCount;
+    int candidates;                    // Candidates actually examined (set by runQuery)
+} Query;
+
+// Operations timed by the metrics (order matches metricsOpNames) and the quantities counted for each.
+enum {
+    OP_REGISTER, OP_DISPLAY, OP_SEARCH, OP_MODIFY, OP_DELETE, OP_QUERY, OP_SORTED, OP_STATS, OP_EXPORT,
+    OP_LOAD, OP_IMPORT, OP_REWRITE, OP_SYNC, OP_OTHER, OP_COUNT
+};
+enum { METRIC_READ, METRIC_WRITTEN, METRIC_ROWS, METRIC_OPENS, METRIC_RENAMES, METRIC_SYNCS, METRIC_COUNTERS };
+
+// Metrics of one kind of operation. Updated with atomic adds, so server threads can share them.
+typedef struct {
+    long long count;                     // Operations completed
+    long long totalNs, maxNs;            // Latency
+    long long buckets[METRICS_BUCKETS];  // Latency histogram (bucket 0 also counts anything under a microsecond)
+    long long counters[METRIC_COUNTERS]; // Bytes read and written, rows parsed, fopen, rename and sync calls
+} OpMetrics;
+
+// An operation being timed (see metricsBegin).
+typedef struct {
+    int op;        // OP_*, or -1 when the metrics are disabled
+    int previous;  // Operation of the calling thread before this one (operations can nest)
+    long long startNs;
+} MetricsSpan;
+
 // Function Prototypes
 void mainMenu();
 void login();
@@ -51,13 +491,78 @@ void searchStudent();
 void modifyStudent();
 void deleteStudent();
 
-float getTotalFee(char course[]);
+float getTotalFee(const char course[]);
 float getPercentDiscount(float percent);
-float getDomicileDiscount(char dom[]);
+float getDomicileDiscount(const char dom[]);
+void computeFees(StudentForm* s, float percent);
+int loadFeePolicy();
+const char* courseListText();
+int repriceRoster();
+void feePolicyMenu();
 
 int isValidMobile(const char* mobile);
 int isValidPercentage(const char* percentStr, float* percentage); // Validates and converts percentage string
+int isValidDob(char* dob); // Validates a date of birth and rewrites it as DD/MM/YYYY
+const char* validateStudent(StudentForm* s); // Registration rules and fees for a filled-in form
 int parseStudentLine(const char* line, StudentForm* s); // Helper to parse a line from the student file
+int parseStudentFields(const char* line, size_t len, StudentForm* s); // Same, reporting which field was malformed
+const char* studentFieldName(int field);
+int formatStudentLine(char* buf, size_t size, const StudentForm* s); // Helper to format a record as one line of the student file
+void writeStudentLine(FILE* fp, const StudentForm* s);
+void printStudentTableHeader();
+void printStudentRow(const StudentForm* s);
+int formatStudentRow(char* buf, size_t size, const StudentForm* s);
+
+int loadStudentStore();
+void freeStudentStore();
+void closeStudentStore();
+int storeAdd(const StudentForm* s);
+const StudentForm* storeRecord(int idx, StudentForm* s);
+static void aggregateRecord(const PackedStudent* p, int sign);
+static int readAggregatesFile(Aggregates* agg);
+static long dobNumber(const char* dob);
+static int storeInit();
+int storeUpdate(int idx, const StudentForm* s);
+void storeRemove(int idx);
+int storeFindContaining(int field, const char* lowerTerm, int** out);
+long storeEstimateContaining(int field, const char* lowerTerm);
+int storeNextByName(const char* name, int prev);
+int storeNextByMobile(const char* mobile, int prev);
+int storeFindById(unsigned int id);
+int storeFindDuplicate(const StudentForm* s, int* field);
+int storeSimilarNames(const char* name, NameMatch* out, int max);
+int storeFindBorn(unsigned int from, unsigned int to, int** out);
+int storeAgeHistogram(unsigned int on, int width, long* counts, int maxBuckets);
+const char* duplicateApplicant(const StudentForm* s);
+int storeNextLive(int slot);
+int storeSkipLive(int count);
+int journalSync();
+void journalClose();
+int storageInsert(StudentForm* s);
+int storageUpdate(int idx, const StudentForm* s);
+int storageDelete(int idx);
+int storageInsertMany(StudentForm* rows, int n);
+int storageRewriteAll();
+void storageMaintain();
+int compactStudentData();
+int convertToBinaryStorage();
+int exportToTextFile();
+int convertToTextStorage();
+void storageMenu();
+const Aggregates* currentAggregates();
+void aggregatesReport();
+const char* parseQuery(const char* text, Query* q);
+void planQuery(Query* q);
+int runQuery(Query* q, int** out);
+void explainQuery(FILE* out, const char* prefix, const Query* q);
+void queryStudents();
+long exportStudents(FILE* fp, int format, const int* ids, int count);
+void exportMenu();
+int workerCount();
+void runWorkers(int workers, void (*fn)(void* ctx, int worker, int workers), void* ctx);
+int filterRecords(int* ids, int count, int (*keep)(const void* ctx, int idx), const void* ctx);
+void importStudentsCSV(const char* path);
+void bulkImportMenu();
 
 void clearInputBuffer();
 void gotoxy(int row, int col);
@@ -65,8 +570,60 @@ void clearScreen();
 void clearLine(int row, int startCol, int length);
 void str_to_lower(char* str);
 
+int runBatchCommand(FILE* out, int argc, char** argv);
+int runCommand(int argc, char** argv);
+long runBatch(const char* path);
+int serveStudents(const char* path);
+long runClient(const char* path);
+
+void metricsInit();
+void metricsReport(FILE* out);
+int saveMetrics();
+void metricsMenu();
+
+void benchParse(long rows);
+void benchOperations(const long* sizes, int sizeCount);
+
 // Main function - entry point of the program
-int main() {
+// "--bench-parse [rows]" runs the student line parser micro-benchmark instead of the menus.
+// "--bench-ops [rows...]" times the admin operations on synthetic rosters (10k, 100k and 1M rows by default).
+// "--batch [file]" and "--run <command> [args...]" run commands without the menus (see Batch mode);
+// the exit status is 0 only if every command succeeded.
+// "--serve [socket]" serves the roster to many clients at once; "--client [socket]" is such a client (see Server mode).
+int main(int argc, char* argv[]) {
+    metricsInit();            // Operation metrics, if METRICS_ENV enables them
+    atexit(closeStudentStore); // Save the running totals and release the store however the program exits
+    loadFeePolicy();          // Fee tables from FEE_POLICY_FILENAME, or the built-in defaults
+    if (argc > 1 && strcmp(argv[1], "--bench-parse") == 0) {
+        benchParse(argc > 2 ? atol(argv[2]) : BENCH_PARSE_DEFAULT_ROWS);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-ops") == 0) {
+        static const long defaultSizes[] = { 10000, 100000, 1000000 };
+        long sizes[16];
+        int sizeCount = 0;
+        for (int a = 2; a < argc && sizeCount < 16; a++) {
+            if (atol(argv[a]) > 0) sizes[sizeCount++] = atol(argv[a]);
+        }
+        if (sizeCount == 0) {
+            memcpy(sizes, defaultSizes, sizeof(defaultSizes));
+            sizeCount = 3;
+        }
+        benchOperations(sizes, sizeCount);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        return runBatch(argc > 2 ? argv[2] : "-") == 0 ? 0 : 1;
+    }
+    if (argc > 2 && strcmp(argv[1], "--run") == 0) {
+        return runCommand(argc - 2, argv + 2) ? 0 : 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0) {
+        return serveStudents(argc > 2 ? argv[2] : SERVER_SOCKET) ? 0 : 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "--client") == 0) {
+        return runClient(argc > 2 ? argv[2] : SERVER_SOCKET) == 0 ? 0 : 1;
+    }
     mainMenu(); // Navigate to the main menu
     return 0;   // Indicate successful execution
 }
@@ -101,6 +658,13 @@ void clearLine(int row, int startCol, int length) {
     fflush(stdout); // Ensure clearing is immediately visible
 }
 
+// Current time in seconds from a monotonic clock.
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
 // Pauses execution and waits for the user to press Enter.
 void pressEnterToContinue() {
     printf("\nPress Enter to continue...");
@@ -115,6 +679,24 @@ void str_to_lower(char* str) {
     }
 }
 
+// Case-insensitive string equality.
+static int equalsIgnoreCase(const char* a, const char* b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+// Orders two strings alphabetically, ignoring case (like strcmp: negative, 0 or positive).
+static int compareIgnoreCase(const char* a, const char* b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
 // Displays the main menu and handles user navigation.
 void mainMenu() {
     int choice;
@@ -194,7 +776,12 @@ void adminMenu() {
         printf("2. Modify Student Record\n");
         printf("3. Delete Student Record\n");
         printf("4. Search Student Record\n");
-        printf("5. Logout\n\n");
+        printf("5. Bulk Import from CSV\n");
+        printf("6. Storage Import/Export\n");
+        printf("7. Fee Policy\n");
+        printf("8. Fee and Enrollment Report\n");
+        printf("9. Operation Metrics\n");
+        printf("10. Logout\n\n");
         printf("Enter your choice: ");
 
         if (scanf("%d", &choice) != 1) {
@@ -210,50 +797,519 @@ void adminMenu() {
             case 2: modifyStudent(); break;
             case 3: deleteStudent(); break;
             case 4: searchStudent(); break;
-            case 5:
+            case 5: bulkImportMenu(); break;
+            case 6: storageMenu(); break;
+            case 7: feePolicyMenu(); break;
+            case 8: aggregatesReport(); break;
+            case 9: metricsMenu(); break;
+            case 10:
                 printf("Logging out...\n");
                 //   // Optional: allow user to see logout message
                 return; // Return to the main menu
             default:
-                printf("Invalid choice. Please enter a number between 1 and 5.\n");
+                printf("Invalid choice. Please enter a number between 1 and 10.\n");
                  
         }
     } while (1); // Loop until admin chooses to logout
 }
 
+// ---------------------------------------------------------------------------------------------
+// Metrics
+// ---------------------------------------------------------------------------------------------
+// Per-operation latency and I/O counts, enabled by setting METRICS_ENV. They are off by default, and then
+// every hook costs one test of metricsOn. Each timed operation (a batch command, the work of a menu action
+// once its input is in, a store load, an import, a data file rewrite or a journal commit) records its
+// latency in a log2 histogram, and the bytes read and written, rows parsed and fopen/rename/sync calls on
+// the storage, policy, totals and import files made while it runs are charged to it. Anything outside a
+// timed operation (e.g. reading the fee policy at start or saving the totals at exit) is charged to
+// "other". Binary storage is memory-mapped: the mapped file counts as read when it is opened, and each
+// synced range as written.
+// The metrics are shown by the admin menu, answered by the batch command "metrics", and written to
+// METRICS_FILENAME at exit and by "metrics|save", one line per operation that did anything:
+//   METRIC|<operation>|<count>|<total us>|<max us>|<p50 us>|<p90 us>|<p99 us>|<bytes read>|<bytes written>|
+//          <rows parsed>|<fopen calls>|<rename calls>|<sync calls>|<count per histogram bucket, comma-separated>
+// A percentile is the upper bound of the histogram bucket it falls in (or the maximum, if lower).
+
+static const char* const metricsOpNames[OP_COUNT] = {
+    "register", "display", "search", "modify", "delete", "query", "sorted", "stats", "export",
+    "load", "import", "rewrite", "sync", "other"
+};
+
+static int metricsOn;                          // Set by metricsInit from METRICS_ENV
+static OpMetrics metrics[OP_COUNT];
+static double metricsSince;                    // When the metrics were started or last reset
+static __thread int metricsCurrent = OP_OTHER; // Operation the calling thread is running
+
+// Current time in nanoseconds from a monotonic clock.
+static long long nowNanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// atexit handler: saves the metrics as they stand at exit.
+static void saveMetricsAtExit() {
+    if (!saveMetrics()) fprintf(stderr, "Warning: Could not write '%s'.\n", METRICS_FILENAME);
+}
+
+// Reads METRICS_ENV and, when the metrics are enabled, arranges for them to be saved at exit.
+// Called before anything else is registered with atexit, so the saved metrics include the exit handlers.
+void metricsInit() {
+    const char* value = getenv(METRICS_ENV);
+    metricsOn = value && value[0] && strcmp(value, "0") != 0;
+    metricsSince = nowSeconds();
+    if (metricsOn) atexit(saveMetricsAtExit);
+}
+
+// Adds 'amount' to a counter (METRIC_*) of the operation the calling thread is running.
+static void metricsAdd(int counter, long long amount) {
+    if (!metricsOn) return;
+    __atomic_fetch_add(&metrics[metricsCurrent].counters[counter], amount, __ATOMIC_RELAXED);
+}
+
+// Starts timing an operation of kind 'op' (-1: none) on the calling thread; pass the result to metricsEnd.
+static MetricsSpan metricsBegin(int op) {
+    MetricsSpan span = { -1, OP_OTHER, 0 };
+    if (!metricsOn || op < 0) return span;
+    span.op = op;
+    span.previous = metricsCurrent;
+    span.startNs = nowNanoseconds();
+    metricsCurrent = op;
+    return span;
+}
+
+// Ends a timed operation: records its latency, then charges the operation it was nested in (if any) again.
+static void metricsEnd(MetricsSpan span) {
+    if (span.op < 0) return;
+    long long ns = nowNanoseconds() - span.startNs;
+    unsigned long long us = (unsigned long long)ns / 1000;
+    int bucket = us < 2 ? 0 : 63 - __builtin_clzll(us);
+    if (bucket >= METRICS_BUCKETS) bucket = METRICS_BUCKETS - 1;
+    OpMetrics* m = &metrics[span.op];
+    __atomic_fetch_add(&m->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m->totalNs, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m->buckets[bucket], 1, __ATOMIC_RELAXED);
+    long long max = __atomic_load_n(&m->maxNs, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&m->maxNs, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    metricsCurrent = span.previous;
+}
+
+// fopen(), counted by the metrics.
+static FILE* openFile(const char* path, const char* mode) {
+    metricsAdd(METRIC_OPENS, 1);
+    return fopen(path, mode);
+}
+
+// rename(), counted by the metrics.
+static int renameFile(const char* from, const char* to) {
+    metricsAdd(METRIC_RENAMES, 1);
+    return rename(from, to);
+}
+
+// Returns the operation (OP_*) a batch command is timed as, or -1 for an unknown command.
+static int metricsCommandOp(const char* name) {
+    if (strcmp(name, "explain") == 0) return OP_QUERY;
+    if (strcmp(name, "top") == 0) return OP_SORTED;
+    if (strcmp(name, "suggest") == 0) return OP_SEARCH;
+    if (strcmp(name, "ages") == 0) return OP_STATS;
+    for (int op = 0; op <= OP_EXPORT; op++) { // The other commands are named like their operation
+        if (strcmp(name, metricsOpNames[op]) == 0) return op;
+    }
+    return -1;
+}
+
+// Copies the metrics of an operation. Returns 0 if the operation has done nothing yet.
+static int metricsSnapshot(int op, OpMetrics* m) {
+    int active = 0;
+    m->count = __atomic_load_n(&metrics[op].count, __ATOMIC_RELAXED);
+    m->totalNs = __atomic_load_n(&metrics[op].totalNs, __ATOMIC_RELAXED);
+    m->maxNs = __atomic_load_n(&metrics[op].maxNs, __ATOMIC_RELAXED);
+    for (int b = 0; b < METRICS_BUCKETS; b++) m->buckets[b] = __atomic_load_n(&metrics[op].buckets[b], __ATOMIC_RELAXED);
+    for (int c = 0; c < METRIC_COUNTERS; c++) {
+        m->counters[c] = __atomic_load_n(&metrics[op].counters[c], __ATOMIC_RELAXED);
+        active |= m->counters[c] != 0;
+    }
+    return active || m->count > 0;
+}
+
+// Latency in microseconds that 'percent' % of the operations did not exceed (see the section comment).
+static long long metricsPercentile(const OpMetrics* m, int percent) {
+    long long maxUs = m->maxNs / 1000, rank = (percent * m->count + 99) / 100, seen = 0; // Rounded up
+    if (rank < 1) rank = 1;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        seen += m->buckets[b];
+        if (seen >= rank) return (2LL << b) < maxUs ? (2LL << b) : maxUs;
+    }
+    return maxUs;
+}
+
+// Writes a METRIC line per operation that did anything. Returns the number of lines.
+static int metricsWrite(FILE* out) {
+    OpMetrics m;
+    int lines = 0;
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (!metricsSnapshot(op, &m)) continue;
+        fprintf(out, "METRIC|%s|%lld|%lld|%lld|%lld|%lld|%lld", metricsOpNames[op], m.count, m.totalNs / 1000,
+                m.maxNs / 1000, metricsPercentile(&m, 50), metricsPercentile(&m, 90), metricsPercentile(&m, 99));
+        for (int c = 0; c < METRIC_COUNTERS; c++) fprintf(out, "|%lld", m.counters[c]);
+        for (int b = 0; b < METRICS_BUCKETS; b++) fprintf(out, "%c%lld", b == 0 ? '|' : ',', m.buckets[b]);
+        fputc('\n', out);
+        lines++;
+    }
+    return lines;
+}
+
+// Clears the metrics (an operation running meanwhile may still add to the new totals).
+static void metricsReset() {
+    for (int op = 0; op < OP_COUNT; op++) {
+        OpMetrics* m = &metrics[op];
+        __atomic_store_n(&m->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&m->totalNs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&m->maxNs, 0, __ATOMIC_RELAXED);
+        for (int b = 0; b < METRICS_BUCKETS; b++) __atomic_store_n(&m->buckets[b], 0, __ATOMIC_RELAXED);
+        for (int c = 0; c < METRIC_COUNTERS; c++) __atomic_store_n(&m->counters[c], 0, __ATOMIC_RELAXED);
+    }
+    metricsSince = nowSeconds();
+}
+
+// Prints the metrics as a table.
+void metricsReport(FILE* out) {
+    static const char* rule = "+----------+----------+------------+------------+------------+------------+------------+------------+---------------+---------------+--------+--------+--------+\n";
+    OpMetrics m;
+    fprintf(out, "Metrics of the last %.1f seconds (latencies in microseconds):\n", nowSeconds() - metricsSince);
+    fprintf(out, "%s", rule);
+    fprintf(out, "| %-8s | %8s | %10s | %10s | %10s | %10s | %10s | %10s | %13s | %13s | %6s | %6s | %6s |\n", "Op", "Count",
+            "Mean", "p50", "p90", "p99", "Max", "Rows", "Bytes read", "Bytes written", "fopen", "rename", "sync");
+    fprintf(out, "%s", rule);
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (!metricsSnapshot(op, &m)) continue;
+        fprintf(out, "| %-8s | %8lld | %10lld | %10lld | %10lld | %10lld | %10lld | %10lld | %13lld | %13lld | %6lld | %6lld | %6lld |\n",
+                metricsOpNames[op], m.count, m.count > 0 ? m.totalNs / 1000 / m.count : 0, metricsPercentile(&m, 50),
+                metricsPercentile(&m, 90), metricsPercentile(&m, 99), m.maxNs / 1000,
+                m.counters[METRIC_ROWS], m.counters[METRIC_READ], m.counters[METRIC_WRITTEN],
+                m.counters[METRIC_OPENS], m.counters[METRIC_RENAMES], m.counters[METRIC_SYNCS]);
+    }
+    fprintf(out, "%s", rule);
+}
+
+// Writes the metrics to METRICS_FILENAME (via a temporary file), headed by "#METRICS|<seconds covered>".
+// This file's own open and rename are not counted. Returns 1 on success.
+int saveMetrics() {
+    FILE* fp = fopen(TEMP_METRICS_FILENAME, "w");
+    if (!fp) return 0;
+    fprintf(fp, "#METRICS|%.3f\n", nowSeconds() - metricsSince);
+    metricsWrite(fp);
+    if (fclose(fp) != 0 || rename(TEMP_METRICS_FILENAME, METRICS_FILENAME) != 0) {
+        remove(TEMP_METRICS_FILENAME);
+        return 0;
+    }
+    return 1;
+}
+
+// Shows the metrics to the admin and saves them to METRICS_FILENAME.
+void metricsMenu() {
+    clearScreen();
+    printf("========================\n");
+    printf("   OPERATION METRICS\n");
+    printf("========================\n\n");
+    if (!metricsOn) {
+        printf("Metrics are disabled. Start the program with %s=1 in the environment to record them.\n", METRICS_ENV);
+        return;
+    }
+    metricsReport(stdout);
+    if (saveMetrics()) printf("\nSaved to '%s'.\n", METRICS_FILENAME);
+    else printf("\nError: Could not write '%s'.\n", METRICS_FILENAME);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Value dictionaries
+// ---------------------------------------------------------------------------------------------
+// Course and domicile take a handful of distinct values, so records hold a 16-bit code into a dictionary
+// instead of the text. The text is looked up only to display, format or substring-match a record.
+
+static ValueDict courseDict = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static ValueDict domicileDict = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Storage of the value of a code that was given out.
+static char* dictValue(const ValueDict* dict, int code) {
+    return dict->chunks[code / DICT_CHUNK_ENTRIES][code % DICT_CHUNK_ENTRIES];
+}
+
+// Hash slot where the search for the 'len'-byte value 'text' starts (FNV-1a).
+static unsigned int dictSlot(const char* text, size_t len) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)text[i];
+        h *= 16777619u;
+    }
+    return (h ^ (h >> 15)) & (DICT_SLOTS - 1);
+}
+
+// Returns the code of the 'len'-byte value 'text' (no terminator needed), adding it to the dictionary
+// if it is new. Returns -1 if the value is too long or the dictionary is full.
+static int dictIntern(ValueDict* dict, const char* text, size_t len) {
+    if (len >= DICT_VALUE_LEN) return -1;
+    int locked = 0;
+    while (1) {
+        unsigned int i = dictSlot(text, len);
+        unsigned short entry;
+        while ((entry = __atomic_load_n(&dict->slots[i], __ATOMIC_ACQUIRE)) != 0) {
+            const char* value = dictValue(dict, entry - 1);
+            if (memcmp(value, text, len) == 0 && value[len] == 0) {
+                if (locked) pthread_mutex_unlock(&dict->lock);
+                return entry - 1;
+            }
+            i = (i + 1) & (DICT_SLOTS - 1);
+        }
+        if (!locked) {
+            pthread_mutex_lock(&dict->lock); // Look again under the lock: another thread may have just added it
+            locked = 1;
+            continue;
+        }
+        int code = dict->count;
+        int chunk = code / DICT_CHUNK_ENTRIES;
+        if (code < DICT_MAX_ENTRIES && !dict->chunks[chunk]) { // Published to readers by the slot store below
+            dict->chunks[chunk] = malloc(DICT_CHUNK_ENTRIES * DICT_VALUE_LEN);
+        }
+        if (code < DICT_MAX_ENTRIES && dict->chunks[chunk]) {
+            char* value = dictValue(dict, code);
+            memcpy(value, text, len);
+            value[len] = 0;
+            __atomic_store_n(&dict->slots[i], (unsigned short)(code + 1), __ATOMIC_RELEASE); // Value first, then the slot
+            __atomic_store_n(&dict->count, code + 1, __ATOMIC_RELEASE);
+        } else {
+            code = -1;
+        }
+        pthread_mutex_unlock(&dict->lock);
+        return code;
+    }
+}
+
+// Number of codes given out so far.
+static int dictCount(const ValueDict* dict) {
+    return __atomic_load_n(&dict->count, __ATOMIC_ACQUIRE);
+}
+
+// Value of a code.
+static const char* dictText(const ValueDict* dict, int code) {
+    return dictValue(dict, code);
+}
+
+// Sets bit c of the bitmap 'codes' (DICT_CODE_BYTES bytes) for each code c whose value contains 'lowerTerm'
+// (equals it, if 'exact'), ignoring case, and clears the others. Returns the number of codes set.
+static int dictMatchCodes(const ValueDict* dict, const char* lowerTerm, int exact, unsigned char* codes) {
+    int count = dictCount(dict), matches = 0;
+    memset(codes, 0, (size_t)(count + 7) / 8); // Bits of codes not given out yet are never tested
+    for (int c = 0; c < count; c++) {
+        char lower[DICT_VALUE_LEN];
+        strcpy(lower, dictValue(dict, c));
+        str_to_lower(lower);
+        if (exact ? strcmp(lower, lowerTerm) == 0 : strstr(lower, lowerTerm) != NULL) {
+            codes[c / 8] |= (unsigned char)(1u << (c % 8));
+            matches++;
+        }
+    }
+    return matches;
+}
+
+// Tests bit 'code' of a bitmap filled by dictMatchCodes.
+static int codeMatches(const unsigned char* codes, int code) {
+    return codes[code / 8] >> (code % 8) & 1;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Fee policy
+// ---------------------------------------------------------------------------------------------
+// Course fees, domicile discounts and percentage tiers come from a table instead of code, so a
+// policy change is an edit to FEE_POLICY_FILENAME plus a re-price of the roster. File format, one rule per line:
+//   course|BTech|1200000      total fee for a course
+//   domicile|Uttarakhand|25   discount (%) for a domicile
+//   tier|95|30                discount (%) when the 12th percentage is above 95 (the highest matching tier wins)
+// Lines starting with '#' are comments.
+
+// Built-in policy, used when there is no policy file.
+static const struct { const char* name; float fee; } defaultCourseFees[] = {
+    { "BTech", 1200000.0f }, { "BCA", 800000.0f }, { "BSc", 400000.0f }
+};
+static const struct { const char* name; float discount; } defaultDomicileDiscounts[] = {
+    { "Uttarakhand", 25.0f }
+};
+static const struct { float above; float discount; } defaultPercentTiers[] = {
+    { 75.0f, 10.0f }, { 85.0f, 20.0f }, { 95.0f, 30.0f }
+};
+
+static FeePolicy feePolicy; // The policy in force
+
+// FNV-1a of a string as if it were lowercase, mixed with a seed.
+static unsigned int policyHash(const char* name, unsigned int seed) {
+    unsigned int h = 2166136261u ^ seed;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h ^= (unsigned char)tolower(*p);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// Adds an entry (replacing the value of an existing name). Returns 0 if the table is full or the name invalid.
+static int policyTableAdd(PolicyTable* table, const char* name, float value) {
+    for (int i = 0; i < table->count; i++) {
+        if (equalsIgnoreCase(table->names[i], name)) {
+            table->values[i] = value;
+            return 1;
+        }
+    }
+    if (table->count == POLICY_MAX_ENTRIES || strlen(name) >= COURSE_LEN || name[0] == 0) return 0;
+    strcpy(table->names[table->count], name);
+    table->values[table->count++] = value;
+    return 1;
+}
+
+// Chooses a table size and seed for which no two names share a slot.
+static void policyTableBuild(PolicyTable* table) {
+    unsigned int size = 16;
+    while (size < POLICY_MAX_SLOTS && size < 2u * (unsigned int)(table->count * table->count)) size *= 2;
+    table->mask = size - 1;
+    for (table->seed = 0;; table->seed++) {
+        int collision = 0;
+        for (unsigned int i = 0; i < size; i++) table->slots[i] = -1;
+        for (int e = 0; e < table->count && !collision; e++) {
+            unsigned int slot = policyHash(table->names[e], table->seed) & table->mask;
+            if (table->slots[slot] != -1) collision = 1;
+            else table->slots[slot] = (short)e;
+        }
+        if (!collision) return; // With >= 2n^2 slots most seeds work, so this ends after a few tries
+    }
+}
+
+// Looks a name up case-insensitively. Returns its value, or 0 if the policy does not list it.
+static float policyTableFind(const PolicyTable* table, const char* name) {
+    int e = table->slots[policyHash(name, table->seed) & table->mask];
+    return e >= 0 && equalsIgnoreCase(table->names[e], name) ? table->values[e] : 0.0f;
+}
+
+// Adds a tier. Until policyTiersBuild sorts them, tierDiscount[i + 1] holds the discount of tierAbove[i].
+static int policyAddTier(FeePolicy* policy, float above, float discount) {
+    if (policy->tierCount == POLICY_MAX_TIERS) return 0;
+    policy->tierAbove[policy->tierCount] = above;
+    policy->tierDiscount[policy->tierCount + 1] = discount;
+    policy->tierCount++;
+    return 1;
+}
+
+// Sorts the tiers by threshold and fills the unused thresholds so the tier lookup needs no branches.
+static void policyTiersBuild(FeePolicy* policy) {
+    for (int i = 1; i < policy->tierCount; i++) { // Insertion sort: at most POLICY_MAX_TIERS entries
+        float above = policy->tierAbove[i], discount = policy->tierDiscount[i + 1];
+        int j = i;
+        for (; j > 0 && policy->tierAbove[j - 1] > above; j--) {
+            policy->tierAbove[j] = policy->tierAbove[j - 1];
+            policy->tierDiscount[j + 1] = policy->tierDiscount[j];
+        }
+        policy->tierAbove[j] = above;
+        policy->tierDiscount[j + 1] = discount;
+    }
+    policy->tierDiscount[0] = 0.0f; // Not above any threshold
+    for (int i = policy->tierCount; i < POLICY_MAX_TIERS; i++) {
+        policy->tierAbove[i] = INFINITY; // Never exceeded
+        policy->tierDiscount[i + 1] = 0.0f;
+    }
+}
+
+// Fills a policy with the built-in defaults.
+static void defaultFeePolicy(FeePolicy* policy) {
+    memset(policy, 0, sizeof(*policy));
+    for (size_t i = 0; i < sizeof(defaultCourseFees) / sizeof(defaultCourseFees[0]); i++) {
+        policyTableAdd(&policy->courses, defaultCourseFees[i].name, defaultCourseFees[i].fee);
+    }
+    for (size_t i = 0; i < sizeof(defaultDomicileDiscounts) / sizeof(defaultDomicileDiscounts[0]); i++) {
+        policyTableAdd(&policy->domiciles, defaultDomicileDiscounts[i].name, defaultDomicileDiscounts[i].discount);
+    }
+    for (size_t i = 0; i < sizeof(defaultPercentTiers) / sizeof(defaultPercentTiers[0]); i++) {
+        policyAddTier(policy, defaultPercentTiers[i].above, defaultPercentTiers[i].discount);
+    }
+}
+
+// Loads FEE_POLICY_FILENAME into the policy in force, or the built-in defaults if there is no such file.
+// On a malformed file the previous policy stays in force. Returns 1 if the new policy was applied.
+int loadFeePolicy() {
+    static FeePolicy policy; // Large (slot tables); built here and copied into feePolicy once valid
+    FILE* fp = openFile(FEE_POLICY_FILENAME, "r");
+    if (!fp) {
+        defaultFeePolicy(&policy);
+    } else {
+        memset(&policy, 0, sizeof(policy));
+        char line[MAX_LINE_LEN], kind[16], name[MAX_LINE_LEN];
+        float value;
+        int lineNo = 0;
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            lineNo++;
+            metricsAdd(METRIC_READ, (long long)strlen(line));
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0] == '#' || line[strspn(line, " \t")] == 0) continue;
+            int ok = sscanf(line, "%15[^|]|%[^|]|%f", kind, name, &value) == 3 && value >= 0.0f;
+            if (ok && strcmp(kind, "course") == 0) ok = value > 0.0f && policyTableAdd(&policy.courses, name, value);
+            else if (ok && strcmp(kind, "domicile") == 0) ok = value <= 100.0f && policyTableAdd(&policy.domiciles, name, value);
+            else if (ok && strcmp(kind, "tier") == 0) ok = value <= 100.0f && policyAddTier(&policy, strtof(name, NULL), value);
+            else ok = 0;
+            if (!ok) {
+                printf("Warning: '%s' line %d is not a valid rule; keeping the current fee policy.\n", FEE_POLICY_FILENAME, lineNo);
+                fclose(fp);
+                return 0;
+            }
+        }
+        fclose(fp);
+        if (policy.courses.count == 0) {
+            printf("Warning: '%s' lists no courses; keeping the current fee policy.\n", FEE_POLICY_FILENAME);
+            return 0;
+        }
+    }
+    policyTableBuild(&policy.courses);
+    policyTableBuild(&policy.domiciles);
+    policyTiersBuild(&policy);
+    feePolicy = policy;
+    return 1;
+}
+
+// Comma-separated list of the courses in the policy, for prompts and error messages.
+const char* courseListText() {
+    static char text[POLICY_MAX_ENTRIES * (COURSE_LEN + 2)];
+    text[0] = 0;
+    for (int i = 0; i < feePolicy.courses.count; i++) {
+        if (i > 0) strcat(text, ", ");
+        strcat(text, feePolicy.courses.names[i]);
+    }
+    return text;
+}
+
 // Calculates the total fee based on the course name.
 // Course comparison is case-insensitive.
-float getTotalFee(char course[]) {
-    char lowerCourse[COURSE_LEN];
-    strncpy(lowerCourse, course, sizeof(lowerCourse) - 1); // Copy course name
-    lowerCourse[sizeof(lowerCourse) - 1] = '\0'; // Ensure null termination
-    str_to_lower(lowerCourse); // Convert to lowercase for case-insensitive comparison
-
-    if (strcmp(lowerCourse, "btech") == 0) return 1200000.0f;
-    else if (strcmp(lowerCourse, "bca") == 0) return 800000.0f;
-    else if (strcmp(lowerCourse, "bsc") == 0) return 400000.0f;
-    return 0.0f; // Default fee for an unknown or invalid course
+float getTotalFee(const char course[]) {
+    return policyTableFind(&feePolicy.courses, course); // 0 for an unknown or invalid course
 }
 
 
 // Calculates percentage-based discount.
+// The tier is the number of thresholds the percentage is above; summing the comparisons needs no branches.
 float getPercentDiscount(float percent) {
-    if (percent > 95.0f) return 30.0f;  // 30% discount for >95%
-    else if (percent > 85.0f) return 20.0f;  // 20% discount for >85%
-    else if (percent > 75.0f) return 10.0f;  // 10% discount for >75%
-    return 0.0f; // No discount otherwise
+    int tier = 0;
+    for (int i = 0; i < POLICY_MAX_TIERS; i++) {
+        tier += percent > feePolicy.tierAbove[i];
+    }
+    return feePolicy.tierDiscount[tier];
 }
 
 // Calculates domicile-based discount.
 // Domicile comparison is case-insensitive.
-float getDomicileDiscount(char dom[]) {
-    char lowerDom[DOMICILE_LEN];
-    strncpy(lowerDom, dom, sizeof(lowerDom) - 1); // Copy domicile string
-    lowerDom[sizeof(lowerDom) - 1] = '\0'; // Ensure null termination
-    str_to_lower(lowerDom); // Convert to lowercase
+float getDomicileDiscount(const char dom[]) {
+    return policyTableFind(&feePolicy.domiciles, dom); // No discount for domiciles the policy does not list
+}
 
-    if (strcmp(lowerDom, "uttarakhand") == 0) return 25.0f; // 25% discount for Uttarakhand domicile
-    return 0.0f; // No discount for other domiciles
+// Fills in the fee fields of a student from their course, 12th percentage and domicile.
+void computeFees(StudentForm* s, float percent) {
+    s->totalFee = getTotalFee(dictText(&courseDict, s->courseCode));
+    s->discount = s->totalFee * (getPercentDiscount(percent) / 100.0f);
+    s->domicileDiscount = (s->totalFee - s->discount) * (getDomicileDiscount(dictText(&domicileDict, s->domicileCode)) / 100.0f);
+    s->finalFee = s->totalFee - s->discount - s->domicileDiscount;
 }
 
 // Validates a mobile number string.
@@ -288,40 +1344,3701 @@ int isValidPercentage(const char* percentStr, float* percentage) {
     return 1; // Valid
 }
 
-// Parses a single line from the student data file into a StudentForm struct.
-// The file is expected to be pipe-delimited (|).
-// Format: Name|Mother|Father|Mobile|Percent|Domicile|Course|DOB|TotalFee|Discount|DomicileDiscount|FinalFee
-// Returns 1 on successful parsing of all 12 fields, 0 otherwise.
-int parseStudentLine(const char* line, StudentForm* s) {
-    // %[^|] reads characters until a '|' is encountered.
-    // The number before [^|] (e.g., %49[^|]) limits the number of characters read to prevent buffer overflow.
-    return sscanf(line, "%49[^|]|%49[^|]|%49[^|]|%14[^|]|%9[^|]|%29[^|]|%49[^|]|%19[^|]|%f|%f|%f|%f",
-                  s->name, s->mother, s->father, s->mobile, s->percent, s->domicile,
-                  s->course, s->dob, &s->totalFee, &s->discount, &s->domicileDiscount, &s->finalFee) == 12;
+// Packs a date into one number, year << 9 | month << 5 | day. Packed dates compare like the dates they
+// stand for, and every one is exact as a float (the sort key of the sorted views); 0 is no date.
+static unsigned int packDate(int year, int month, int day) {
+    return (unsigned int)year << 9 | (unsigned int)month << 5 | (unsigned int)day;
 }
 
-// Handles the student registration process.
-void studentRegistration() {
-    StudentForm s; // Structure to hold the new student's data
-    FILE *fp = fopen(FILENAME, "a"); // Open file in append mode
-    if (!fp) {
-        printf("Error: Could not open file '%s' for writing.\n", FILENAME);
-        perror("Reason"); // Print system error message
-         
-        return;
+// Writes a packed date as DD/MM/YYYY.
+static const char* dateText(unsigned int date, char* buf, size_t size) {
+    snprintf(buf, size, "%02u/%02u/%04u", date & 31, date >> 5 & 15, date >> 9);
+    return buf;
+}
+
+// Packed date of a date of birth written d/m/y (with '/' or '-'), or 0 if it is not a date of the calendar.
+static unsigned int dobDate(const char* dob) {
+    static const int monthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    long number = dobNumber(dob);
+    if (number < 0) return 0;
+    int year = (int)(number / 10000), month = (int)(number / 100 % 100), day = (int)(number % 100);
+    if (year < 1 || month < 1 || month > 12 || day < 1) return 0;
+    int leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return day <= monthDays[month - 1] + (month == 2 && leap) ? packDate(year, month, day) : 0;
+}
+
+// Today's date (local time), packed.
+static unsigned int todayDate() {
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    return packDate(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+// Validates a date of birth: a date of the calendar, from DOB_MIN_YEAR up to today.
+// A valid one is rewritten as DD/MM/YYYY, so every registered date reads the same way.
+int isValidDob(char* dob) {
+    unsigned int date = dobDate(dob);
+    if (date == 0 || (int)(date >> 9) < DOB_MIN_YEAR || date > todayDate()) return 0;
+    dateText(date, dob, DOB_LEN);
+    return 1;
+}
+
+// Checks a filled-in form with the registration rules and computes its fees.
+// Returns NULL if the student can be registered, or the reason it cannot.
+const char* validateStudent(StudentForm* s) {
+    float percent;
+    if (!isValidMobile(s->mobile)) return "invalid mobile number (10 digits required)";
+    if (!isValidPercentage(s->percent, &percent)) return "invalid percentage (0-100 required)";
+    if (!isValidDob(s->dob)) return "invalid date of birth (DD/MM/YYYY, a real date from 1900 up to today)";
+    computeFees(s, percent);
+    if (s->totalFee == 0.0f) return "invalid course (not in the fee policy)";
+    return NULL;
+}
+
+// Layout of the pipe-delimited line: where each field goes in StudentForm and how big it may be.
+static const struct {
+    size_t offset;      // offsetof the field in StudentForm
+    size_t size;        // Size of the char array (for text fields; the longest value + 1 for encoded ones)
+    const char* label;  // Name used in error messages
+    ValueDict* dict;    // Dictionary of a dictionary-encoded field (the record holds a code), else NULL
+} studentFields[STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS] = {
+    { offsetof(StudentForm, name),         NAME_LEN,     "Name", NULL },
+    { offsetof(StudentForm, mother),       MOTHER_LEN,   "Mother's Name", NULL },
+    { offsetof(StudentForm, father),       FATHER_LEN,   "Father's Name", NULL },
+    { offsetof(StudentForm, mobile),       MOBILE_LEN,   "Mobile", NULL },
+    { offsetof(StudentForm, percent),      PERCENT_LEN,  "12th Percentage", NULL },
+    { offsetof(StudentForm, domicileCode), DOMICILE_LEN, "Domicile", &domicileDict },
+    { offsetof(StudentForm, courseCode),   COURSE_LEN,   "Course", &courseDict },
+    { offsetof(StudentForm, dob),          DOB_LEN,      "DOB", NULL },
+    { offsetof(StudentForm, totalFee),         sizeof(float), "Total Fee", NULL },
+    { offsetof(StudentForm, discount),         sizeof(float), "Discount", NULL },
+    { offsetof(StudentForm, domicileDiscount), sizeof(float), "Domicile Discount", NULL },
+    { offsetof(StudentForm, finalFee),         sizeof(float), "Final Fee", NULL },
+};
+
+// Text of field 'field' of a record (the dictionary value for an encoded field).
+static const char* studentFieldText(const StudentForm* s, int field) {
+    const char* p = (const char*)s + studentFields[field].offset;
+    return studentFields[field].dict ? dictText(studentFields[field].dict, *(const unsigned short*)p) : p;
+}
+
+// Sets text field 'field' of a record to the 'len' bytes at 'text' (no terminator needed). Returns 0 if
+// the value does not fit, or if the field is dictionary-encoded and its dictionary is full.
+static int setStudentText(StudentForm* s, int field, const char* text, size_t len) {
+    char* dst = (char*)s + studentFields[field].offset;
+    if (len >= studentFields[field].size) return 0;
+    if (studentFields[field].dict) {
+        int code = dictIntern(studentFields[field].dict, text, len);
+        if (code < 0) return 0;
+        *(unsigned short*)dst = (unsigned short)code;
+        return 1;
     }
-    clearScreen();
-    printf("    ############## STUDENT REGISTRATION FORM #############\n\n");
+    memcpy(dst, text, len);
+    dst[len] = 0;
+    return 1;
+}
 
-    // --- Form Layout using gotoxy (for basic TUI) ---
-    // This section defines the visual layout of the form on the console.
-    int base_row = 3; // Starting row for the form fields
-    int label_col = 5;
-    int input_col = 30;
-    int current_row = base_row;
+// Copies the string 'value' into text field 'field' of a form. Returns 0 if it does not fit (see setStudentText).
+static int setStudentField(StudentForm* s, int field, const char* value) {
+    return setStudentText(s, field, value, strlen(value));
+}
 
-    gotoxy(current_row, label_col);     printf("+---------------------+------------------------------+");
-    gotoxy(++current_row, label_col);   printf("| Name                |                              |");
+// Why setStudentField(s, field, value) failed, to follow the field's label in an error message.
+static const char* setFieldProblem(int field, const char* value) {
+    return strlen(value) >= studentFields[field].size ? "is too long" : "has too many different values on record";
+}
+
+// Returns the display name of a field number reported by parseStudentFields (1-based).
+const char* studentFieldName(int field) {
+    if (field == FIELD_ID + 1) return "Student ID";
+    if (field < 1 || field > STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS) return "unknown";
+    return studentFields[field - 1].label;
+}
+
+// Parses a fee field in [p, end). The common "digits[.digits]" form is converted directly;
+// anything else (exponents, spaces, inf...) falls back to strtof. Returns 1 if the whole field is a number.
+static int parseFeeField(const char* p, const char* end, float* out) {
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* q = p;
+    int negative = 0;
+    if (q < end && (*q == '-' || *q == '+')) negative = *q++ == '-';
+
+    unsigned long long mantissa = 0;
+    int digits = 0, scale = 0;
+    const char* firstDigit = q;
+    for (; q < end && *q >= '0' && *q <= '9'; q++) {
+        if (digits < 19) { mantissa = mantissa * 10 + (unsigned)(*q - '0'); digits += mantissa != 0; }
+        else scale++; // Too many digits to hold exactly: keep the magnitude only
+    }
+    int intDigits = (int)(q - firstDigit);
+    if (q < end && *q == '.') {
+        const char* fracStart = ++q;
+        for (; q < end && *q >= '0' && *q <= '9'; q++) {
+            if (digits < 19) { mantissa = mantissa * 10 + (unsigned)(*q - '0'); digits += mantissa != 0; scale--; }
+        }
+        intDigits += (int)(q - fracStart);
+    }
+
+    if (q == end && intDigits > 0 && scale >= -22 && scale <= 22) {
+        double value = scale < 0 ? (double)mantissa / pow10[-scale] : (double)mantissa * pow10[scale];
+        *out = (float)(negative ? -value : value);
+        return 1;
+    }
+
+    // Slow path: same rules as strtof (what the sscanf-based parser accepted)
+    char buf[64];
+    size_t len = (size_t)(end - p);
+    if (len == 0 || len >= sizeof(buf)) return 0;
+    memcpy(buf, p, len);
+    buf[len] = 0;
+    char* stop;
+    *out = strtof(buf, &stop);
+    while (stop != buf && isspace((unsigned char)*stop)) stop++;
+    return stop != buf && *stop == 0;
+}
+
+// Parses one pipe-delimited line of 'len' bytes (no trailing newline needed) into a StudentForm.
+// Format: Name|Mother|Father|Mobile|Percent|Domicile|Course|DOB|TotalFee|Discount|DomicileDiscount|FinalFee|ID
+// Text fields must be non-empty and fit their arrays (or dictionaries). Lines written before records had IDs
+// end at the final fee; their ID is left 0. Anything after the ID is ignored.
+// Returns 0 on success, otherwise the 1-based number of the first malformed field (see studentFieldName).
+int parseStudentFields(const char* line, size_t len, StudentForm* s) {
+    const char* p = line;
+    const char* end = line + len;
+    int field = 0;
+
+    for (; field < STUDENT_TEXT_FIELDS; field++) {
+        const char* bar = memchr(p, '|', (size_t)(end - p));
+        if (!bar) return field + 1;
+        size_t n = (size_t)(bar - p);
+        if (n == 0 || !setStudentText(s, field, p, n)) return field + 1;
+        p = bar + 1;
+    }
+
+    for (; field < STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS; field++) {
+        const char* stop = memchr(p, '|', (size_t)(end - p));
+        if (!stop) {
+            if (field < STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS - 1) return field + 1;
+            stop = end;
+        }
+        if (!parseFeeField(p, stop, (float*)((char*)s + studentFields[field].offset))) return field + 1;
+        p = stop + 1;
+    }
+
+    unsigned long id = 0;
+    const char* q = p;
+    for (; q < end && *q >= '0' && *q <= '9' && id <= UINT_MAX; q++) id = id * 10 + (unsigned)(*q - '0');
+    const char* digitsEnd = q;
+    while (q < end && isspace((unsigned char)*q)) q++;
+    if (p < end && (digitsEnd == p || id == 0 || id >= UINT_MAX || (q < end && *q != '|'))) return FIELD_ID + 1;
+    s->id = (unsigned int)id;
+    return 0;
+}
+
+// Parses a single line from the student data file into a StudentForm struct.
+// The file is expected to be pipe-delimited (|); see parseStudentFields for the format.
+// Returns 1 on successful parsing of all 12 fields, 0 otherwise.
+int parseStudentLine(const char* line, StudentForm* s) {
+    return parseStudentFields(line, strlen(line), s) == 0;
+}
+
+// The original sscanf-based parser, kept as the reference for the parser benchmark.
+static int parseStudentLineScanf(const char* line, StudentForm* s) {
+    // %[^|] reads characters until a '|' is encountered.
+    // The number before [^|] (e.g., %49[^|]) limits the number of characters read to prevent buffer overflow.
+    char domicile[DOMICILE_LEN], course[COURSE_LEN];
+    s->id = 0;
+    return sscanf(line, "%49[^|]|%49[^|]|%49[^|]|%14[^|]|%9[^|]|%29[^|]|%49[^|]|%19[^|]|%f|%f|%f|%f|%u",
+                  s->name, s->mother, s->father, s->mobile, s->percent, domicile,
+                  course, s->dob, &s->totalFee, &s->discount, &s->domicileDiscount, &s->finalFee, &s->id) >= 12 &&
+           setStudentText(s, FIELD_DOMICILE, domicile, strlen(domicile)) &&
+           setStudentText(s, FIELD_COURSE, course, strlen(course));
+}
+
+// Formats a student record as one pipe-delimited line, including the trailing newline
+// (same format parseStudentLine reads). Returns the line length, like snprintf.
+int formatStudentLine(char* buf, size_t size, const StudentForm* s) {
+    return snprintf(buf, size, "%s|%s|%s|%s|%s|%s|%s|%s|%.2f|%.2f|%.2f|%.2f|%u\n",
+                    s->name, s->mother, s->father, s->mobile, s->percent, dictText(&domicileDict, s->domicileCode),
+                    dictText(&courseDict, s->courseCode), s->dob, s->totalFee, s->discount, s->domicileDiscount, s->finalFee,
+                    s->id);
+}
+
+// Writes a student record as one line of the student file.
+void writeStudentLine(FILE* fp, const StudentForm* s) {
+    char line[MAX_LINE_LEN];
+    formatStudentLine(line, sizeof(line), s);
+    fputs(line, fp);
+}
+
+// Prints the column header shared by the display and search tables.
+void printStudentTableHeader() {
+    printf("====================================================================================================================================\n");
+    printf("| %-7s | %-20s | %-13s | %-13s | %-12s | %-8s | %-11s | %-10s | %-15s |\n", "ID", "Name", "Mother's Name", "Father's Name", "Mobile", "12th %", "Domicile", "Course", "Final Fee");
+    printf("====================================================================================================================================\n");
+}
+
+// Formats one student as a row of the display/search table (with the newline) into buf.
+// Returns the length written, truncated to size - 1.
+int formatStudentRow(char* buf, size_t size, const StudentForm* s) {
+    int len = snprintf(buf, size, "| #%-6u | %-20s | %-13s | %-13s | %-12s | %-8s | %-11s | %-10s | Rs %-12.2f |\n",
+                       s->id, s->name, s->mother, s->father, s->mobile, s->percent, dictText(&domicileDict, s->domicileCode),
+                       dictText(&courseDict, s->courseCode), s->finalFee);
+    return len < (int)size ? len : (int)size - 1;
+}
+
+// Prints one student as a row of the display/search table.
+void printStudentRow(const StudentForm* s) {
+    char row[MAX_LINE_LEN];
+    formatStudentRow(row, sizeof(row), s);
+    fputs(row, stdout);
+}
+
+// ---------------------------------------------------------------------------------------------
+// In-memory student store
+// ---------------------------------------------------------------------------------------------
+// The data file is parsed once into 'store'; display, search, modify and delete are then served
+// from memory. Hash indexes on mobile number, case-folded name and student ID make exact lookups O(1).
+// Records are packed: their text fields take only the bytes they need, in a few large arena blocks.
+//
+// Student IDs: every registration gets the next number of store.nextId, kept in the record (the last
+// field of a data file line, a field of the binary slot) and never given out again, even once the record
+// is deleted. Records saved before IDs existed get theirs at the first load, which saves them at once.
+// The ID index maps an ID to the record's slot, which is also where its storage is (its line in the data
+// file, as the change log refers to it, or its binary slot), so a modify or delete by ID touches that one record.
+
+static StudentStore store; // The single store shared by all menu operations
+
+// ---- Record arena ----
+
+// Text fields in the order they are packed, and the position of each field in that order (-1: not text).
+static const int packedFields[STORE_TEXT_FIELDS] = { FIELD_NAME, FIELD_MOTHER, FIELD_FATHER, FIELD_MOBILE, FIELD_PERCENT, FIELD_DOB };
+static const int packedPosition[STUDENT_TEXT_FIELDS] = { 0, 1, 2, 3, 4, -1, -1, 5 };
+
+// Returns the bytes of arena reference 'ref'.
+static char* arenaText(const RecordArena* arena, unsigned int ref) {
+    return arena->blocks[ref >> ARENA_BLOCK_BITS] + (ref & (ARENA_BLOCK_BYTES - 1));
+}
+
+// Hands out 'size' bytes (size <= ARENA_BLOCK_BYTES), starting a new block when the last one is full.
+// Stores their reference in *ref. Returns 0 if out of memory or out of blocks.
+static int arenaAlloc(RecordArena* arena, unsigned int size, unsigned int* ref) {
+    if (arena->blockCount == 0 || arena->used + size > ARENA_BLOCK_BYTES) {
+        if (arena->blockCount == ARENA_MAX_BLOCKS) return 0;
+        char* block = malloc(ARENA_BLOCK_BYTES); // Pages are only touched as records fill them
+        if (!block) return 0;
+        arena->blocks[arena->blockCount++] = block;
+        arena->used = 0;
+    }
+    *ref = (unsigned int)(arena->blockCount - 1) << ARENA_BLOCK_BITS | arena->used;
+    arena->used += size;
+    arena->bytes += size;
+    return 1;
+}
+
+// Frees every block.
+static void arenaFree(RecordArena* arena) {
+    for (int b = 0; b < arena->blockCount; b++) free(arena->blocks[b]);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// Copies the text of the live records into a fresh arena, dropping the wasted bytes. Returns 0 if out
+// of memory (the old arena is then kept). Text pointers taken from the store are invalid afterwards.
+static int arenaCompact() {
+    RecordArena fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    unsigned int* refs = malloc((size_t)(store.count > 0 ? store.count : 1) * sizeof(unsigned int));
+    int ok = refs != NULL;
+    for (int i = 0; ok && i < store.count; i++) {
+        const PackedStudent* p = &store.records[i];
+        refs[i] = 0;
+        if (!store.alive[i]) continue;
+        ok = arenaAlloc(&fresh, p->textBytes, &refs[i]);
+        if (ok) memcpy(arenaText(&fresh, refs[i]), arenaText(&store.arena, p->text), p->textBytes);
+    }
+    if (!ok) {
+        free(refs);
+        arenaFree(&fresh);
+        return 0;
+    }
+    for (int i = 0; i < store.count; i++) {
+        store.records[i].text = refs[i];
+        if (!store.alive[i]) store.records[i].textBytes = 0; // Dead records keep no text
+    }
+    free(refs);
+    arenaFree(&store.arena);
+    store.arena = fresh;
+    return 1;
+}
+
+// Counts a record's text as wasted, compacting the arena once at least a block's worth and half of it is waste.
+static void arenaRelease(const PackedStudent* p) {
+    RecordArena* arena = &store.arena;
+    arena->wasted += p->textBytes;
+    if (arena->wasted >= ARENA_BLOCK_BYTES && arena->wasted * 2 > arena->bytes) arenaCompact();
+}
+
+// Packs a form into *p, copying its text fields into the arena. Returns 0 if out of memory.
+static int storePack(PackedStudent* p, const StudentForm* s) {
+    size_t lengths[STORE_TEXT_FIELDS];
+    unsigned int total = 0, ref;
+    for (int t = 0; t < STORE_TEXT_FIELDS; t++) {
+        int field = packedFields[t];
+        lengths[t] = strnlen((const char*)s + studentFields[field].offset, studentFields[field].size - 1);
+        p->start[t] = (unsigned char)total;
+        total += (unsigned int)lengths[t] + 1;
+    }
+    if (!arenaAlloc(&store.arena, total, &ref)) return 0;
+    char* text = arenaText(&store.arena, ref);
+    for (int t = 0; t < STORE_TEXT_FIELDS; t++) {
+        memcpy(text + p->start[t], (const char*)s + studentFields[packedFields[t]].offset, lengths[t]);
+        text[p->start[t] + lengths[t]] = 0;
+    }
+    p->text = ref;
+    p->textBytes = (unsigned short)total;
+    p->domicileCode = s->domicileCode;
+    p->courseCode = s->courseCode;
+    p->totalFee = s->totalFee;
+    p->discount = s->discount;
+    p->domicileDiscount = s->domicileDiscount;
+    p->finalFee = s->finalFee;
+    p->id = s->id;
+    p->dob = dobDate(s->dob);
+    return 1;
+}
+
+// Unpacks record 'idx' into *s and returns s.
+const StudentForm* storeRecord(int idx, StudentForm* s) {
+    const PackedStudent* p = &store.records[idx];
+    const char* text = arenaText(&store.arena, p->text);
+    for (int t = 0; t < STORE_TEXT_FIELDS; t++) {
+        int end = t + 1 < STORE_TEXT_FIELDS ? p->start[t + 1] : p->textBytes;
+        memcpy((char*)s + studentFields[packedFields[t]].offset, text + p->start[t], (size_t)(end - p->start[t]));
+    }
+    s->domicileCode = p->domicileCode;
+    s->courseCode = p->courseCode;
+    s->totalFee = p->totalFee;
+    s->discount = p->discount;
+    s->domicileDiscount = p->domicileDiscount;
+    s->finalFee = p->finalFee;
+    s->id = p->id;
+    return s;
+}
+
+// Text of field 'field' (a text field) of record 'idx', read in place. Valid until the record changes
+// or any record is modified or deleted (either may compact the arena).
+static const char* storeText(int idx, int field) {
+    const PackedStudent* p = &store.records[idx];
+    if (field == FIELD_DOMICILE) return dictText(&domicileDict, p->domicileCode);
+    if (field == FIELD_COURSE) return dictText(&courseDict, p->courseCode);
+    return arenaText(&store.arena, p->text) + p->start[packedPosition[field]];
+}
+
+// Dictionary code of the course or domicile of record 'idx'.
+static int storeCode(int idx, int field) {
+    return field == FIELD_COURSE ? store.records[idx].courseCode : store.records[idx].domicileCode;
+}
+
+// Continues an FNV-1a hash over a block of bytes (start with 2166136261u).
+static unsigned int hashBytes(unsigned int h, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// FNV-1a hash of a string. When 'fold' is set the string is hashed as if it were lowercase.
+static unsigned int hashString(const char* str, int fold) {
+    unsigned int h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+        h ^= fold ? (unsigned char)tolower(*p) : *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Hash of a student ID. IDs are mostly consecutive, and multiplying by an odd constant keeps them apart.
+static unsigned int idKeyHash(unsigned int id) {
+    return id * 2654435761u;
+}
+
+// Hash of the key a record is filed under in the given index.
+static unsigned int storeKeyHash(const HashIndex* index, int idx) {
+    if (index == &store.byId) return idKeyHash(store.records[idx].id);
+    if (index == &store.byMobile) return hashString(storeText(idx, FIELD_MOBILE), 0);
+    return hashString(storeText(idx, FIELD_NAME), 1); // byName is case-insensitive
+}
+
+// Allocates an empty index with 'buckets' chains and room for 'capacity' records.
+static int indexInit(HashIndex* index, unsigned int buckets, int capacity) {
+    index->heads = malloc(buckets * sizeof(int));
+    index->next = malloc((size_t)capacity * sizeof(int));
+    if (!index->heads || !index->next) {
+        free(index->heads);
+        free(index->next);
+        index->heads = index->next = NULL;
+        return 0;
+    }
+    memset(index->heads, -1, buckets * sizeof(int)); // All bytes 0xFF == -1 for every int
+    index->mask = buckets - 1;
+    return 1;
+}
+
+// Links record 'idx' at the head of its chain.
+static void indexInsert(HashIndex* index, int idx) {
+    unsigned int b = storeKeyHash(index, idx) & index->mask;
+    index->next[idx] = index->heads[b];
+    index->heads[b] = idx;
+}
+
+// Unlinks record 'idx' from its chain. Must be called before the record's key fields change.
+static void indexRemove(HashIndex* index, int idx) {
+    unsigned int b = storeKeyHash(index, idx) & index->mask;
+    int* link = &index->heads[b];
+    while (*link != -1) {
+        if (*link == idx) {
+            *link = index->next[idx];
+            return;
+        }
+        link = &index->next[*link];
+    }
+}
+
+// Re-links every live record into a bucket array of the given size.
+static int indexRebuild(HashIndex* index, unsigned int buckets) {
+    int* heads = malloc(buckets * sizeof(int));
+    if (!heads) return 0;
+    memset(heads, -1, buckets * sizeof(int));
+    free(index->heads);
+    index->heads = heads;
+    index->mask = buckets - 1;
+    for (int i = 0; i < store.count; i++) {
+        if (store.alive[i]) indexInsert(index, i);
+    }
+    return 1;
+}
+
+// Makes room for at least one more record, growing the record arrays and the index buckets.
+static int storeReserve() {
+    if (store.count == store.capacity) {
+        int newCapacity = store.capacity * 2;
+        PackedStudent* records = realloc(store.records, (size_t)newCapacity * sizeof(PackedStudent));
+        if (!records) return 0;
+        store.records = records;
+        unsigned char* alive = realloc(store.alive, (size_t)newCapacity);
+        if (!alive) return 0;
+        store.alive = alive;
+        if (store.lines) {
+            int* lines = realloc(store.lines, (size_t)newCapacity * sizeof(int));
+            if (!lines) return 0;
+            store.lines = lines;
+        }
+        int* next = realloc(store.byMobile.next, (size_t)newCapacity * sizeof(int));
+        if (!next) return 0;
+        store.byMobile.next = next;
+        next = realloc(store.byName.next, (size_t)newCapacity * sizeof(int));
+        if (!next) return 0;
+        store.byName.next = next;
+        next = realloc(store.byId.next, (size_t)newCapacity * sizeof(int));
+        if (!next) return 0;
+        store.byId.next = next;
+        store.capacity = newCapacity;
+    }
+    // Keep chains short: double the bucket count whenever live records outnumber buckets
+    if ((unsigned int)store.liveCount >= store.byName.mask + 1) {
+        unsigned int buckets = (store.byName.mask + 1) * 2;
+        if (!indexRebuild(&store.byMobile, buckets) || !indexRebuild(&store.byName, buckets) ||
+            !indexRebuild(&store.byId, buckets)) return 0;
+    }
+    return 1;
+}
+
+// ---- Duplicate applicants ----
+// An applicant is a duplicate of a live record with the same mobile number, or with the same name
+// (case-insensitive) and date of birth. Both keys of every record go into a Bloom filter, so checking a
+// new applicant is usually a few bit tests; only a "maybe" is confirmed through byMobile or byName.
+// The filter is built from the store on the first check (one pass, no parsing) and kept up to date after.
+
+// Allocates an empty filter for 'keys' keys. On failure bits is NULL and every lookup answers "maybe".
+static int bloomInit(BloomFilter* filter, long keys) {
+    unsigned long bits = BLOOM_BLOCK_BITS;
+    while (bits < (unsigned long)keys * BLOOM_BITS_PER_KEY) bits *= 2;
+    filter->bits = calloc(bits / 64, sizeof(unsigned long long));
+    filter->mask = (unsigned int)(bits - 1);
+    filter->keys = 0;
+    filter->capacity = keys;
+    return filter->bits != NULL;
+}
+
+// Sets (add) or tests the BLOOM_PROBES bits of a key hash. All of them lie in one BLOOM_BLOCK_BITS block
+// chosen by the hash, so a key costs one cache miss instead of one per probe; the positions in the block
+// come from a generator seeded with the rotated hash.
+static int bloomProbe(BloomFilter* filter, unsigned int h, int add) {
+    if (!filter->bits) return 1;
+    unsigned long long* block = filter->bits + (size_t)((h & filter->mask) / BLOOM_BLOCK_BITS) * (BLOOM_BLOCK_BITS / 64);
+    unsigned int g = (h >> 16) | (h << 16);
+    for (int i = 0; i < BLOOM_PROBES; i++) {
+        g = g * 1664525u + 1013904223u;
+        unsigned int bit = g >> 23; // Top 9 bits: 0 .. BLOOM_BLOCK_BITS - 1
+        if (add) block[bit / 64] |= 1ull << (bit % 64);
+        else if (!(block[bit / 64] & (1ull << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+// Date of birth as the number YYYYMMDD, so "1/2/2005" and "01-02-2005" compare equal; -1 if it is not
+// d/m/y with '/' or '-'. Hand-parsed rather than with sscanf: this runs for every record loaded.
+static long dobNumber(const char* dob) {
+    long parts[3] = { 0, 0, 0 };
+    const char* p = dob;
+    for (int n = 0; n < 3; n++) {
+        if (!isdigit((unsigned char)*p)) return -1;
+        for (int digits = 0; isdigit((unsigned char)*p) && digits < 4; p++, digits++) parts[n] = parts[n] * 10 + (*p - '0');
+        if (n < 2 && *p != '/' && *p != '-') return -1;
+        if (n < 2) p++;
+    }
+    return *p == 0 ? parts[2] * 10000 + parts[1] * 100 + parts[0] : -1;
+}
+
+// 1 if two dates of birth are the same date (or the same text, when they are not dates).
+static int sameDob(const char* a, const char* b) {
+    long da = dobNumber(a);
+    return da == dobNumber(b) && (da != -1 || equalsIgnoreCase(a, b));
+}
+
+// Hashes of the two duplicate-check keys of a record.
+static unsigned int mobileKeyHash(const char* mobile) {
+    return hashString(mobile, 0);
+}
+
+static unsigned int nameDobKeyHash(const char* name, const char* dobText) {
+    long dob = dobNumber(dobText);
+    unsigned int h = hashString(name, 1);
+    return dob != -1 ? hashBytes(h, (const char*)&dob, sizeof(dob)) : h ^ hashString(dobText, 1);
+}
+
+// Fills the filter with the keys of the live records, sized for 'keys' keys.
+static void applicantsBuild(long keys) {
+    BloomFilter* filter = &store.applicants;
+    free(filter->bits);
+    bloomInit(filter, keys); // If this fails, lookups fall back to the indexes
+    for (int i = 0; i < store.count; i++) {
+        if (!store.alive[i]) continue;
+        bloomProbe(filter, mobileKeyHash(storeText(i, FIELD_MOBILE)), 1);
+        bloomProbe(filter, nameDobKeyHash(storeText(i, FIELD_NAME), storeText(i, FIELD_DOB)), 1);
+        filter->keys += 2;
+    }
+}
+
+// Adds the keys of record 'idx' (once the filter has been built), rebuilding it twice as large if it is full.
+static void applicantsAdd(int idx) {
+    BloomFilter* filter = &store.applicants;
+    if (filter->capacity == 0) return; // Not built yet; loading does not pay for it
+    if (filter->keys + 2 > filter->capacity) {
+        applicantsBuild(filter->capacity * 2); // Includes record 'idx'
+        return;
+    }
+    bloomProbe(filter, mobileKeyHash(storeText(idx, FIELD_MOBILE)), 1);
+    bloomProbe(filter, nameDobKeyHash(storeText(idx, FIELD_NAME), storeText(idx, FIELD_DOB)), 1);
+    filter->keys += 2;
+}
+
+// Returns a live record that 's' would duplicate and sets *field to FIELD_MOBILE or FIELD_DOB
+// (same name and date of birth), or returns -1.
+int storeFindDuplicate(const StudentForm* s, int* field) {
+    if (store.applicants.capacity == 0) { // First check: build the filter, with room to double the roster
+        long keys = 4L * store.liveCount;
+        applicantsBuild(keys > 2L * STORE_INITIAL_CAPACITY ? keys : 2L * STORE_INITIAL_CAPACITY);
+    }
+    if (bloomProbe(&store.applicants, mobileKeyHash(s->mobile), 0)) {
+        int idx = storeNextByMobile(s->mobile, -1);
+        if (idx != -1) {
+            *field = FIELD_MOBILE;
+            return idx;
+        }
+    }
+    if (bloomProbe(&store.applicants, nameDobKeyHash(s->name, s->dob), 0)) {
+        for (int idx = storeNextByName(s->name, -1); idx != -1; idx = storeNextByName(s->name, idx)) {
+            if (sameDob(storeText(idx, FIELD_DOB), s->dob)) {
+                *field = FIELD_DOB;
+                return idx;
+            }
+        }
+    }
+    return -1;
+}
+
+// Registration check: returns why 's' may not be registered as a new applicant, or NULL.
+const char* duplicateApplicant(const StudentForm* s) {
+    int field;
+    if (storeFindDuplicate(s, &field) == -1) return NULL;
+    return field == FIELD_MOBILE ? "duplicate applicant (mobile number already registered)"
+                                 : "duplicate applicant (same name and date of birth already registered)";
+}
+
+// ---- Fuzzy name lookup ----
+// Modify and delete need a student's full name. When no student has the name typed, the closest names
+// are offered instead: a BK-tree over the distinct case-folded names finds those within
+// FUZZY_MAX_DISTANCE edits (Levenshtein distance) while comparing the name with only a small part of
+// the tree. Every child of a node lies at a known distance from it, so by the triangle inequality only
+// children whose distance is within the search radius of the query's distance to the node can hold a
+// match. Distances are computed with Myers' bit-parallel algorithm, one machine word per name, and each
+// node holds its name in the same cache line, so a node visited costs about one cache miss.
+// The tree is built on the first lookup and then kept up to date by storeAdd and storeUpdate. Names that
+// no live record uses any more stay in the tree; lookups skip them.
+
+static pthread_mutex_t namesLock = PTHREAD_MUTEX_INITIALIZER; // Server readers share the store; the tree is built under this
+
+// Per-character match masks of a case-folded name (at most 63 characters): bit i of peq[c] is set if
+// name[i] == c.
+static void namePattern(const char* name, unsigned long long peq[256]) {
+    memset(peq, 0, 256 * sizeof(unsigned long long));
+    for (int i = 0; name[i]; i++) peq[(unsigned char)name[i]] |= 1ull << i;
+}
+
+// Levenshtein distance between the name of pattern 'peq' (length m) and 'text' (Myers/Hyyro bit-vector algorithm).
+static int nameDistance(const unsigned long long peq[256], int m, const char* text) {
+    if (m == 0) return (int)strlen(text);
+    unsigned long long pv = ~0ull, mv = 0, last = 1ull << (m - 1);
+    int score = m;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        unsigned long long eq = peq[*c];
+        unsigned long long xv = eq | mv;
+        unsigned long long xh = (((eq & pv) + pv) ^ pv) | eq;
+        unsigned long long ph = mv | ~(xh | pv);
+        unsigned long long mh = pv & xh;
+        if (ph & last) score++;
+        else if (mh & last) score--;
+        ph = (ph << 1) | 1; // Row 0 of the distance matrix grows by one per character
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+// Copies a name case-folded into buf (NAME_LEN bytes) and returns its length.
+static int nameFold(const char* name, char* buf) {
+    int n = 0;
+    for (; name[n] && n < NAME_LEN - 1; n++) buf[n] = (char)tolower((unsigned char)name[n]);
+    buf[n] = 0;
+    return n;
+}
+
+static void namesDrop(NameTree* tree) {
+    free(tree->nodes);
+    memset(tree, 0, sizeof(*tree));
+}
+
+// Adds a name to the tree unless it is already there. Returns 0 if out of memory.
+static int namesInsert(NameTree* tree, const char* name) {
+    char folded[NAME_LEN];
+    unsigned long long peq[256];
+    int m = nameFold(name, folded);
+    int node = 0, distance = 0;
+    int* link = NULL; // Where the new node is linked in: the sibling list of 'node', in order of distance
+    if (tree->count > 0) {
+        namePattern(folded, peq);
+        while (1) {
+            distance = nameDistance(peq, m, tree->nodes[node].name);
+            if (distance == 0) return 1; // Already listed
+            link = &tree->nodes[node].child;
+            while (*link != -1 && tree->nodes[*link].distance < distance) link = &tree->nodes[*link].sibling;
+            if (*link == -1 || tree->nodes[*link].distance != distance) break;
+            node = *link;
+        }
+    }
+    if (tree->count == tree->capacity) { // Grown by hand: realloc() would not keep the nodes cache-line aligned
+        int newCapacity = tree->capacity ? tree->capacity * 2 : 1024;
+        NameNode* nodes = aligned_alloc(64, (size_t)newCapacity * sizeof(NameNode));
+        if (!nodes) return 0;
+        if (tree->count > 0) {
+            memcpy(nodes, tree->nodes, (size_t)tree->count * sizeof(NameNode));
+            link = link ? (int*)((char*)nodes + ((char*)link - (char*)tree->nodes)) : NULL;
+        }
+        free(tree->nodes);
+        tree->nodes = nodes;
+        tree->capacity = newCapacity;
+    }
+    NameNode* added = &tree->nodes[tree->count];
+    memcpy(added->name, folded, (size_t)m + 1);
+    added->length = (unsigned char)m;
+    added->distance = (unsigned char)distance;
+    added->child = -1;
+    added->sibling = link ? *link : -1;
+    if (link) *link = tree->count;
+    tree->count++;
+    return 1;
+}
+
+// Renumbers the nodes in breadth-first order, so the children of a node, which a search scans together,
+// lie next to each other in memory instead of wherever insertion put them. Returns 0 if out of memory
+// (the tree is then left as it was).
+static int namesRelayout(NameTree* tree) {
+    NameNode* nodes = aligned_alloc(64, (size_t)tree->capacity * sizeof(NameNode));
+    if (!nodes) return 0;
+    nodes[0] = tree->nodes[0];
+    for (int next = 1, at = 0; at < tree->count; at++) { // nodes[at] is placed; place its children at 'next'
+        int first = next;
+        for (int old = nodes[at].child; old != -1; old = tree->nodes[old].sibling) {
+            nodes[next] = tree->nodes[old];
+            nodes[next].sibling = tree->nodes[old].sibling != -1 ? next + 1 : -1;
+            next++;
+        }
+        nodes[at].child = next > first ? first : -1; // Old child numbers of nodes[first ..] are fixed when they are reached
+    }
+    free(tree->nodes);
+    tree->nodes = nodes;
+    return 1;
+}
+
+// Adds the name of record 'idx' (once the tree has been built). If out of memory the tree is dropped,
+// and the next lookup builds it again.
+static void namesAdd(int idx) {
+    if (store.names.count == 0) return; // Not built yet; loading does not pay for it
+    if (!namesInsert(&store.names, storeText(idx, FIELD_NAME))) namesDrop(&store.names);
+}
+
+// Fuzzy search state: the query and the best matches so far, closest first.
+typedef struct {
+    unsigned long long peq[256];
+    int length;
+    int radius;             // Current search radius (shrinks once 'max' matches are held)
+    NameMatch* out;
+    int count, max;
+} NameSearch;
+
+// Adds a name to the matches if it is among the 'max' closest so far (closest first, ties A-Z) and
+// some live record has it.
+static void namesKeep(NameSearch* search, const char* name, int distance) {
+    int pos = search->count;
+    while (pos > 0 && (search->out[pos - 1].distance > distance ||
+                       (search->out[pos - 1].distance == distance && strcmp(search->out[pos - 1].name, name) > 0))) {
+        pos--;
+    }
+    if (pos == search->max) return;
+    int students = 0; // Counted only now: this walks the records with the name
+    for (int i = storeNextByName(name, -1); i != -1; i = storeNextByName(name, i)) students++;
+    if (students == 0) return;
+    if (search->count < search->max) search->count++;
+    memmove(&search->out[pos + 1], &search->out[pos], (size_t)(search->count - 1 - pos) * sizeof(NameMatch));
+    snprintf(search->out[pos].name, NAME_LEN, "%s", name);
+    search->out[pos].distance = distance;
+    search->out[pos].students = students;
+    if (search->count == search->max) search->radius = search->out[search->max - 1].distance;
+}
+
+// Visits 'node' and those of its subtrees that can hold a name within the search radius.
+static void namesSearch(NameSearch* search, int node) {
+    const NameNode* nodes = store.names.nodes;
+    const char* text = nodes[node].name;
+    int d = nameDistance(search->peq, search->length, text);
+    if (d <= search->radius) namesKeep(search, text, d);
+    for (int child = nodes[node].child; child != -1 && nodes[child].distance <= d + search->radius; child = nodes[child].sibling) {
+        if (nodes[child].distance >= d - search->radius) namesSearch(search, child);
+    }
+}
+
+// Finds up to 'max' names of live records within FUZZY_MAX_DISTANCE edits of 'name' (case-insensitive),
+// closest first (ties A-Z). Returns the number found, or -1 if out of memory.
+int storeSimilarNames(const char* name, NameMatch* out, int max) {
+    pthread_mutex_lock(&namesLock);
+    int ok = 1;
+    if (store.names.count == 0) {
+        for (int i = 0; ok && i < store.count; i++) {
+            if (store.alive[i]) ok = namesInsert(&store.names, storeText(i, FIELD_NAME));
+        }
+        if (!ok) namesDrop(&store.names);
+        else namesRelayout(&store.names); // Best effort: a search works either way
+    }
+    NameSearch search;
+    char folded[NAME_LEN];
+    search.length = nameFold(name, folded);
+    namePattern(folded, search.peq);
+    search.out = out;
+    search.count = 0;
+    search.max = max;
+    // Close names are the common case, and a small radius prunes most of the tree: widen it only while
+    // fewer than 'max' names have been found
+    for (int radius = 1; ok && store.names.count > 0 && max > 0 && search.count < max && radius <= FUZZY_MAX_DISTANCE; radius++) {
+        search.radius = radius;
+        search.count = 0;
+        namesSearch(&search, 0);
+    }
+    pthread_mutex_unlock(&namesLock);
+    return ok ? search.count : -1;
+}
+
+// ---- Sorted views ----
+// Records can be listed in the order of a sort key: percentage and final fee highest first, date of birth
+// youngest first (records whose DOB is not a date last), name A-Z, ties in record order; 'reverse' lists
+// the other way round. The first full listing sorts the live
+// records once and keeps the order. Store changes are only queued (sortedNoteChange); the next listing
+// inserts the changed records at their new places with a binary search each, so repeated merit lists
+// do not sort the roster again. A top-K listing without an up-to-date order uses a bounded heap instead:
+// one pass over the records, O(n log k).
+
+static const char* sortKeyNames[SORT_KEYS] = { "percent", "finalfee", "name", "dob" };
+static pthread_mutex_t sortedLock = PTHREAD_MUTEX_INITIALIZER; // Server readers share the store; the views change under this
+
+// A record and the value of its sort key, so comparisons do not parse the percentage again.
+typedef struct {
+    float number;   // Percentage, final fee or packed date of birth (unused for SORT_NAME)
+    int idx;
+} SortItem;
+
+// Returns the SORT_* number of a key name (case-insensitive), or -1.
+int sortKeyNumber(const char* name) {
+    for (int k = 0; k < SORT_KEYS; k++) {
+        if (equalsIgnoreCase(sortKeyNames[k], name)) return k;
+    }
+    return -1;
+}
+
+static SortItem sortItem(int key, int idx) {
+    SortItem item = { 0.0f, idx };
+    if (key == SORT_PERCENT) item.number = strtof(storeText(idx, FIELD_PERCENT), NULL);
+    else if (key == SORT_FINAL_FEE) item.number = store.records[idx].finalFee;
+    else if (key == SORT_DOB) item.number = (float)store.records[idx].dob;
+    return item;
+}
+
+// Returns 1 if item a comes before item b in the order of 'key'.
+static int sortBefore(int key, const SortItem* a, const SortItem* b) {
+    if (key == SORT_NAME) {
+        int c = compareIgnoreCase(storeText(a->idx, FIELD_NAME), storeText(b->idx, FIELD_NAME));
+        if (c != 0) return c < 0;
+    } else if (a->number != b->number) {
+        return a->number > b->number; // Highest first
+    }
+    return a->idx < b->idx;
+}
+
+static int compareSortNumbers(const void* x, const void* y) {
+    const SortItem *a = x, *b = y;
+    if (a->number != b->number) return a->number > b->number ? -1 : 1;
+    return a->idx < b->idx ? -1 : a->idx > b->idx;
+}
+
+static int compareSortNames(const void* x, const void* y) {
+    const SortItem *a = x, *b = y;
+    int c = compareIgnoreCase(storeText(a->idx, FIELD_NAME), storeText(b->idx, FIELD_NAME));
+    if (c != 0) return c;
+    return a->idx < b->idx ? -1 : a->idx > b->idx;
+}
+
+// Frees a view; it is built again when next used.
+static void sortedDrop(SortedView* v) {
+    free(v->order);
+    free(v->pending);
+    memset(v, 0, sizeof(*v));
+}
+
+// Queues a change to record 'idx' (added, modified or deleted) for every built view. A view whose queue
+// outgrows a quarter of the roster is dropped instead: sorting afresh is then about as cheap.
+static void sortedNoteChange(int idx) {
+    for (int k = 0; k < SORT_KEYS; k++) {
+        SortedView* v = &store.sorted[k];
+        if (!v->order) continue;
+        if (v->pendingCount == v->pendingCapacity) {
+            int capacity = v->pendingCapacity ? v->pendingCapacity * 2 : 64;
+            int* pending = capacity <= store.liveCount / 4 + 64 ? realloc(v->pending, (size_t)capacity * sizeof(int)) : NULL;
+            if (!pending) {
+                sortedDrop(v);
+                continue;
+            }
+            v->pending = pending;
+            v->pendingCapacity = capacity;
+        }
+        v->pending[v->pendingCount++] = idx;
+    }
+}
+
+// Sorts the live records for view 'key'. Returns 0 if out of memory.
+static int sortedBuild(SortedView* v, int key) {
+    size_t room = (size_t)(store.liveCount > 0 ? store.liveCount : 1);
+    SortItem* items = malloc(room * sizeof(SortItem));
+    int* order = malloc(room * sizeof(int));
+    if (!items || !order) {
+        free(items);
+        free(order);
+        return 0;
+    }
+    int n = 0;
+    for (int i = storeNextLive(0); i < store.count; i = storeNextLive(i + 1)) items[n++] = sortItem(key, i);
+    qsort(items, (size_t)n, sizeof(SortItem), key == SORT_NAME ? compareSortNames : compareSortNumbers);
+    for (int i = 0; i < n; i++) order[i] = items[i].idx;
+    free(items);
+    sortedDrop(v);
+    v->order = order;
+    v->count = n;
+    return 1;
+}
+
+// Brings view 'key' up to date: sorts the roster the first time, afterwards merges the queued changes
+// into the kept order. Call with sortedLock held. Returns the view, or NULL if out of memory.
+static SortedView* sortedRefresh(int key) {
+    SortedView* v = &store.sorted[key];
+    if (!v->order) return sortedBuild(v, key) ? v : NULL;
+    if (v->pendingCount == 0) return v;
+
+    unsigned char* changed = calloc((size_t)store.count + 1, 1);
+    SortItem* fresh = malloc((size_t)v->pendingCount * sizeof(SortItem));
+    int* order = malloc((size_t)(store.liveCount > 0 ? store.liveCount : 1) * sizeof(int));
+    if (!changed || !fresh || !order) {
+        free(changed);
+        free(fresh);
+        free(order);
+        return sortedBuild(v, key) ? v : NULL;
+    }
+    int freshCount = 0, kept = 0;
+    for (int p = 0; p < v->pendingCount; p++) { // A record changed several times is placed once
+        int idx = v->pending[p];
+        if (changed[idx]) continue;
+        changed[idx] = 1;
+        if (store.alive[idx]) fresh[freshCount++] = sortItem(key, idx);
+    }
+    for (int i = 0; i < v->count; i++) { // The other records keep their relative order
+        if (!changed[v->order[i]]) v->order[kept++] = v->order[i];
+    }
+    qsort(fresh, (size_t)freshCount, sizeof(SortItem), key == SORT_NAME ? compareSortNames : compareSortNumbers);
+
+    int n = 0, from = 0;
+    for (int f = 0; f < freshCount; f++) {
+        int lo = from, hi = kept; // First kept record that does not come before fresh[f]
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            SortItem item = sortItem(key, v->order[mid]);
+            if (sortBefore(key, &item, &fresh[f])) lo = mid + 1; else hi = mid;
+        }
+        memcpy(order + n, v->order + from, (size_t)(lo - from) * sizeof(int));
+        n += lo - from;
+        from = lo;
+        order[n++] = fresh[f].idx;
+    }
+    memcpy(order + n, v->order + from, (size_t)(kept - from) * sizeof(int));
+    n += kept - from;
+
+    free(changed);
+    free(fresh);
+    free(v->order);
+    v->order = order;
+    v->count = n;
+    v->pendingCount = 0;
+    return v;
+}
+
+// Copies up to 'limit' record indices of the order of 'key' (reversed if 'reverse'), from position 'first'
+// on, into ids. Stores the number of live records in *total. Returns the count copied, or -1 if out of memory.
+int sortedPage(int key, int reverse, int first, int limit, int* ids, int* total) {
+    pthread_mutex_lock(&sortedLock);
+    SortedView* v = sortedRefresh(key);
+    int n = 0;
+    if (v) {
+        for (int pos = first; pos < v->count && n < limit; pos++) {
+            ids[n++] = reverse ? v->order[v->count - 1 - pos] : v->order[pos];
+        }
+        *total = v->count;
+    }
+    pthread_mutex_unlock(&sortedLock);
+    return v ? n : -1;
+}
+
+// sortBefore for a listing that may be reversed.
+static int topBefore(int key, int reverse, const SortItem* a, const SortItem* b) {
+    return reverse ? sortBefore(key, b, a) : sortBefore(key, a, b);
+}
+
+// Moves heap[i] down until no child comes after it. The root of the heap is the item that comes last.
+static void topSiftDown(int key, int reverse, SortItem* heap, int size, int i) {
+    while (1) {
+        int last = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && topBefore(key, reverse, &heap[last], &heap[left])) last = left;
+        if (right < size && topBefore(key, reverse, &heap[last], &heap[right])) last = right;
+        if (last == i) return;
+        SortItem t = heap[i];
+        heap[i] = heap[last];
+        heap[last] = t;
+        i = last;
+    }
+}
+
+// Writes the first k live records in the order of 'key' (reversed if 'reverse') to ids, in that order.
+// Reads them off the kept order when it is up to date, else keeps the best k in a bounded heap.
+// Returns the count (less than k if the roster is smaller), or -1 if out of memory.
+int sortedTop(int key, int reverse, int k, int* ids) {
+    if (k > store.liveCount) k = store.liveCount;
+    pthread_mutex_lock(&sortedLock);
+    SortedView* v = &store.sorted[key];
+    if (v->order && v->pendingCount == 0) {
+        for (int i = 0; i < k; i++) ids[i] = reverse ? v->order[v->count - 1 - i] : v->order[i];
+        pthread_mutex_unlock(&sortedLock);
+        return k;
+    }
+    pthread_mutex_unlock(&sortedLock);
+
+    SortItem* heap = malloc((size_t)(k > 0 ? k : 1) * sizeof(SortItem));
+    if (!heap) return -1;
+    int size = 0;
+    for (int i = storeNextLive(0); i < store.count && k > 0; i = storeNextLive(i + 1)) {
+        SortItem item = sortItem(key, i);
+        if (size < k) { // Sift up
+            int c = size++;
+            while (c > 0 && topBefore(key, reverse, &heap[(c - 1) / 2], &item)) {
+                heap[c] = heap[(c - 1) / 2];
+                c = (c - 1) / 2;
+            }
+            heap[c] = item;
+        } else if (topBefore(key, reverse, &item, &heap[0])) { // Beats the last of the best k
+            heap[0] = item;
+            topSiftDown(key, reverse, heap, size, 0);
+        }
+    }
+    for (int n = size; n > 0; n--) { // Take the last one off until the heap is empty
+        ids[n - 1] = heap[0].idx;
+        heap[0] = heap[n - 1];
+        topSiftDown(key, reverse, heap, n - 1, 0);
+    }
+    free(heap);
+    return size;
+}
+
+// ---- Date of birth ranges ----
+// The dob view doubles as the range index of the dates of birth: the students born in a date range are
+// one run of it, found with two binary searches, and an age histogram takes one search per bucket.
+
+// First position of the dob view whose record was born on or before 'date' (packed). Records without a
+// date, at the end of the view, count as born before any date. Call with sortedLock held.
+static int dobPosition(const SortedView* v, unsigned int date) {
+    int lo = 0, hi = v->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (store.records[v->order[mid]].dob > date) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// Counts the live records born from 'from' to 'to' (packed dates, inclusive). With 'out', also stores a
+// malloc'd array of their indices, youngest first, in *out (free it). Returns the count, or -1 if out of memory.
+int storeFindBorn(unsigned int from, unsigned int to, int** out) {
+    if (from == 0) from = 1; // 0 is no date
+    pthread_mutex_lock(&sortedLock);
+    SortedView* v = sortedRefresh(SORT_DOB);
+    int n = -1;
+    if (v) {
+        int first = dobPosition(v, to);
+        n = from > to ? 0 : dobPosition(v, from - 1) - first;
+        if (out) {
+            *out = malloc((size_t)(n > 0 ? n : 1) * sizeof(int));
+            if (*out) memcpy(*out, v->order + first, (size_t)n * sizeof(int));
+            else n = -1;
+        }
+    }
+    pthread_mutex_unlock(&sortedLock);
+    return n;
+}
+
+// Counts the live records by age on date 'on' (packed), in buckets of 'width' years: counts[b] gets those
+// aged b * width to (b + 1) * width - 1, for every bucket up to the oldest student's (at most maxBuckets).
+// Records without a date, born after 'on' or older than the last bucket are left out.
+// Returns the number of buckets filled, or -1 if out of memory.
+int storeAgeHistogram(unsigned int on, int width, long* counts, int maxBuckets) {
+    int year = (int)(on >> 9);
+    unsigned int monthDay = on & 511;
+    pthread_mutex_lock(&sortedLock);
+    SortedView* v = sortedRefresh(SORT_DOB);
+    if (!v) {
+        pthread_mutex_unlock(&sortedLock);
+        return -1;
+    }
+    int dated = dobPosition(v, 0); // Records with a date come first
+    int n = 0;
+    if (dated > 0) {
+        unsigned int oldest = store.records[v->order[dated - 1]].dob;
+        int oldestAge = year - (int)(oldest >> 9) - ((oldest & 511) > monthDay);
+        n = oldestAge < 0 ? 0 : oldestAge / width + 1 < maxBuckets ? oldestAge / width + 1 : maxBuckets;
+    }
+    int upper = dobPosition(v, on); // Born on or before 'on': at least 0 years old
+    for (int b = 0; b < n; b++) {
+        // Born on or before this birthday 'year - (b + 1) * width' years back: too old for bucket b
+        int born = year - (b + 1) * width;
+        int lower = born < 1 ? dated : dobPosition(v, (unsigned int)born << 9 | monthDay);
+        counts[b] = lower - upper;
+        upper = lower;
+    }
+    pthread_mutex_unlock(&sortedLock);
+    return n;
+}
+
+// ---- Trigram index ----
+// Every lowercase 3-byte substring of the indexed fields maps to the sorted list of records containing it.
+// A substring query only verifies the records present in the posting lists of all of its trigrams.
+// Entries are not removed when a record changes or is deleted; stale entries fail verification and
+// disappear when the lists are rebuilt: at a full load, and before the index snapshot is saved.
+
+// Course and domicile are not indexed: a search matches the term against their few dictionary values and
+// then compares record codes (see dictMatchCodes).
+static const int ngramFields[] = { FIELD_NAME, FIELD_MOTHER, FIELD_FATHER };
+
+// Key of the trigram starting at 'p' (already lowercase) in the given field.
+static unsigned int ngramKey(int field, const char* p) {
+    return (unsigned int)field << 24 | (unsigned int)(unsigned char)p[0] << 16 |
+           (unsigned int)(unsigned char)p[1] << 8 | (unsigned char)p[2];
+}
+
+// Returns the slot holding 'key', or the empty slot where it would go.
+static unsigned int ngramSlot(const TrigramIndex* index, unsigned int key) {
+    unsigned int slot = (key * 2654435761u) & index->mask;
+    while (index->keys[slot] != 0 && index->keys[slot] != key) {
+        slot = (slot + 1) & index->mask;
+    }
+    return slot;
+}
+
+// Allocates an empty trigram table.
+static int ngramInit(TrigramIndex* index) {
+    index->keys = calloc(NGRAM_INITIAL_SLOTS, sizeof(unsigned int));
+    index->lists = calloc(NGRAM_INITIAL_SLOTS, sizeof(PostingList));
+    index->mask = NGRAM_INITIAL_SLOTS - 1;
+    index->used = 0;
+    index->complete = 1;
+    index->stale = 0;
+    return index->keys && index->lists;
+}
+
+// Frees the table and all posting lists.
+static void ngramFree(TrigramIndex* index) {
+    if (index->lists) {
+        for (unsigned int i = 0; i <= index->mask; i++) free(index->lists[i].ids);
+    }
+    free(index->keys);
+    free(index->lists);
+    memset(index, 0, sizeof(*index));
+}
+
+// Doubles the table, moving every key and posting list to its new slot.
+static int ngramGrow(TrigramIndex* index) {
+    TrigramIndex bigger = *index;
+    bigger.mask = index->mask * 2 + 1;
+    bigger.keys = calloc(bigger.mask + 1, sizeof(unsigned int));
+    bigger.lists = calloc(bigger.mask + 1, sizeof(PostingList));
+    if (!bigger.keys || !bigger.lists) {
+        free(bigger.keys);
+        free(bigger.lists);
+        return 0;
+    }
+    for (unsigned int i = 0; i <= index->mask; i++) {
+        if (index->keys[i] == 0) continue;
+        unsigned int slot = ngramSlot(&bigger, index->keys[i]);
+        bigger.keys[slot] = index->keys[i];
+        bigger.lists[slot] = index->lists[i];
+    }
+    free(index->keys);
+    free(index->lists);
+    *index = bigger;
+    return 1;
+}
+
+// Adds record 'idx' to the posting list of 'key', keeping the list sorted and free of duplicates.
+static int ngramAdd(TrigramIndex* index, unsigned int key, int idx) {
+    if ((unsigned int)(index->used + 1) * 2 > index->mask + 1 && !ngramGrow(index)) return 0;
+    unsigned int slot = ngramSlot(index, key);
+    if (index->keys[slot] == 0) {
+        index->keys[slot] = key;
+        index->used++;
+    }
+    PostingList* list = &index->lists[slot];
+    if (list->count > 0 && list->ids[list->count - 1] >= idx) {
+        // Out-of-order insert (a modified record): find its place, skip if already present
+        int lo = 0, hi = list->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (list->ids[mid] < idx) lo = mid + 1; else hi = mid;
+        }
+        if (list->ids[lo] == idx) return 1;
+        if (list->count == list->capacity) {
+            int* ids = realloc(list->ids, (size_t)list->capacity * 2 * sizeof(int));
+            if (!ids) return 0;
+            list->ids = ids;
+            list->capacity *= 2;
+        }
+        memmove(&list->ids[lo + 1], &list->ids[lo], (size_t)(list->count - lo) * sizeof(int));
+        list->ids[lo] = idx;
+        list->count++;
+        return 1;
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        int* ids = realloc(list->ids, (size_t)capacity * sizeof(int));
+        if (!ids) return 0;
+        list->ids = ids;
+        list->capacity = capacity;
+    }
+    list->ids[list->count++] = idx; // Records are mostly added in index order: append
+    return 1;
+}
+
+// Returns the posting list of 'key', or NULL if no record contains it.
+static const PostingList* ngramFind(const TrigramIndex* index, unsigned int key) {
+    unsigned int slot = ngramSlot(index, key);
+    return index->keys[slot] ? &index->lists[slot] : NULL;
+}
+
+// Indexes every trigram of the indexed fields of record 'idx'.
+static void ngramIndexRecord(int idx) {
+    char lower[NAME_LEN];
+    for (size_t f = 0; f < sizeof(ngramFields) / sizeof(ngramFields[0]); f++) {
+        int field = ngramFields[f];
+        strncpy(lower, storeText(idx, field), sizeof(lower) - 1);
+        lower[sizeof(lower) - 1] = 0;
+        str_to_lower(lower);
+        for (int i = 0; lower[i] && lower[i + 1] && lower[i + 2]; i++) {
+            if (!ngramAdd(&store.ngrams, ngramKey(field, &lower[i]), idx)) {
+                store.ngrams.complete = 0; // Out of memory: searches fall back to scanning
+                return;
+            }
+        }
+    }
+}
+
+// Rebuilds the posting lists from the live records, without stale entries. Returns 0 if out of memory
+// (the old lists are then kept).
+static int ngramRebuild() {
+    TrigramIndex old = store.ngrams;
+    if (!ngramInit(&store.ngrams)) {
+        ngramFree(&store.ngrams);
+        store.ngrams = old;
+        return 0;
+    }
+    for (int i = 0; i < store.count && store.ngrams.complete; i++) {
+        if (store.alive[i]) ngramIndexRecord(i);
+    }
+    if (!store.ngrams.complete) {
+        ngramFree(&store.ngrams);
+        store.ngrams = old;
+        return 0;
+    }
+    ngramFree(&old);
+    return 1;
+}
+
+// Returns 1 if field 'field' of record 'idx' contains 'lowerTerm', ignoring case.
+static int fieldContains(int idx, int field, const char* lowerTerm) {
+    char lower[NAME_LEN];
+    strncpy(lower, storeText(idx, field), sizeof(lower) - 1);
+    lower[sizeof(lower) - 1] = 0;
+    str_to_lower(lower);
+    return strstr(lower, lowerTerm) != NULL;
+}
+
+// Returns 1 if 'id' is in the sorted posting list.
+static int postingContains(const PostingList* list, int id) {
+    int lo = 0, hi = list->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (list->ids[mid] < id) lo = mid + 1; else hi = mid;
+    }
+    return lo < list->count && list->ids[lo] == id;
+}
+
+// Upper bound on the records storeFindContaining(field, lowerTerm) returns, from the trigram index:
+// the length of the shortest posting list of the term's trigrams (it may include stale entries).
+// Returns -1 if the search cannot use the index and would scan every record.
+long storeEstimateContaining(int field, const char* lowerTerm) {
+    int termLen = (int)strlen(lowerTerm), indexed = 0;
+    for (size_t f = 0; f < sizeof(ngramFields) / sizeof(ngramFields[0]); f++) {
+        if (ngramFields[f] == field) indexed = 1;
+    }
+    if (!indexed || !store.ngrams.complete || termLen < NGRAM_LEN || termLen >= NAME_LEN) return -1;
+    long smallest = store.count;
+    for (int i = 0; i + NGRAM_LEN <= termLen; i++) {
+        const PostingList* list = ngramFind(&store.ngrams, ngramKey(field, &lowerTerm[i]));
+        if (!list) return 0; // Some trigram occurs nowhere
+        if (list->count < smallest) smallest = list->count;
+    }
+    return smallest;
+}
+
+// A substring search in progress: the term and the posting lists of its trigrams.
+typedef struct {
+    int field;
+    const char* lowerTerm;
+    const PostingList** lists;
+    int listCount, smallest;   // The candidates come from lists[smallest]
+    const unsigned char* codes; // Dictionary-encoded field: bitmap of the codes whose value contains the term
+} ContainsSearch;
+
+// filterRecords callback: 1 if candidate 'idx' is live, in every posting list and really contains the term.
+static int containsCandidate(const void* ctx, int idx) {
+    const ContainsSearch* search = ctx;
+    if (!store.alive[idx]) return 0;
+    if (search->codes) {
+        return codeMatches(search->codes, storeCode(idx, search->field));
+    }
+    for (int l = 0; l < search->listCount; l++) {
+        if (l != search->smallest && !postingContains(search->lists[l], idx)) return 0;
+    }
+    return fieldContains(idx, search->field, search->lowerTerm);
+}
+
+// Finds the live records whose 'field' contains 'lowerTerm' (lowercase), in record order.
+// Terms of NGRAM_LEN or more characters on an indexed field are answered from the trigram index; on
+// a dictionary-encoded field the scan compares codes only; others scan every record (on worker threads
+// when there are many). Stores a malloc'd array of record indices in *out (free it) and returns the count,
+// or -1 if out of memory.
+int storeFindContaining(int field, const char* lowerTerm, int** out) {
+    int termLen = (int)strlen(lowerTerm);
+    int indexed = 0;
+    for (size_t f = 0; f < sizeof(ngramFields) / sizeof(ngramFields[0]); f++) {
+        if (ngramFields[f] == field) indexed = 1;
+    }
+
+    const PostingList* lists[NAME_LEN];
+    int listCount = 0, smallest = 0;
+    unsigned char codes[DICT_CODE_BYTES];
+    int encoded = studentFields[field].dict != NULL;
+    if (encoded && dictMatchCodes(studentFields[field].dict, lowerTerm, 0, codes) == 0) { // No value contains the term
+        *out = malloc(sizeof(int));
+        return *out ? 0 : -1;
+    }
+    if (indexed && store.ngrams.complete && termLen >= NGRAM_LEN) {
+        for (int i = 0; i + NGRAM_LEN <= termLen; i++) {
+            const PostingList* list = ngramFind(&store.ngrams, ngramKey(field, &lowerTerm[i]));
+            if (!list) { // Some trigram occurs nowhere: no matches
+                *out = malloc(sizeof(int));
+                return *out ? 0 : -1;
+            }
+            if (listCount == 0 || list->count < lists[smallest]->count) smallest = listCount;
+            lists[listCount++] = list;
+        }
+    }
+
+    int candidates = listCount ? lists[smallest]->count : store.count;
+    int* result = malloc((size_t)(candidates > 0 ? candidates : 1) * sizeof(int));
+    if (!result) return -1;
+    for (int c = 0; c < candidates; c++) {
+        result[c] = listCount ? lists[smallest]->ids[c] : c;
+    }
+    ContainsSearch search = { field, lowerTerm, lists, listCount, smallest, encoded ? codes : NULL };
+    *out = result;
+    return filterRecords(result, candidates, containsCandidate, &search);
+}
+
+// Appends a record to the store and its indexes. Returns the new record index, or -1 if out of memory.
+// A record without an ID, or with one another record already has, is filed under ID 0 until
+// storeNumberRecords gives it one.
+int storeAdd(const StudentForm* s) {
+    if (!storeReserve() || !storePack(&store.records[store.count], s)) return -1;
+    int idx = store.count++;
+    store.alive[idx] = 1;
+    store.liveCount++;
+    if (store.lines) store.lines[idx] = store.lineCount++; // Appended to the end of the data file
+    if (s->id == 0 || storeFindById(s->id) != -1) {
+        store.records[idx].id = 0;
+        store.unnumbered++;
+    } else if (s->id >= store.nextId) {
+        store.nextId = s->id + 1;
+    }
+    indexInsert(&store.byId, idx);
+    indexInsert(&store.byMobile, idx);
+    indexInsert(&store.byName, idx);
+    ngramIndexRecord(idx);
+    applicantsAdd(idx);
+    namesAdd(idx);
+    aggregateRecord(&store.records[idx], 1);
+    sortedNoteChange(idx);
+    return idx;
+}
+
+// Replaces record 'idx' with new contents, re-filing it under its (possibly changed) keys.
+// The record keeps its ID, whatever s->id says. Returns 0 if out of memory (the record is then unchanged).
+int storeUpdate(int idx, const StudentForm* s) {
+    PackedStudent packed, old = store.records[idx];
+    if (!storePack(&packed, s)) return 0;
+    packed.id = old.id;
+    indexRemove(&store.byMobile, idx);
+    indexRemove(&store.byName, idx);
+    if (store.alive[idx]) {
+        aggregateRecord(&old, -1);
+        aggregateRecord(&packed, 1);
+    }
+    store.records[idx] = packed;
+    arenaRelease(&old);
+    indexInsert(&store.byMobile, idx);
+    indexInsert(&store.byName, idx);
+    ngramIndexRecord(idx); // Old trigrams stay listed; storeFindContaining re-checks every candidate
+    store.ngrams.stale++;
+    if (store.alive[idx]) applicantsAdd(idx); // Old keys stay set too; storeFindDuplicate confirms a match
+    if (store.alive[idx]) namesAdd(idx);      // So does the old name; storeSimilarNames skips it once unused
+    if (store.alive[idx]) sortedNoteChange(idx);
+    return 1;
+}
+
+// Marks record 'idx' deleted and drops it from the indexes.
+void storeRemove(int idx) {
+    if (!store.alive[idx]) return;
+    if (store.records[idx].id == 0) store.unnumbered--;
+    indexRemove(&store.byId, idx);
+    indexRemove(&store.byMobile, idx);
+    indexRemove(&store.byName, idx);
+    aggregateRecord(&store.records[idx], -1);
+    store.alive[idx] = 0;
+    store.liveCount--;
+    store.ngrams.stale++;
+    sortedNoteChange(idx);
+    arenaRelease(&store.records[idx]);
+}
+
+// Returns the live record with student ID 'id', or -1 if there is none.
+int storeFindById(unsigned int id) {
+    if (id == 0) return -1;
+    int idx = store.byId.heads[idKeyHash(id) & store.byId.mask];
+    while (idx != -1 && store.records[idx].id != id) {
+        idx = store.byId.next[idx];
+    }
+    return idx;
+}
+
+// Gives each live record loaded without an ID the next one, in slot order, so every live record has its
+// own. The caller saves them (see numberStudentRecords). Returns how many records were numbered.
+static int storeNumberRecords() {
+    int numbered = 0;
+    for (int i = 0; i < store.count && store.unnumbered > 0; i++) {
+        if (!store.alive[i] || store.records[i].id != 0) continue;
+        indexRemove(&store.byId, i);
+        store.records[i].id = store.nextId++;
+        indexInsert(&store.byId, i);
+        store.unnumbered--;
+        numbered++;
+    }
+    return numbered;
+}
+
+// Iterates live records whose name equals 'name' (case-insensitive).
+// Pass prev = -1 to get the first match, then the previous result to get the next one. Returns -1 when done.
+int storeNextByName(const char* name, int prev) {
+    int idx = prev == -1 ? store.byName.heads[hashString(name, 1) & store.byName.mask] : store.byName.next[prev];
+    while (idx != -1 && !equalsIgnoreCase(storeText(idx, FIELD_NAME), name)) {
+        idx = store.byName.next[idx];
+    }
+    return idx;
+}
+
+// Iterates live records with exactly the given mobile number (same protocol as storeNextByName).
+int storeNextByMobile(const char* mobile, int prev) {
+    int idx = prev == -1 ? store.byMobile.heads[hashString(mobile, 0) & store.byMobile.mask] : store.byMobile.next[prev];
+    while (idx != -1 && strcmp(storeText(idx, FIELD_MOBILE), mobile) != 0) {
+        idx = store.byMobile.next[idx];
+    }
+    return idx;
+}
+
+// Returns the first live record at or after 'slot', or store.count if there is none.
+// Paged listings resume from here instead of counting records from the top.
+int storeNextLive(int slot) {
+    if (slot < 0) slot = 0;
+    while (slot < store.count && !store.alive[slot]) slot++;
+    return slot;
+}
+
+// Returns the slot of live record number 'count' (0-based), or store.count if there are not that many.
+int storeSkipLive(int count) {
+    int slot = storeNextLive(0);
+    for (; count > 0 && slot < store.count; count--) slot = storeNextLive(slot + 1);
+    return slot;
+}
+
+// Reserves a slot that holds no record (a deleted record or an unparsable line).
+static int storeAddDead() {
+    if (!storeReserve()) return 0;
+    memset(&store.records[store.count], 0, sizeof(PackedStudent)); // No text in the arena
+    store.alive[store.count++] = 0; // Occupies a slot but is never shown or indexed
+    return 1;
+}
+
+// Reserves a slot for a data file line that could not be parsed, remembering its text.
+static int storeAddRaw(const char* text) {
+    if (!storeReserve()) return 0;
+    if (store.rawCount == store.rawCapacity) {
+        int newCapacity = store.rawCapacity ? store.rawCapacity * 2 : 16;
+        RawLine* raw = realloc(store.rawLines, (size_t)newCapacity * sizeof(RawLine));
+        if (!raw) return 0;
+        store.rawLines = raw;
+        store.rawCapacity = newCapacity;
+    }
+    char* copy = malloc(strlen(text) + 1);
+    if (!copy) return 0;
+    strcpy(copy, text);
+    store.rawLines[store.rawCount].slot = store.count;
+    store.rawLines[store.rawCount].text = copy;
+    store.rawCount++;
+    return storeAddDead();
+}
+
+// Reads the change log header "#LOG|<data file size>|<data file hash>", which records
+// the data file contents the log's slot numbers refer to. Returns 1 if the header is well formed.
+static int readLogHeader(FILE* log, long* baseBytes, unsigned int* baseHash) {
+    char line[MAX_LINE_LEN];
+    if (fgets(line, sizeof(line), log) == NULL) return 0;
+    metricsAdd(METRIC_READ, (long long)strlen(line));
+    return sscanf(line, "#LOG|%ld|%u", baseBytes, baseHash) == 2;
+}
+
+// Applies the records of the change log to the freshly loaded store.
+// Record formats: "U|<slot>|<student line>" (upsert) and "D|<slot>" (tombstone).
+// A torn final record (no trailing newline, e.g. after a crash) is cut off the log. Lines that are too
+// long or hold NUL bytes are skipped whole, like any other malformed record. Returns 0 if out of memory.
+static int replayChangeLog(FILE* log) {
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t got;
+    StudentForm s;
+    long goodBytes = ftell(log); // End of the last complete record (the header has been read)
+
+    while ((got = getline(&line, &capacity, log)) > 0) {
+        size_t len = (size_t)got; // Counts NUL bytes too, unlike strlen
+        if (line[len - 1] != '\n') break; // Only the last line can lack one: a torn write
+        goodBytes += (long)len;
+        metricsAdd(METRIC_READ, (long long)len);
+        metricsAdd(METRIC_ROWS, 1);
+        line[len - 1] = 0;
+
+        char* end;
+        long slot = line[0] && line[1] == '|' ? strtol(line + 2, &end, 10) : -1;
+        if (slot < 0 || end == line + 2 || slot >= store.count || !store.alive[slot] || strlen(line) + 1 != len) {
+            continue; // Malformed or refers to a record that no longer exists
+        }
+        if (line[0] == 'U' && *end == '|' && parseStudentLine(end + 1, &s)) {
+            if (!storeUpdate((int)slot, &s)) {
+                free(line);
+                return 0;
+            }
+        } else if (line[0] == 'D') {
+            storeRemove((int)slot);
+        }
+    }
+    free(line);
+    if (got < 0 && !feof(log)) return 0; // getline ran out of memory: keep the log as it is
+
+    store.logBytes = goodBytes;
+    if (!feof(log) || ftell(log) != goodBytes) {
+        fflush(log);
+        if (truncate(LOG_FILENAME, goodBytes) != 0) {
+            printf("Warning: Could not repair the change log '%s'.\n", LOG_FILENAME);
+        }
+    }
+    return 1;
+}
+
+// One line of the data file, parsed by a load worker.
+typedef struct {
+    StudentForm s;
+    const char* text;   // The line itself (NUL-terminated in the block), kept if it could not be parsed
+    int badField;       // 0, or the 1-based field that could not be parsed
+} LoadedLine;
+
+// A block of whole lines of the data file. Each worker parses the lines of its own newline-aligned byte range.
+typedef struct {
+    char* text;
+    size_t len;
+    size_t starts[MAX_WORKERS + 1];  // Worker w parses text[starts[w] .. starts[w + 1])
+    LoadedLine* lines[MAX_WORKERS];  // Lines parsed by each worker, in file order
+    int counts[MAX_WORKERS];
+    int failed;                      // Set if a worker ran out of memory
+} LoadBlock;
+
+// Worker: parses the lines in its byte range of the block.
+static void loadWorker(void* ctx, int worker, int workers) {
+    LoadBlock* block = ctx;
+    (void)workers;
+    char* p = block->text + block->starts[worker];
+    char* end = block->text + block->starts[worker + 1];
+    int capacity = 0;
+    block->lines[worker] = NULL;
+    block->counts[worker] = 0;
+    while (p < end) {
+        char* eol = memchr(p, '\n', (size_t)(end - p));
+        size_t len = eol ? (size_t)(eol - p) : (size_t)(end - p);
+        p[len] = 0; // The newline (or the spare byte after the block) becomes the terminator
+        if (block->counts[worker] == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            LoadedLine* grown = realloc(block->lines[worker], (size_t)capacity * sizeof(LoadedLine));
+            if (!grown) {
+                block->failed = 1;
+                return;
+            }
+            block->lines[worker] = grown;
+        }
+        LoadedLine* line = &block->lines[worker][block->counts[worker]++];
+        line->text = p;
+        line->badField = parseStudentFields(p, len, &line->s);
+        p += len + 1;
+    }
+}
+
+// Splits a block into newline-aligned ranges, one per worker, and parses them in parallel.
+static void parseLoadBlock(LoadBlock* block) {
+    int workers = workerCount();
+    if ((size_t)workers > block->len / LOAD_MIN_BYTES_PER_THREAD) workers = (int)(block->len / LOAD_MIN_BYTES_PER_THREAD);
+    if (workers < 1) workers = 1;
+    block->starts[0] = 0;
+    for (int w = 1; w < workers; w++) {
+        size_t start = block->len * (size_t)w / (size_t)workers;
+        if (start < block->starts[w - 1]) start = block->starts[w - 1];
+        char* nl = memchr(block->text + start, '\n', block->len - start);
+        block->starts[w] = nl ? (size_t)(nl - block->text) + 1 : block->len;
+    }
+    block->starts[workers] = block->len;
+    block->failed = 0;
+    for (int w = 0; w < MAX_WORKERS; w++) {
+        block->lines[w] = NULL;
+        block->counts[w] = 0;
+    }
+    runWorkers(workers, loadWorker, block);
+}
+
+// A crash in the middle of an append can leave the data file ending in part of a record. That line is cut
+// off, unless it happens to be a whole record that only lacks its newline, which is then added. Either way
+// the next append starts on a line of its own. Returns 0 if the file needed repair and could not be fixed.
+static int repairDataFileTail() {
+    FILE* fp = openFile(FILENAME, "r+");
+    if (!fp) return 1; // No data file yet
+    char tail[MAX_LINE_LEN];
+    long size = fseek(fp, 0, SEEK_END) == 0 ? ftell(fp) : -1;
+    long start = size > MAX_LINE_LEN - 1 ? size - (MAX_LINE_LEN - 1) : 0;
+    size_t n = size > 0 && fseek(fp, start, SEEK_SET) == 0 ? fread(tail, 1, (size_t)(size - start), fp) : 0;
+    metricsAdd(METRIC_READ, (long long)n);
+    if (n == 0 || tail[n - 1] == '\n') {
+        fclose(fp);
+        return size >= 0;
+    }
+    size_t lineStart = n;
+    while (lineStart > 0 && tail[lineStart - 1] != '\n') lineStart--;
+    StudentForm s;
+    int ok;
+    if (parseStudentFields(tail + lineStart, n - lineStart, &s) == 0 || (lineStart == 0 && start > 0)) {
+        ok = fseek(fp, 0, SEEK_END) == 0 && fputc('\n', fp) != EOF; // Complete (or too long to judge): keep it
+        metricsAdd(METRIC_WRITTEN, 1);
+        ok = fclose(fp) == 0 && ok;
+    } else {
+        fclose(fp);
+        ok = truncate(FILENAME, start + (long)lineStart) == 0;
+        if (ok) printf("Warning: The last line of '%s' was only partly written and has been removed.\n", FILENAME);
+    }
+    if (!ok) {
+        printf("Error: Could not repair the end of '%s'.\n", FILENAME);
+        perror("Reason");
+    }
+    return ok;
+}
+
+// ---- Index snapshot ----
+// A full load of the text storage parses every line and builds every index, so it takes time in
+// proportion to the roster. At exit the loaded store (records, arena, hash and trigram indexes, totals
+// and the sorted views built so far) is written out as is to SNAPSHOT_FILENAME, tagged with the data file
+// it was taken of: size, modification time, inode and a hash of its first and last SNAPSHOT_CHECK_BYTES.
+// The next load reads the arrays back and parses only what came after: data file lines appended past the
+// snapshot's size, and change log records past the part it already applied. A snapshot that does not
+// match the files (data file compacted, replaced or edited, a different change log) is ignored and the
+// roster loaded in full. Only the ends of the data file are hashed, since hashing all of it would make the
+// load proportional to the roster again: a same-length edit in the middle of a file that has also grown
+// since goes unnoticed. The Bloom filter and the BK-tree of names are not saved; they are built on first
+// use as before. Binary storage does not use a snapshot.
+
+// Hash of the first and the last SNAPSHOT_CHECK_BYTES of the first 'bytes' bytes of the data file: a sample
+// that tells the file a snapshot was taken of from a rewritten one. Returns 0 if the file cannot be read.
+static int dataFileCheck(FILE* fp, long bytes, unsigned int* check) {
+    char buf[4096];
+    long head = bytes < SNAPSHOT_CHECK_BYTES ? bytes : SNAPSHOT_CHECK_BYTES;
+    long ranges[2][2] = { { 0, head }, { bytes - SNAPSHOT_CHECK_BYTES > head ? bytes - SNAPSHOT_CHECK_BYTES : head, bytes } };
+    unsigned int h = 2166136261u;
+    for (int r = 0; r < 2; r++) {
+        if (ranges[r][0] < ranges[r][1] && fseek(fp, ranges[r][0], SEEK_SET) != 0) return 0;
+        for (long left = ranges[r][1] - ranges[r][0]; left > 0; ) {
+            size_t got = fread(buf, 1, left < (long)sizeof(buf) ? (size_t)left : sizeof(buf), fp);
+            if (got == 0) return 0;
+            metricsAdd(METRIC_READ, (long long)got);
+            h = hashBytes(h, buf, got);
+            left -= (long)got;
+        }
+    }
+    *check = h;
+    return 1;
+}
+
+// Modification time of a file in nanoseconds.
+static long long fileMtime(const struct stat* st) {
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static int snapshotWrite(FILE* fp, const void* data, size_t size) {
+    return size == 0 || fwrite(data, size, 1, fp) == 1;
+}
+
+static int snapshotRead(FILE* fp, void* data, size_t size) {
+    if (size > 0 && fread(data, size, 1, fp) != 1) return 0;
+    metricsAdd(METRIC_READ, (long long)size);
+    return 1;
+}
+
+// Writes the store to SNAPSHOT_FILENAME (via a temporary file), tagged with the data file and change log it
+// reflects. Call with the journal closed, so both files hold everything the store does. Returns 1 on success.
+static int saveSnapshot() {
+    SnapshotHeader h;
+    struct stat st;
+    memset(&h, 0, sizeof(h));
+    FILE* data = openFile(FILENAME, "rb");
+    int ok = data && fstat(fileno(data), &st) == 0 && st.st_size == store.baseBytes &&
+             dataFileCheck(data, store.baseBytes, &h.dataCheck);
+    if (data) fclose(data);
+    if (ok && store.logBytes > 0) { // Which change log the applied records came from
+        FILE* log = openFile(LOG_FILENAME, "r");
+        long baseBytes = -1;
+        ok = log && readLogHeader(log, &baseBytes, &h.logBaseHash) && fseek(log, 0, SEEK_END) == 0 && ftell(log) == store.logBytes;
+        h.logBaseBytes = baseBytes;
+        if (log) fclose(log);
+    }
+    if (!ok) return 0; // The files differ from what the store was loaded from
+    if (store.ngrams.stale > 0 && store.ngrams.complete && !ngramRebuild()) return 0; // Saved without stale entries
+
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.recordSize = sizeof(PackedStudent);
+    h.dataBytes = store.baseBytes;
+    h.dataMtime = fileMtime(&st);
+    h.dataInode = (unsigned long long)st.st_ino;
+    h.dataHash = store.baseHash;
+    h.logBytes = store.logBytes;
+    h.count = store.count;
+    h.liveCount = store.liveCount;
+    h.unnumbered = store.unnumbered;
+    h.rawCount = store.rawCount;
+    h.nextId = store.nextId;
+    const HashIndex* indexes[3] = { &store.byMobile, &store.byName, &store.byId };
+    for (int x = 0; x < 3; x++) h.indexMask[x] = indexes[x]->mask;
+    h.ngramMask = store.ngrams.mask;
+    h.ngramUsed = store.ngrams.used;
+    h.ngramComplete = store.ngrams.complete;
+    h.arenaBlocks = store.arena.blockCount;
+    h.arenaUsed = store.arena.used;
+    h.arenaBytes = store.arena.bytes;
+    h.arenaWasted = store.arena.wasted;
+    h.dictCount[0] = dictCount(&courseDict);
+    h.dictCount[1] = dictCount(&domicileDict);
+
+    pthread_mutex_lock(&sortedLock); // Views are saved up to date, with nothing pending
+    for (int k = 0; k < SORT_KEYS; k++) {
+        h.sortedCount[k] = store.sorted[k].order && sortedRefresh(k) ? store.sorted[k].count : -1;
+    }
+    FILE* fp = openFile(TEMP_SNAPSHOT_FILENAME, "wb");
+    ok = fp != NULL;
+    if (ok) setvbuf(fp, NULL, _IOFBF, IMPORT_WRITE_BUFFER);
+    ok = ok && snapshotWrite(fp, &h, sizeof(h));
+    for (int d = 0; d < 2; d++) {
+        for (int c = 0; ok && c < h.dictCount[d]; c++) {
+            ok = snapshotWrite(fp, dictText(d == 0 ? &courseDict : &domicileDict, c), DICT_VALUE_LEN);
+        }
+    }
+    ok = ok && snapshotWrite(fp, store.records, (size_t)store.count * sizeof(PackedStudent)) &&
+         snapshotWrite(fp, store.alive, (size_t)store.count);
+    for (int b = 0; ok && b < store.arena.blockCount; b++) {
+        ok = snapshotWrite(fp, store.arena.blocks[b], b + 1 < store.arena.blockCount ? ARENA_BLOCK_BYTES : store.arena.used);
+    }
+    for (int x = 0; ok && x < 3; x++) {
+        ok = snapshotWrite(fp, indexes[x]->heads, ((size_t)indexes[x]->mask + 1) * sizeof(int)) &&
+             snapshotWrite(fp, indexes[x]->next, (size_t)store.count * sizeof(int));
+    }
+    ok = ok && snapshotWrite(fp, store.ngrams.keys, ((size_t)store.ngrams.mask + 1) * sizeof(unsigned int));
+    for (unsigned int i = 0; ok && i <= store.ngrams.mask; i++) {
+        const PostingList* list = &store.ngrams.lists[i];
+        ok = snapshotWrite(fp, &list->count, sizeof(int)) && snapshotWrite(fp, list->ids, (size_t)list->count * sizeof(int));
+    }
+    ok = ok && snapshotWrite(fp, &store.totals, sizeof(store.totals));
+    for (int r = 0; ok && r < store.rawCount; r++) {
+        int len = (int)strlen(store.rawLines[r].text);
+        ok = snapshotWrite(fp, &store.rawLines[r].slot, sizeof(int)) && snapshotWrite(fp, &len, sizeof(int)) &&
+             snapshotWrite(fp, store.rawLines[r].text, (size_t)len);
+    }
+    for (int k = 0; ok && k < SORT_KEYS; k++) {
+        if (h.sortedCount[k] > 0) ok = snapshotWrite(fp, store.sorted[k].order, (size_t)h.sortedCount[k] * sizeof(int));
+    }
+    pthread_mutex_unlock(&sortedLock);
+    if (fp) metricsAdd(METRIC_WRITTEN, ftell(fp));
+    if (fp && fclose(fp) != 0) ok = 0;
+    if (!ok || renameFile(TEMP_SNAPSHOT_FILENAME, SNAPSHOT_FILENAME) != 0) {
+        remove(TEMP_SNAPSHOT_FILENAME);
+        return 0;
+    }
+    store.snapshotData = store.baseBytes;
+    store.snapshotLog = store.logBytes;
+    return 1;
+}
+
+// 1 if snapshot header h was taken of the data file as it is now, or of the same file before more lines
+// were appended, and its change log records are (the start of) the current change log, whose header is
+// logBaseBytes/logBaseHash (logBaseBytes -1: there is no usable log) and size logSize.
+static int snapshotMatches(const SnapshotHeader* h, long logBaseBytes, unsigned int logBaseHash, long logSize) {
+    struct stat st;
+    unsigned int check;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 || h->version != SNAPSHOT_VERSION ||
+        h->recordSize != sizeof(PackedStudent) || h->count < 0 || h->count >= INT_MAX / 2 ||
+        h->arenaBlocks < 0 || h->arenaBlocks > ARENA_MAX_BLOCKS) return 0;
+    if (h->logBytes > 0 ? logBaseBytes != h->logBaseBytes || logBaseHash != h->logBaseHash || logSize < h->logBytes
+                        : logBaseBytes >= 0 && logBaseBytes < h->dataBytes) return 0;
+    FILE* data = openFile(FILENAME, "rb");
+    int ok = data && fstat(fileno(data), &st) == 0 && (unsigned long long)st.st_ino == h->dataInode &&
+             (st.st_size > h->dataBytes || (st.st_size == h->dataBytes && fileMtime(&st) == h->dataMtime)) &&
+             dataFileCheck(data, (long)h->dataBytes, &check) && check == h->dataCheck;
+    if (data) fclose(data);
+    return ok;
+}
+
+// Reads the arrays after snapshot header h into the store, replacing the empty ones of storeInit.
+// Returns 0 if the file is short or memory runs out (the store then holds part of the snapshot).
+static int readSnapshotBody(FILE* fp, const SnapshotHeader* h) {
+    // Course and domicile codes: the snapshot's, translated to this run's (the same unless the
+    // dictionaries already held values, in another order)
+    static unsigned short codeMap[2][DICT_MAX_ENTRIES];
+    int remap = 0;
+    for (int d = 0; d < 2; d++) {
+        if (h->dictCount[d] < 0 || h->dictCount[d] > DICT_MAX_ENTRIES) return 0;
+        for (int c = 0; c < h->dictCount[d]; c++) {
+            char value[DICT_VALUE_LEN];
+            if (!snapshotRead(fp, value, sizeof(value))) return 0;
+            value[sizeof(value) - 1] = 0;
+            int code = dictIntern(d == 0 ? &courseDict : &domicileDict, value, strlen(value));
+            if (code < 0) return 0;
+            codeMap[d][c] = (unsigned short)code;
+            remap |= code != c;
+        }
+    }
+
+    int capacity = STORE_INITIAL_CAPACITY;
+    while (capacity <= h->count) capacity *= 2;
+    free(store.records);
+    free(store.alive);
+    store.records = malloc((size_t)capacity * sizeof(PackedStudent));
+    store.alive = malloc((size_t)capacity);
+    store.capacity = capacity;
+    if (!store.records || !store.alive || !snapshotRead(fp, store.records, (size_t)h->count * sizeof(PackedStudent)) ||
+        !snapshotRead(fp, store.alive, (size_t)h->count)) return 0;
+    store.count = h->count;
+    for (int b = 0; b < h->arenaBlocks; b++) {
+        char* block = malloc(ARENA_BLOCK_BYTES);
+        if (!block) return 0;
+        store.arena.blocks[store.arena.blockCount++] = block;
+        if (!snapshotRead(fp, block, b + 1 < h->arenaBlocks ? ARENA_BLOCK_BYTES : h->arenaUsed)) return 0;
+    }
+    store.arena.used = h->arenaUsed;
+    store.arena.bytes = h->arenaBytes;
+    store.arena.wasted = h->arenaWasted;
+
+    HashIndex* indexes[3] = { &store.byMobile, &store.byName, &store.byId };
+    for (int x = 0; x < 3; x++) {
+        if (h->indexMask[x] & (h->indexMask[x] + 1)) return 0; // Not a power of two - 1
+        free(indexes[x]->heads);
+        free(indexes[x]->next);
+        indexes[x]->heads = malloc(((size_t)h->indexMask[x] + 1) * sizeof(int));
+        indexes[x]->next = malloc((size_t)capacity * sizeof(int));
+        indexes[x]->mask = h->indexMask[x];
+        if (!indexes[x]->heads || !indexes[x]->next ||
+            !snapshotRead(fp, indexes[x]->heads, ((size_t)h->indexMask[x] + 1) * sizeof(int)) ||
+            !snapshotRead(fp, indexes[x]->next, (size_t)h->count * sizeof(int))) return 0;
+    }
+
+    if (h->ngramMask & (h->ngramMask + 1)) return 0;
+    ngramFree(&store.ngrams);
+    store.ngrams.keys = malloc(((size_t)h->ngramMask + 1) * sizeof(unsigned int));
+    store.ngrams.lists = calloc((size_t)h->ngramMask + 1, sizeof(PostingList));
+    store.ngrams.mask = h->ngramMask;
+    store.ngrams.used = h->ngramUsed;
+    store.ngrams.complete = h->ngramComplete;
+    if (!store.ngrams.keys || !store.ngrams.lists ||
+        !snapshotRead(fp, store.ngrams.keys, ((size_t)h->ngramMask + 1) * sizeof(unsigned int))) return 0;
+    for (unsigned int i = 0; i <= h->ngramMask; i++) {
+        PostingList* list = &store.ngrams.lists[i];
+        int count;
+        if (!snapshotRead(fp, &count, sizeof(int)) || count < 0) return 0;
+        if (count == 0) continue;
+        list->ids = malloc((size_t)count * sizeof(int));
+        if (!list->ids) return 0;
+        list->count = list->capacity = count;
+        if (!snapshotRead(fp, list->ids, (size_t)count * sizeof(int))) return 0;
+    }
+
+    if (!snapshotRead(fp, &store.totals, sizeof(store.totals))) return 0;
+    for (int r = 0; r < h->rawCount; r++) {
+        int slot, len;
+        if (!snapshotRead(fp, &slot, sizeof(int)) || !snapshotRead(fp, &len, sizeof(int)) || len < 0 || len >= MAX_LINE_LEN) return 0;
+        if (store.rawCount == store.rawCapacity) {
+            int newCapacity = store.rawCapacity ? store.rawCapacity * 2 : 16;
+            RawLine* raw = realloc(store.rawLines, (size_t)newCapacity * sizeof(RawLine));
+            if (!raw) return 0;
+            store.rawLines = raw;
+            store.rawCapacity = newCapacity;
+        }
+        char* text = malloc((size_t)len + 1);
+        if (!text) return 0;
+        store.rawLines[store.rawCount].slot = slot;
+        store.rawLines[store.rawCount++].text = text;
+        if (!snapshotRead(fp, text, (size_t)len)) return 0;
+        text[len] = 0;
+    }
+    for (int k = 0; k < SORT_KEYS; k++) {
+        if (h->sortedCount[k] < 0) continue;
+        SortedView* v = &store.sorted[k];
+        v->order = malloc((size_t)(h->sortedCount[k] > 0 ? h->sortedCount[k] : 1) * sizeof(int));
+        if (!v->order) return 0;
+        v->count = h->sortedCount[k];
+        if (!snapshotRead(fp, v->order, (size_t)v->count * sizeof(int))) return 0;
+    }
+
+    if (remap) {
+        for (int i = 0; i < store.count; i++) {
+            store.records[i].courseCode = codeMap[0][store.records[i].courseCode];
+            store.records[i].domicileCode = codeMap[1][store.records[i].domicileCode];
+        }
+        memset(store.totals.courseGroup, 0, sizeof(store.totals.courseGroup)); // Looked up again by name
+        memset(store.totals.domicileGroup, 0, sizeof(store.totals.domicileGroup));
+    }
+    store.liveCount = h->liveCount;
+    store.unnumbered = h->unnumbered;
+    store.nextId = h->nextId;
+    store.baseBytes = (long)h->dataBytes;
+    store.baseHash = h->dataHash;
+    store.snapshotData = (long)h->dataBytes;
+    store.snapshotLog = (long)h->logBytes;
+    return 1;
+}
+
+// Loads SNAPSHOT_FILENAME into the (empty) store if it matches the data file and change log (see
+// snapshotMatches; the arguments describe the change log). Sets *logFrom to the change log offset the
+// replay continues from (0: right after the header). Returns 1 if the snapshot was loaded, 0 if there is
+// none to use (the store is then empty), or -1 if out of memory.
+static int loadSnapshot(long logBaseBytes, unsigned int logBaseHash, long logSize, long* logFrom) {
+    SnapshotHeader h;
+    FILE* fp = openFile(SNAPSHOT_FILENAME, "rb");
+    *logFrom = 0;
+    if (!fp) return 0;
+    if (!snapshotRead(fp, &h, sizeof(h)) || !snapshotMatches(&h, logBaseBytes, logBaseHash, logSize)) {
+        fclose(fp);
+        return 0;
+    }
+    setvbuf(fp, NULL, _IOFBF, IMPORT_WRITE_BUFFER);
+    int ok = readSnapshotBody(fp, &h) && fgetc(fp) == EOF; // A longer file is not one saveSnapshot wrote
+    fclose(fp);
+    if (!ok) { // Start over with an empty store and load in full
+        freeStudentStore();
+        return storeInit() ? 0 : -1;
+    }
+    *logFrom = (long)h.logBytes;
+    return 1;
+}
+
+// Loads the text data file into the (empty) store, then applies the change log.
+static int loadTextStorage() {
+    store.baseHash = 2166136261u;
+
+    // The log only applies to the data file it was written against; remember which one that was
+    FILE* log = openFile(LOG_FILENAME, "r");
+    long logBaseBytes = -1;
+    unsigned int logBaseHash = 0, prefixHash = 0;
+    if (log && !readLogHeader(log, &logBaseBytes, &logBaseHash)) {
+        logBaseBytes = -1;
+    }
+    struct stat logStat;
+    long logSize = log && fstat(fileno(log), &logStat) == 0 ? (long)logStat.st_size : 0;
+
+    if (!repairDataFileTail()) {
+        if (log) fclose(log);
+        return 0;
+    }
+    // Start from the snapshot if there is a current one: only what was written after it is parsed below
+    long logFrom = 0;
+    int fromSnapshot = loadSnapshot(logBaseBytes, logBaseHash, logSize, &logFrom);
+    if (fromSnapshot < 0) {
+        printf("Error: Not enough memory to load all student records.\n");
+        if (log) fclose(log);
+        return 0;
+    }
+    if (logFrom > 0) prefixHash = logBaseHash; // The snapshot holds the log's data file and checked it
+    else if (logBaseBytes == store.baseBytes) prefixHash = store.baseHash;
+
+    FILE* fp = openFile(FILENAME, "r");
+    if (fp && fseek(fp, store.baseBytes, SEEK_SET) != 0) {
+        fclose(fp);
+        fp = NULL;
+    }
+    if (fp) {
+        // The file is read in blocks of whole lines; the lines of a block are parsed on worker threads
+        // and added to the store in file order
+        size_t capacity = LOAD_BLOCK_BYTES, carry = 0;
+        char* buf = malloc(capacity + 1); // + 1: room for the terminator of a last line without a newline
+        int badLines = 0, firstBadLine = 0, firstBadField = 0;
+        int ok = buf != NULL, eof = 0;
+        while (ok && !eof) {
+            size_t got = fread(buf + carry, 1, capacity - carry, fp);
+            metricsAdd(METRIC_READ, (long long)got);
+            size_t len = carry + got;
+            eof = got < capacity - carry;
+            size_t whole = len; // Bytes of complete lines; the rest is carried into the next block
+            if (!eof) {
+                while (whole > 0 && buf[whole - 1] != '\n') whole--;
+                if (whole == 0) { // One line fills the whole buffer: make room for more of it
+                    char* grown = realloc(buf, capacity * 2 + 1);
+                    if (!grown) { ok = 0; break; }
+                    buf = grown;
+                    capacity *= 2;
+                    carry = len;
+                    continue;
+                }
+            }
+            if (whole == 0) break;
+
+            size_t split = whole; // The log's data file may end inside this block, at the end of a line
+            if (logBaseBytes > store.baseBytes && logBaseBytes < store.baseBytes + (long)whole &&
+                buf[logBaseBytes - store.baseBytes - 1] == '\n') {
+                split = (size_t)(logBaseBytes - store.baseBytes);
+            }
+            store.baseHash = hashBytes(store.baseHash, buf, split);
+            if (split < whole) {
+                prefixHash = store.baseHash;
+                store.baseHash = hashBytes(store.baseHash, buf + split, whole - split);
+            }
+            store.baseBytes += (long)whole;
+            if (store.baseBytes == logBaseBytes) prefixHash = store.baseHash;
+
+            LoadBlock block;
+            block.text = buf;
+            block.len = whole;
+            parseLoadBlock(&block);
+            ok = !block.failed;
+            for (int w = 0; w < MAX_WORKERS; w++) {
+                for (int i = 0; ok && i < block.counts[w]; i++) {
+                    const LoadedLine* line = &block.lines[w][i];
+                    unsigned int nextId;
+                    if (line->badField && store.count == 0 && sscanf(line->text, "#IDS|%u", &nextId) == 1) {
+                        if (nextId > store.nextId) store.nextId = nextId; // See writeTextDataFile
+                        ok = storeAddDead();
+                        continue;
+                    }
+                    if (line->badField && badLines++ == 0) {
+                        firstBadLine = store.count + 1;
+                        firstBadField = line->badField;
+                    }
+                    ok = line->badField == 0 ? storeAdd(&line->s) != -1 : storeAddRaw(line->text);
+                }
+                metricsAdd(METRIC_ROWS, block.counts[w]);
+                free(block.lines[w]);
+            }
+            carry = len - whole;
+            memmove(buf, buf + whole, carry);
+        }
+        free(buf);
+        fclose(fp);
+        if (!ok) {
+            printf("Error: Not enough memory to load all student records.\n");
+            if (log) fclose(log);
+            return 0;
+        }
+        if (badLines > 0) {
+            printf("Warning: %d line(s) of '%s' could not be read and were skipped (first: line %d, field '%s').\n",
+                   badLines, FILENAME, firstBadLine, studentFieldName(firstBadField));
+        }
+    }
+
+    if (log) {
+        if (logBaseBytes >= 0 && logBaseBytes <= store.baseBytes && prefixHash == logBaseHash &&
+            (logFrom == 0 || fseek(log, logFrom, SEEK_SET) == 0)) {
+            int replayed = replayChangeLog(log);
+            fclose(log);
+            if (!replayed) {
+                printf("Error: Not enough memory to load all student records.\n");
+                return 0;
+            }
+        } else {
+            // Written against a data file that has since been compacted or replaced: its changes are already merged
+            fclose(log);
+            remove(LOG_FILENAME);
+        }
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Binary storage
+// ---------------------------------------------------------------------------------------------
+// Optional storage mode: a header, the course and domicile dictionaries, then fixed-size BinarySlot records,
+// memory-mapped for random access. Loading is a walk over the slots (no parsing), and modify/delete rewrite
+// a single slot in place and sync only the page(s) it lives on. The text file stays the import/export format.
+
+static int binaryStorage;   // 1 when the roster lives in BIN_FILENAME instead of FILENAME
+static int binFd = -1;      // Open binary storage file
+static char* binMap;        // Mapping of the whole binary storage file
+static size_t binMapSize;   // Size of the mapping (== file size)
+static ValueDict* const binDicts[2] = { &courseDict, &domicileDict }; // In-memory dictionary of each file table
+static unsigned short binToStore[2][BIN_DICT_ENTRIES];  // File code -> in-memory code
+static unsigned short storeToBin[2][DICT_MAX_ENTRIES];  // In-memory code -> file code + 1 (0: not in the file yet)
+
+// Returns the header of the mapped binary file.
+static BinaryHeader* binHeader() {
+    return (BinaryHeader*)binMap;
+}
+
+// Returns the course and domicile tables of the mapped binary file.
+static BinaryDictionary* binDictionary() {
+    return (BinaryDictionary*)(binMap + sizeof(BinaryHeader));
+}
+
+// Returns slot 'idx' of the mapped binary file.
+static BinarySlot* binSlot(int idx) {
+    return (BinarySlot*)(binMap + BIN_SLOTS_OFFSET + (size_t)idx * sizeof(BinarySlot));
+}
+
+// Number of slots the mapped file has room for.
+static unsigned int binSlotCapacity() {
+    return (unsigned int)((binMapSize - BIN_SLOTS_OFFSET) / sizeof(BinarySlot));
+}
+
+// Flushes a modified range of the mapping to disk, rounded out to whole pages as msync requires.
+static int binSync(const void* addr, size_t len) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = ((size_t)((const char*)addr - binMap)) / page * page;
+    size_t end = (size_t)((const char*)addr - binMap) + len;
+    metricsAdd(METRIC_WRITTEN, (long long)(end - start));
+    metricsAdd(METRIC_SYNCS, 1);
+    return msync(binMap + start, end - start, MS_SYNC) == 0;
+}
+
+// Unmaps and closes the binary storage file (safe to call when nothing is open).
+static void closeBinaryFile() {
+    if (binMap) munmap(binMap, binMapSize);
+    if (binFd != -1) close(binFd);
+    binMap = NULL;
+    binMapSize = 0;
+    binFd = -1;
+}
+
+// Maps 'size' bytes of the open binary file. Returns 1 on success.
+static int mapBinaryFile(size_t size) {
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, binFd, 0);
+    if (map == MAP_FAILED) return 0;
+    binMap = map;
+    binMapSize = size;
+    return 1;
+}
+
+// Interns the values of the file's course and domicile tables and records how their codes map to
+// the in-memory ones. Returns 0 if a table is malformed or does not fit the in-memory dictionary.
+static int binReadDictionaries() {
+    memset(storeToBin, 0, sizeof(storeToBin));
+    for (int t = 0; t < 2; t++) {
+        unsigned int count = binHeader()->dictCount[t];
+        if (count > BIN_DICT_ENTRIES) return 0;
+        for (unsigned int i = 0; i < count; i++) {
+            const char* value = binDictionary()->values[t][i];
+            size_t len = strnlen(value, DICT_VALUE_LEN);
+            int code = len < DICT_VALUE_LEN ? dictIntern(binDicts[t], value, len) : -1;
+            if (code < 0) return 0;
+            binToStore[t][i] = (unsigned short)code;
+            storeToBin[t][code] = (unsigned short)(i + 1);
+        }
+    }
+    return 1;
+}
+
+// Writes the header and the dictionaries of a new binary file: a copy of the in-memory dictionaries,
+// so the records that follow keep their in-memory codes. Returns 1 on success.
+static int writeBinaryHeader(FILE* fp, unsigned int recordCount, unsigned int nextId) {
+    static BinaryDictionary dict; // Large; zeroed here so no stray bytes reach the file
+    BinaryHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BIN_MAGIC, sizeof(h.magic));
+    h.version = BIN_SCHEMA_VERSION;
+    h.headerSize = sizeof(BinaryHeader);
+    h.slotSize = sizeof(BinarySlot);
+    h.recordCount = recordCount;
+    h.nextId = nextId;
+    memset(&dict, 0, sizeof(dict));
+    for (int t = 0; t < 2; t++) {
+        h.dictCount[t] = (unsigned int)dictCount(binDicts[t]);
+        if (h.dictCount[t] > BIN_DICT_ENTRIES) {
+            printf("Error: Binary storage holds at most %d different %s; %u are on record.\n", BIN_DICT_ENTRIES,
+                   t == 0 ? "courses" : "domiciles", h.dictCount[t]);
+            return 0;
+        }
+        for (unsigned int i = 0; i < h.dictCount[t]; i++) strcpy(dict.values[t][i], dictText(binDicts[t], (int)i));
+    }
+    return fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(&dict, sizeof(dict), 1, fp) == 1;
+}
+
+// Converts a record of schema version 1. Returns 0 if its course or domicile does not fit the dictionaries.
+static int studentFromV1(const StudentFormV1* old, StudentForm* s) {
+    memset(s, 0, sizeof(*s));
+    memcpy(s->name, old->name, sizeof(s->name));
+    memcpy(s->mother, old->mother, sizeof(s->mother));
+    memcpy(s->father, old->father, sizeof(s->father));
+    memcpy(s->mobile, old->mobile, sizeof(s->mobile));
+    memcpy(s->percent, old->percent, sizeof(s->percent));
+    memcpy(s->dob, old->dob, sizeof(s->dob));
+    s->totalFee = old->totalFee;
+    s->discount = old->discount;
+    s->domicileDiscount = old->domicileDiscount;
+    s->finalFee = old->finalFee;
+    return setStudentText(s, FIELD_DOMICILE, old->domicile, strnlen(old->domicile, DOMICILE_LEN - 1)) &&
+           setStudentText(s, FIELD_COURSE, old->course, strnlen(old->course, COURSE_LEN - 1));
+}
+
+// Reads slot 'i' of the mapped file of schema version 1 or 2 into *flags and, if it is live, *s, which
+// gets student ID i + 1 (those files predate IDs). Returns 0 if the record's course or domicile does
+// not fit the in-memory dictionaries (version 1) or is not in the file's own (version 2).
+static int readOldBinarySlot(unsigned int version, unsigned int i, unsigned int* flags, StudentForm* s) {
+    if (version == 1) {
+        const BinarySlotV1* old = (const BinarySlotV1*)(binMap + sizeof(BinaryHeader)) + i;
+        *flags = old->flags;
+        if ((*flags & BIN_SLOT_LIVE) && !studentFromV1(&old->s, s)) return 0;
+    } else {
+        const char* old = binMap + BIN_SLOTS_OFFSET + (size_t)i * BIN_SLOT_V2_SIZE;
+        memcpy(flags, old, sizeof(*flags));
+        if (*flags & BIN_SLOT_LIVE) {
+            memcpy(s, old + sizeof(*flags), offsetof(StudentForm, id));
+            if (s->courseCode >= binHeader()->dictCount[0] || s->domicileCode >= binHeader()->dictCount[1]) return 0;
+            s->courseCode = binToStore[0][s->courseCode];
+            s->domicileCode = binToStore[1][s->domicileCode];
+        }
+    }
+    if (*flags & BIN_SLOT_LIVE) s->id = i + 1;
+    return 1;
+}
+
+// Rewrites the mapped file of schema version 1 or 2 as the current version, slot for slot (deleted slots
+// included, so record indices do not change), and replaces BIN_FILENAME with it. The mapping is closed either way.
+static int migrateBinaryFile(unsigned int version) {
+    unsigned int count = binHeader()->recordCount, flags;
+    StudentForm s;
+    int ok = version == 1 || binReadDictionaries();
+    for (unsigned int i = 0; ok && i < count; i++) { // Intern every value first: the header copies the dictionaries
+        ok = readOldBinarySlot(version, i, &flags, &s);
+    }
+    FILE* fp = ok ? openFile(TEMP_BIN_FILENAME, "wb") : NULL;
+    if (fp) {
+        ok = writeBinaryHeader(fp, count, count + 1);
+        BinarySlot slot;
+        for (unsigned int i = 0; ok && i < count; i++) {
+            memset(&slot, 0, sizeof(slot));
+            readOldBinarySlot(version, i, &slot.flags, &slot.s);
+            ok = fwrite(&slot, sizeof(slot), 1, fp) == 1;
+        }
+        ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0 && ok;
+        metricsAdd(METRIC_WRITTEN, ftell(fp));
+        metricsAdd(METRIC_SYNCS, 1);
+        ok = fclose(fp) == 0 && ok;
+    } else {
+        ok = 0;
+    }
+    closeBinaryFile();
+    if (!ok || renameFile(TEMP_BIN_FILENAME, BIN_FILENAME) != 0) {
+        printf("Error: Could not upgrade '%s' to schema version %d.\n", BIN_FILENAME, BIN_SCHEMA_VERSION);
+        perror("Reason");
+        remove(TEMP_BIN_FILENAME);
+        return 0;
+    }
+    printf("Upgraded '%s' to schema version %d (%u slots).\n", BIN_FILENAME, BIN_SCHEMA_VERSION, count);
+    return 1;
+}
+
+// Opens and maps BIN_FILENAME, checking its header and reading its dictionaries. A file of schema
+// version 1 or 2 is upgraded first. Returns 1 on success.
+static int openBinaryFile() {
+    struct stat st;
+    binFd = open(BIN_FILENAME, O_RDWR);
+    metricsAdd(METRIC_OPENS, 1);
+    if (binFd == -1 || fstat(binFd, &st) != 0 || (size_t)st.st_size < sizeof(BinaryHeader) ||
+        !mapBinaryFile((size_t)st.st_size)) {
+        printf("Error: Could not open binary storage file '%s'.\n", BIN_FILENAME);
+        closeBinaryFile();
+        return 0;
+    }
+    metricsAdd(METRIC_READ, st.st_size); // Mapped: read as the slots are walked
+    BinaryHeader* h = binHeader();
+    if (memcmp(h->magic, BIN_MAGIC, sizeof(h->magic)) == 0 && h->headerSize == sizeof(BinaryHeader) &&
+        ((h->version == 1 && h->slotSize == sizeof(BinarySlotV1) &&
+          h->recordCount <= (binMapSize - sizeof(BinaryHeader)) / sizeof(BinarySlotV1)) ||
+         (h->version == 2 && h->slotSize == BIN_SLOT_V2_SIZE && binMapSize >= BIN_SLOTS_OFFSET &&
+          h->recordCount <= (binMapSize - BIN_SLOTS_OFFSET) / BIN_SLOT_V2_SIZE))) {
+        return migrateBinaryFile(h->version) && openBinaryFile();
+    }
+    if (memcmp(h->magic, BIN_MAGIC, sizeof(h->magic)) != 0 || h->version != BIN_SCHEMA_VERSION ||
+        h->headerSize != sizeof(BinaryHeader) || h->slotSize != sizeof(BinarySlot) ||
+        binMapSize < BIN_SLOTS_OFFSET || h->recordCount > binSlotCapacity() || !binReadDictionaries()) {
+        printf("Error: '%s' is not a binary student file of schema version %d.\n", BIN_FILENAME, BIN_SCHEMA_VERSION);
+        closeBinaryFile();
+        return 0;
+    }
+    return 1;
+}
+
+// Doubles the number of slots in the binary file (at least BIN_GROW_SLOTS more) and remaps it.
+// The old mapping is only released once the new one is in place, so on failure it stays usable.
+static int growBinaryFile() {
+    size_t slots = binSlotCapacity();
+    slots += slots < BIN_GROW_SLOTS ? BIN_GROW_SLOTS : slots;
+    size_t size = BIN_SLOTS_OFFSET + slots * sizeof(BinarySlot);
+    if (ftruncate(binFd, (off_t)size) != 0) return 0;
+    void* old = binMap;
+    size_t oldSize = binMapSize;
+    if (!mapBinaryFile(size)) return 0;
+    munmap(old, oldSize);
+    return 1;
+}
+
+// Makes sure every string in a record read from disk is terminated.
+static void terminateStudentFields(StudentForm* s) {
+    s->name[NAME_LEN - 1] = s->mother[MOTHER_LEN - 1] = s->father[FATHER_LEN - 1] = 0;
+    s->mobile[MOBILE_LEN - 1] = s->percent[PERCENT_LEN - 1] = s->dob[DOB_LEN - 1] = 0;
+}
+
+// File code of in-memory code 'code' of dictionary 't' (0: courses, 1: domiciles). A value the file
+// does not list yet is added to its table and synced before any slot can refer to it. Returns -1 on failure.
+static int binFileCode(int t, int code) {
+    if (storeToBin[t][code]) return storeToBin[t][code] - 1;
+    BinaryHeader* h = binHeader();
+    unsigned int fileCode = h->dictCount[t];
+    if (fileCode == BIN_DICT_ENTRIES) return -1;
+    char* value = binDictionary()->values[t][fileCode];
+    strcpy(value, dictText(binDicts[t], code));
+    if (!binSync(value, DICT_VALUE_LEN)) return -1;
+    h->dictCount[t]++;
+    if (!binSync(h, sizeof(BinaryHeader))) return -1;
+    binToStore[t][fileCode] = (unsigned short)code;
+    storeToBin[t][code] = (unsigned short)(fileCode + 1);
+    return (int)fileCode;
+}
+
+// Copies a record into a slot with its course and domicile codes translated to the file's. Returns 1 on success.
+static int binStoreRecord(BinarySlot* slot, const StudentForm* s) {
+    int course = binFileCode(0, s->courseCode), domicile = binFileCode(1, s->domicileCode);
+    if (course < 0 || domicile < 0) return 0;
+    slot->s = *s;
+    slot->s.courseCode = (unsigned short)course;
+    slot->s.domicileCode = (unsigned short)domicile;
+    return 1;
+}
+
+// Loads the binary storage file into the (empty) store. The mapping stays open for writes.
+static int loadBinaryStorage() {
+    if (!openBinaryFile()) return 0;
+    unsigned int count = binHeader()->recordCount;
+    for (unsigned int i = 0; i < count; i++) {
+        BinarySlot* slot = binSlot((int)i);
+        int ok;
+        if (slot->flags & BIN_SLOT_LIVE) {
+            StudentForm s = slot->s;
+            terminateStudentFields(&s);
+            if (s.courseCode >= binHeader()->dictCount[0] || s.domicileCode >= binHeader()->dictCount[1]) {
+                printf("Error: Slot %u of '%s' refers to a course or domicile the file does not list.\n", i, BIN_FILENAME);
+                return 0;
+            }
+            s.courseCode = binToStore[0][s.courseCode];
+            s.domicileCode = binToStore[1][s.domicileCode];
+            ok = storeAdd(&s) != -1;
+        } else {
+            ok = storeAddDead();
+        }
+        metricsAdd(METRIC_ROWS, 1);
+        if (!ok) {
+            printf("Error: Not enough memory to load all student records.\n");
+            return 0;
+        }
+    }
+    if (binHeader()->nextId > store.nextId) store.nextId = binHeader()->nextId;
+    return 1;
+}
+
+// Writes a new binary storage file at 'path' holding the live records of the store (deleted slots are dropped).
+static int writeBinaryFile(const char* path) {
+    FILE* fp = openFile(path, "wb");
+    if (!fp) {
+        printf("Error: Could not create binary file '%s'.\n", path);
+        perror("Reason");
+        return 0;
+    }
+    int ok = writeBinaryHeader(fp, (unsigned int)store.liveCount, store.nextId);
+
+    BinarySlot slot;
+    for (int i = 0; ok && i < store.count; i++) {
+        if (!store.alive[i]) continue;
+        memset(&slot, 0, sizeof(slot)); // No stray bytes from earlier records in the string padding
+        slot.flags = BIN_SLOT_LIVE;
+        storeRecord(i, &slot.s); // The header copied the in-memory dictionaries, so codes stay as they are
+        ok = fwrite(&slot, sizeof(slot), 1, fp) == 1;
+    }
+    ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0 && ok;
+    metricsAdd(METRIC_WRITTEN, ftell(fp));
+    metricsAdd(METRIC_SYNCS, 1);
+    if (fclose(fp) != 0 || !ok) {
+        printf("Error: Could not write binary file '%s'.\n", path);
+        perror("Reason");
+        remove(path);
+        return 0;
+    }
+    return 1;
+}
+
+// Appends a record in the next free slot. The slot is synced before the record count that exposes it.
+static int binInsert(const StudentForm* s) {
+    if (binHeader()->recordCount == binSlotCapacity() && !growBinaryFile()) return 0;
+    BinarySlot* slot = binSlot((int)binHeader()->recordCount);
+    memset(slot, 0, sizeof(*slot));
+    if (!binStoreRecord(slot, s)) return 0;
+    slot->flags = BIN_SLOT_LIVE;
+    if (!binSync(slot, sizeof(*slot))) return 0;
+    binHeader()->recordCount++;
+    binHeader()->nextId = store.nextId;
+    return binSync(binHeader(), sizeof(BinaryHeader));
+}
+
+// Appends 'n' records in consecutive free slots with a single sync of the whole range.
+static int binInsertMany(const StudentForm* rows, int n) {
+    unsigned int first = binHeader()->recordCount;
+    while (first + (unsigned int)n > binSlotCapacity()) {
+        if (!growBinaryFile()) return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        BinarySlot* slot = binSlot((int)first + i);
+        memset(slot, 0, sizeof(*slot));
+        if (!binStoreRecord(slot, &rows[i])) return 0;
+        slot->flags = BIN_SLOT_LIVE;
+    }
+    if (n > 0 && !binSync(binSlot((int)first), (size_t)n * sizeof(BinarySlot))) return 0;
+    binHeader()->recordCount += (unsigned int)n;
+    binHeader()->nextId = store.nextId;
+    return binSync(binHeader(), sizeof(BinaryHeader));
+}
+
+// Rewrites slot 'idx' in place.
+static int binUpdate(int idx, const StudentForm* s) {
+    BinarySlot* slot = binSlot(idx);
+    return binStoreRecord(slot, s) && binSync(slot, sizeof(*slot));
+}
+
+// Marks slot 'idx' deleted.
+static int binDelete(int idx) {
+    BinarySlot* slot = binSlot(idx);
+    slot->flags &= ~BIN_SLOT_LIVE;
+    return binSync(&slot->flags, sizeof(slot->flags));
+}
+
+// Gives the records just loaded without a student ID their IDs (storeNumberRecords) and saves them at once,
+// so they never change: into their binary slots, or by compacting the text data file. If they cannot be
+// saved they are used anyway (and given again at the next load, perhaps differently).
+static void numberStudentRecords() {
+    int numbered = storeNumberRecords(), saved;
+    if (binaryStorage) {
+        for (int i = 0; i < store.count; i++) {
+            if (store.alive[i]) binSlot(i)->s.id = store.records[i].id;
+        }
+        binHeader()->nextId = store.nextId;
+        saved = binSync(binMap, binMapSize);
+    } else {
+        saved = compactStudentData();
+    }
+    if (saved) printf("Gave %d student record(s) without one a student ID.\n", numbered);
+    else printf("Warning: The student IDs given to %d record(s) could not be saved.\n", numbered);
+}
+
+// Allocates the arrays of the empty store. Returns 0 if out of memory.
+static int storeInit() {
+    store.capacity = STORE_INITIAL_CAPACITY;
+    store.records = malloc((size_t)store.capacity * sizeof(PackedStudent));
+    store.alive = malloc((size_t)store.capacity);
+    if (!store.records || !store.alive ||
+        !indexInit(&store.byMobile, INDEX_INITIAL_BUCKETS, store.capacity) ||
+        !indexInit(&store.byName, INDEX_INITIAL_BUCKETS, store.capacity) ||
+        !indexInit(&store.byId, INDEX_INITIAL_BUCKETS, store.capacity) ||
+        !ngramInit(&store.ngrams)) return 0;
+    store.loaded = 1;
+    store.nextId = 1;
+    return 1;
+}
+
+// Loads the roster into the empty store, from the binary storage file if there is one, otherwise
+// from the text data file plus its change log. Returns 1 on success, 0 on failure.
+static int openStudentStore() {
+    if (!storeInit()) {
+        printf("Error: Not enough memory to load student records.\n");
+        freeStudentStore();
+        return 0;
+    }
+
+    binaryStorage = access(BIN_FILENAME, F_OK) == 0;
+    if (!(binaryStorage ? loadBinaryStorage() : loadTextStorage())) {
+        freeStudentStore();
+        return 0;
+    }
+    if (store.unnumbered > 0) numberStudentRecords();
+    store.totals.dirty = !readAggregatesFile(NULL); // The saved totals are out of date or missing
+    return 1;
+}
+
+// Loads the roster into the store (only the first call does any work).
+// A missing data file is treated as an empty roster. Returns 1 on success, 0 on failure.
+int loadStudentStore() {
+    if (store.loaded) return 1;
+    MetricsSpan span = metricsBegin(OP_LOAD);
+    int ok = openStudentStore();
+    metricsEnd(span);
+    return ok;
+}
+
+// Releases everything the store holds, including the binary file mapping.
+// The next loadStudentStore() reloads from disk.
+void freeStudentStore() {
+    journalClose(); // Pending appends reach the files before anything reads them back
+    free(store.records);
+    arenaFree(&store.arena);
+    free(store.alive);
+    free(store.lines);
+    free(store.byMobile.heads);
+    free(store.byMobile.next);
+    free(store.byName.heads);
+    free(store.byName.next);
+    free(store.byId.heads);
+    free(store.byId.next);
+    ngramFree(&store.ngrams);
+    free(store.applicants.bits);
+    for (int k = 0; k < SORT_KEYS; k++) sortedDrop(&store.sorted[k]);
+    namesDrop(&store.names);
+    for (int i = 0; i < store.rawCount; i++) {
+        free(store.rawLines[i].text);
+    }
+    free(store.rawLines);
+    memset(&store, 0, sizeof(store));
+    closeBinaryFile();
+}
+
+// ---------------------------------------------------------------------------------------------
+// Journal (group commit)
+// ---------------------------------------------------------------------------------------------
+// New records for the data file and change log are appended through the journal. It keeps both files
+// open between appends and makes the buffered records durable together: a background thread syncs them
+// once the oldest pending append is COMMIT_WINDOW_MS old, and an append syncs right away once
+// COMMIT_MAX_RECORDS are pending. A crash loses at most the appends of the last window; a record cut
+// off in the middle is dropped at the next load (see repairDataFileTail and replayChangeLog).
+
+enum { JOURNAL_DATA, JOURNAL_LOG, JOURNAL_FILES };
+static const char* const journalNames[JOURNAL_FILES] = { FILENAME, LOG_FILENAME };
+
+// State of the journal. Everything is guarded by 'lock'.
+typedef struct {
+    FILE* files[JOURNAL_FILES]; // Open on first append, closed by journalClose
+    int dirty[JOURNAL_FILES];   // The file has appends that are not yet synced
+    int pending;                // Appends since the last commit
+    struct timespec due;        // When the oldest pending append must be committed (CLOCK_REALTIME)
+    int windowMs;               // Commit limits (read from the environment on first use)
+    int maxRecords;
+    int failed;                 // A write or sync failed; appends are refused until journalClose
+    int flusherRunning;
+    int stopping;               // Tells the flusher thread to exit
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // Signalled when a new group of appends starts, or on close
+} Journal;
+
+static Journal journal = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+
+// Reads a non-negative number from the environment, or returns 'fallback' if it is not set or not a number.
+static long envLimit(const char* name, long fallback) {
+    const char* text = getenv(name);
+    char* end;
+    long value = text ? strtol(text, &end, 10) : -1;
+    return text && end != text && *end == 0 && value >= 0 ? value : fallback;
+}
+
+// Flushes and syncs the files with pending appends, data file first (log records may refer to
+// slots it adds). Called with the lock held. Returns 1 on success.
+static int journalCommitLocked() {
+    MetricsSpan span = metricsBegin(OP_SYNC);
+    int ok = !journal.failed;
+    for (int f = 0; f < JOURNAL_FILES; f++) {
+        if (!journal.dirty[f]) continue;
+        journal.dirty[f] = 0;
+        FILE* fp = journal.files[f];
+        metricsAdd(METRIC_SYNCS, 1);
+        if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+            printf("Error: Could not save changes to '%s'.\n", journalNames[f]);
+            perror("Reason");
+            ok = 0;
+        }
+    }
+    journal.pending = 0;
+    if (!ok) journal.failed = 1;
+    metricsEnd(span);
+    return ok;
+}
+
+// Background thread: commits each group of appends when its window runs out.
+static void* journalFlusher(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&journal.lock);
+    while (!journal.stopping) {
+        if (journal.pending == 0) {
+            pthread_cond_wait(&journal.wake, &journal.lock);
+        } else if (pthread_cond_timedwait(&journal.wake, &journal.lock, &journal.due) != 0 && journal.pending > 0) {
+            journalCommitLocked(); // Timed out (a wake-up just re-checks the state)
+        }
+    }
+    pthread_mutex_unlock(&journal.lock);
+    return NULL;
+}
+
+// Opens a journal file for appending, and starts the flusher thread with the first file.
+// Called with the lock held. Returns 0 if the file cannot be opened.
+static int journalOpenLocked(int file) {
+    if (journal.files[file]) return 1;
+    if (journal.maxRecords == 0) {
+        journal.windowMs = (int)envLimit(COMMIT_WINDOW_ENV, COMMIT_WINDOW_MS);
+        journal.maxRecords = (int)envLimit(COMMIT_RECORDS_ENV, COMMIT_MAX_RECORDS);
+        if (journal.maxRecords < 1) journal.maxRecords = 1;
+    }
+    FILE* fp = openFile(journalNames[file], "a"); // Open file in append mode
+    if (!fp) {
+        printf("Error: Could not open file '%s' for writing.\n", journalNames[file]);
+        perror("Reason"); // Print system error message
+        return 0;
+    }
+    setvbuf(fp, NULL, _IOFBF, JOURNAL_BUFFER);
+    journal.files[file] = fp;
+    if (journal.windowMs > 0 && !journal.flusherRunning) {
+        // Without the thread every append is committed at once, which is slower but just as safe
+        journal.flusherRunning = pthread_create(&journal.flusher, NULL, journalFlusher, NULL) == 0;
+    }
+    return 1;
+}
+
+// Appends text (one or more whole lines) to a journal file as one pending append.
+// Returns 1 once the text is written; it becomes durable with the next commit (see journalSync).
+static int journalAppend(int file, const char* text) {
+    pthread_mutex_lock(&journal.lock);
+    int ok = !journal.failed && journalOpenLocked(file);
+    if (ok && fputs(text, journal.files[file]) == EOF) {
+        printf("Error: Could not write to file '%s'.\n", journalNames[file]);
+        perror("Reason");
+        journal.failed = 1;
+        ok = 0;
+    }
+    if (ok) {
+        metricsAdd(METRIC_WRITTEN, (long long)strlen(text));
+        journal.dirty[file] = 1;
+        if (journal.pending++ == 0) { // First append of a new group: its window starts now
+            clock_gettime(CLOCK_REALTIME, &journal.due);
+            journal.due.tv_sec += journal.windowMs / 1000;
+            journal.due.tv_nsec += (long)(journal.windowMs % 1000) * 1000000L;
+            if (journal.due.tv_nsec >= 1000000000L) {
+                journal.due.tv_sec++;
+                journal.due.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_signal(&journal.wake);
+        }
+        if (journal.pending >= journal.maxRecords || !journal.flusherRunning) ok = journalCommitLocked();
+    }
+    pthread_mutex_unlock(&journal.lock);
+    return ok;
+}
+
+// Commits the pending appends now. Returns 1 if everything appended so far is on disk.
+int journalSync() {
+    pthread_mutex_lock(&journal.lock);
+    int ok = journal.pending > 0 ? journalCommitLocked() : !journal.failed;
+    pthread_mutex_unlock(&journal.lock);
+    return ok;
+}
+
+// Commits the pending appends, stops the flusher thread and closes the journal files.
+// Must be called before either file is replaced, removed or read back.
+void journalClose() {
+    pthread_mutex_lock(&journal.lock);
+    int running = journal.flusherRunning;
+    journal.stopping = 1;
+    pthread_cond_signal(&journal.wake);
+    pthread_mutex_unlock(&journal.lock);
+    if (running) pthread_join(journal.flusher, NULL);
+
+    pthread_mutex_lock(&journal.lock);
+    if (journal.pending > 0) journalCommitLocked();
+    for (int f = 0; f < JOURNAL_FILES; f++) {
+        if (journal.files[f] && fclose(journal.files[f]) != 0) {
+            printf("Error: Could not write to file '%s'.\n", journalNames[f]);
+            perror("Reason");
+        }
+        journal.files[f] = NULL;
+        journal.dirty[f] = 0;
+    }
+    journal.flusherRunning = 0;
+    journal.stopping = 0;
+    journal.failed = 0;
+    pthread_mutex_unlock(&journal.lock);
+}
+
+// Appends a new record to the end of the text data file.
+static int textInsert(const StudentForm* s) {
+    char line[MAX_LINE_LEN];
+    int len = formatStudentLine(line, sizeof(line), s);
+    if (len < 0 || len >= (int)sizeof(line)) return 0;
+    if (!journalAppend(JOURNAL_DATA, line)) return 0;
+    store.baseHash = hashBytes(store.baseHash, line, (size_t)len);
+    store.baseBytes += len;
+    return 1;
+}
+
+// Appends one record to the change log, starting the log with its header if needed.
+static int appendLogLine(const char* line) {
+    if (store.logBytes == 0) {
+        char header[64];
+        int n = snprintf(header, sizeof(header), "#LOG|%ld|%u\n", store.baseBytes, store.baseHash);
+        if (!journalAppend(JOURNAL_LOG, header)) return 0;
+        store.logBytes += n;
+    }
+    if (!journalAppend(JOURNAL_LOG, line)) return 0;
+    store.logBytes += (long)strlen(line);
+    return 1;
+}
+
+// The data file line of record 'idx', by which the change log refers to it.
+static int storeLine(int idx) {
+    return store.lines ? store.lines[idx] : idx;
+}
+
+// Records new contents for record 'idx' in the change log (upsert).
+static int logStudentUpdate(int idx, const StudentForm* s) {
+    char record[MAX_LINE_LEN];
+    char line[MAX_LINE_LEN + 32];
+    formatStudentLine(record, sizeof(record), s);
+    snprintf(line, sizeof(line), "U|%d|%s", storeLine(idx), record);
+    return appendLogLine(line);
+}
+
+// Records the deletion of record 'idx' in the change log (tombstone).
+static int logStudentDelete(int idx) {
+    char line[32];
+    snprintf(line, sizeof(line), "D|%d\n", storeLine(idx));
+    return appendLogLine(line);
+}
+
+// Returns 1 once the change log is large enough to be worth merging into the data file.
+// The threshold grows with the data file, so the cost of compaction stays proportional to the edits made.
+static int logNeedsCompaction() {
+    return store.logBytes > LOG_COMPACT_MIN_BYTES && store.logBytes * LOG_COMPACT_RATIO > store.baseBytes;
+}
+
+// Gives a new record the next student ID, saves it and adds it to the store. Returns the record index,
+// or -1 on failure (the ID is not given out again either way).
+int storageInsert(StudentForm* s) {
+    s->id = store.nextId++;
+    if (!(binaryStorage ? binInsert(s) : textInsert(s))) return -1;
+    int idx = storeAdd(s);
+    if (idx == -1) {
+        freeStudentStore(); // Out of memory: drop the store so the next operation reloads it from disk
+    }
+    return idx;
+}
+
+// Gives 'n' new records the next student IDs, saves them in one pass (journal appends of many lines each,
+// synced once, or a slot range sync) and adds them to the store. Returns 1 on success, 0 on failure.
+int storageInsertMany(StudentForm* rows, int n) {
+    for (int i = 0; i < n; i++) rows[i].id = store.nextId++;
+    if (binaryStorage) {
+        if (!binInsertMany(rows, n)) return 0;
+    } else {
+        static char chunk[JOURNAL_BUFFER]; // Lines are handed to the journal a buffer-full at a time
+        size_t used = 0;
+        int ok = 1;
+        for (int i = 0; ok && i < n; i++) {
+            char* line = chunk + used;
+            int len = formatStudentLine(line, sizeof(chunk) - used, &rows[i]);
+            if (len < 0 || (size_t)len >= sizeof(chunk) - used) { // Does not fit: send the lines so far first
+                *line = 0; // Drop the part of this line that did fit
+                ok = journalAppend(JOURNAL_DATA, chunk);
+                used = 0;
+                line = chunk;
+                len = formatStudentLine(line, sizeof(chunk), &rows[i]);
+            }
+            store.baseHash = hashBytes(store.baseHash, line, (size_t)len);
+            store.baseBytes += len;
+            used += (size_t)len;
+        }
+        if (ok && used > 0) ok = journalAppend(JOURNAL_DATA, chunk);
+        if (!ok || !journalSync()) {
+            freeStudentStore(); // The file may hold part of the batch; reload it from disk next time
+            return 0;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (storeAdd(&rows[i]) == -1) {
+            freeStudentStore(); // Out of memory: drop the store so the next operation reloads it from disk
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Saves new contents for record 'idx' (slot rewrite or change log upsert), then updates the store.
+// Returns 1 on success; on failure the record is left unchanged.
+int storageUpdate(int idx, const StudentForm* s) {
+    StudentForm saved = *s;
+    saved.id = store.records[idx].id; // A record keeps its ID, so the saved copy does too
+    if (!(binaryStorage ? binUpdate(idx, &saved) : logStudentUpdate(idx, &saved))) return 0;
+    if (!storeUpdate(idx, &saved)) {
+        freeStudentStore(); // Out of memory: drop the store so the next operation reloads it from disk
+        return 0;
+    }
+    return 1;
+}
+
+// Saves the deletion of record 'idx' (slot flag or change log tombstone), then removes it from the store.
+// Returns 1 on success; on failure the record is left in place.
+int storageDelete(int idx) {
+    if (!(binaryStorage ? binDelete(idx) : logStudentDelete(idx))) return 0;
+    storeRemove(idx);
+    return 1;
+}
+
+// Saves every live record of the store again (after changes made to many records at once).
+// Binary storage rewrites the slots and syncs the file once; text storage rewrites the data file.
+// Record indices stay valid either way.
+int storageRewriteAll() {
+    if (!binaryStorage) return compactStudentData();
+    MetricsSpan span = metricsBegin(OP_REWRITE);
+    StudentForm s;
+    int ok = 1;
+    for (int i = 0; ok && i < store.count; i++) {
+        if (store.alive[i]) ok = binStoreRecord(binSlot(i), storeRecord(i, &s));
+    }
+    ok = ok && binSync(binMap, binMapSize);
+    metricsEnd(span);
+    return ok;
+}
+
+// Housekeeping after a batch of writes: merges the change log once it has grown large enough.
+// The store stays loaded and record indices stay valid.
+void storageMaintain() {
+    if (!binaryStorage && logNeedsCompaction()) {
+        compactStudentData();
+    }
+}
+
+// Writes the live records of the store (and any unparsable lines) as a text data file via a synced
+// temporary file renamed over FILENAME. rename() replaces the file atomically, so there is never a moment
+// without a complete data file. The first line, "#IDS|<next student ID>", keeps IDs from being given out
+// again once the records that had them are deleted and left out of the file. Sets *bytes and *hash to the
+// size and hash of the new file and, if 'lines' is not NULL, lines[i] to the line record i was written to
+// (-1 if left out). Returns 1 on success; on failure FILENAME is left as it was.
+static int writeTextDataFile(int* lines, long* bytes, unsigned int* hash) {
+    journalClose(); // The journal must not keep appending to the file being replaced
+    FILE* fp = openFile(TEMP_FILENAME, "w");
+    if (!fp) {
+        printf("Error: Could not create temporary file ('%s').\n", TEMP_FILENAME);
+        perror("Reason");
+        return 0;
+    }
+    StudentForm s;
+    char line[MAX_LINE_LEN];
+    int r = 0, written = 0; // Next unparsable line to carry over, lines written
+    int len = snprintf(line, sizeof(line), "#IDS|%u\n", store.nextId);
+    fputs(line, fp);
+    *hash = hashBytes(2166136261u, line, (size_t)len);
+    written++;
+    for (int i = 0; i < store.count; i++) {
+        int at = -1;
+        if (store.alive[i]) {
+            formatStudentLine(line, sizeof(line), storeRecord(i, &s));
+            fputs(line, fp);
+            *hash = hashBytes(*hash, line, strlen(line));
+            at = written++;
+        } else if (r < store.rawCount && store.rawLines[r].slot == i) {
+            const char* text = store.rawLines[r++].text;
+            fprintf(fp, "%s\n", text);
+            *hash = hashBytes(hashBytes(*hash, text, strlen(text)), "\n", 1);
+            at = written++;
+        }
+        if (lines) lines[i] = at;
+    }
+    int ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    *bytes = ftell(fp);
+    metricsAdd(METRIC_WRITTEN, *bytes);
+    metricsAdd(METRIC_SYNCS, 1);
+    if (fclose(fp) != 0 || !ok) {
+        printf("Error: Could not write temporary file ('%s').\n", TEMP_FILENAME);
+        perror("Reason");
+        remove(TEMP_FILENAME);
+        return 0;
+    }
+    if (renameFile(TEMP_FILENAME, FILENAME) != 0) {
+        printf("\nError: Could not rename temporary file '%s' to '%s'.\n", TEMP_FILENAME, FILENAME);
+        perror("Reason");
+        remove(TEMP_FILENAME);
+        return 0;
+    }
+    return 1;
+}
+
+// Merges the change log into the text data file and drops the log. The store is kept as it is: records
+// keep their indices and store.lines notes the line each one now has. Returns 1 on success, 0 on failure.
+int compactStudentData() {
+    int* lines = malloc((size_t)store.capacity * sizeof(int));
+    if (!lines) {
+        printf("Error: Not enough memory to compact the student data file.\n");
+        return 0;
+    }
+    MetricsSpan span = metricsBegin(OP_REWRITE);
+    long bytes;
+    unsigned int hash;
+    int written = writeTextDataFile(lines, &bytes, &hash);
+    metricsEnd(span);
+    if (!written) {
+        free(lines);
+        return 0;
+    }
+    remove(LOG_FILENAME); // If this fails the log is recognised as stale at the next load
+    remove(SNAPSHOT_FILENAME); // Same for the snapshot
+    store.lineCount = 1 + store.liveCount + store.rawCount; // "#IDS", then the records and unparsable lines
+    free(store.lines);
+    store.lines = lines;
+    store.baseBytes = bytes;
+    store.baseHash = hash;
+    store.logBytes = 0;
+    store.snapshotData = store.snapshotLog = 0;
+    store.totals.dirty = 1; // The saved totals are tagged with the old data file
+    return 1;
+}
+
+// Switches to binary storage: writes the current roster to BIN_FILENAME and reloads from it.
+// The text data file is left in place as an export of the roster at the time of conversion.
+int convertToBinaryStorage() {
+    if (!loadStudentStore()) return 0;
+    if (binaryStorage) {
+        printf("Binary storage is already in use.\n");
+        return 1;
+    }
+    MetricsSpan span = metricsBegin(OP_REWRITE);
+    int written = writeBinaryFile(TEMP_BIN_FILENAME);
+    metricsEnd(span);
+    if (!written) return 0;
+    if (renameFile(TEMP_BIN_FILENAME, BIN_FILENAME) != 0) {
+        printf("Error: Could not rename '%s' to '%s'.\n", TEMP_BIN_FILENAME, BIN_FILENAME);
+        perror("Reason");
+        remove(TEMP_BIN_FILENAME);
+        return 0;
+    }
+    freeStudentStore();
+    if (!loadStudentStore()) return 0;
+    printf("Converted %d records to binary storage ('%s').\n", store.liveCount, BIN_FILENAME);
+    return 1;
+}
+
+// Writes the current roster to the text data file. In text mode this also merges the change log.
+int exportToTextFile() {
+    if (!loadStudentStore()) return 0;
+    if (!binaryStorage) return compactStudentData();
+    MetricsSpan span = metricsBegin(OP_REWRITE);
+    long bytes;
+    unsigned int hash;
+    int written = writeTextDataFile(NULL, &bytes, &hash);
+    metricsEnd(span);
+    if (!written) return 0;
+    remove(LOG_FILENAME); // The exported file starts a new history
+    remove(SNAPSHOT_FILENAME);
+    printf("Exported %d records to '%s'.\n", store.liveCount, FILENAME);
+    return 1;
+}
+
+// Switches back to text storage: exports the roster to the text data file and removes the binary file.
+int convertToTextStorage() {
+    if (!loadStudentStore()) return 0;
+    if (!binaryStorage) {
+        printf("Text storage is already in use.\n");
+        return 1;
+    }
+    if (!exportToTextFile()) return 0;
+    freeStudentStore(); // Unmap before removing
+    if (remove(BIN_FILENAME) != 0) {
+        printf("Error: Could not remove '%s'.\n", BIN_FILENAME);
+        perror("Reason");
+        return 0;
+    }
+    return loadStudentStore();
+}
+
+// Lets the admin convert between text and binary storage or export the roster (as text, CSV or JSON).
+void storageMenu() {
+    clearScreen();
+    printf("========================\n");
+    printf("  STORAGE IMPORT/EXPORT\n");
+    printf("========================\n\n");
+
+    if (!loadStudentStore()) {
+        return;
+    }
+    printf("Current storage: %s ('%s', %d records)\n\n", binaryStorage ? "binary" : "text",
+           binaryStorage ? BIN_FILENAME : FILENAME, store.liveCount);
+    printf("1. Convert to binary storage (import from '%s')\n", FILENAME);
+    printf("2. Export roster to '%s'\n", FILENAME);
+    printf("3. Convert back to text storage\n");
+    printf("4. Export roster or search results as CSV or JSON\n");
+    printf("5. Back\n\n");
+    printf("Enter your choice: ");
+
+    int choice;
+    if (scanf("%d", &choice) != 1) {
+        printf("Invalid input. Please enter a number.\n");
+        clearInputBuffer();
+        return;
+    }
+    clearInputBuffer();
+
+    switch (choice) {
+        case 1: convertToBinaryStorage(); break;
+        case 2: exportToTextFile(); break;
+        case 3: convertToTextStorage(); break;
+        case 4: exportMenu(); break;
+        case 5: break;
+        default: printf("Invalid choice.\n");
+    }
+}
+
+// Recomputes the fees of every student under the fee policy in force and saves the roster.
+// Students whose course the policy no longer lists keep their old fees.
+// Returns the number of students whose fees changed, or -1 on failure.
+int repriceRoster() {
+    if (!loadStudentStore()) return -1;
+    int changed = 0, unknownCourse = 0;
+    for (int i = 0; i < store.count; i++) {
+        if (!store.alive[i]) continue;
+        PackedStudent* s = &store.records[i]; // Only the sorted views order by fee, so the record is updated in place
+        StudentForm priced;
+        storeRecord(i, &priced);
+        computeFees(&priced, strtof(priced.percent, NULL));
+        if (priced.totalFee == 0.0f) {
+            unknownCourse++;
+        } else if (priced.totalFee != s->totalFee || priced.discount != s->discount ||
+                   priced.domicileDiscount != s->domicileDiscount || priced.finalFee != s->finalFee) {
+            aggregateRecord(s, -1);
+            s->totalFee = priced.totalFee;
+            s->discount = priced.discount;
+            s->domicileDiscount = priced.domicileDiscount;
+            s->finalFee = priced.finalFee;
+            aggregateRecord(s, 1);
+            sortedNoteChange(i); // The final fee view re-sorts it at the next listing
+            changed++;
+        }
+    }
+    if (unknownCourse > 0) {
+        printf("%d student(s) have a course the fee policy does not list; their fees were left unchanged.\n", unknownCourse);
+    }
+    if (changed > 0 && !storageRewriteAll()) return -1;
+    return changed;
+}
+
+// Shows the fee policy in force and lets the admin reload it or re-price the roster with it.
+void feePolicyMenu() {
+    clearScreen();
+    printf("========================\n");
+    printf("       FEE POLICY\n");
+    printf("========================\n\n");
+
+    printf("%-30s %15s\n", "Course", "Total Fee (Rs)");
+    for (int i = 0; i < feePolicy.courses.count; i++) {
+        printf("%-30s %15.2f\n", feePolicy.courses.names[i], feePolicy.courses.values[i]);
+    }
+    printf("\n%-30s %15s\n", "Domicile", "Discount (%)");
+    for (int i = 0; i < feePolicy.domiciles.count; i++) {
+        printf("%-30s %15.2f\n", feePolicy.domiciles.names[i], feePolicy.domiciles.values[i]);
+    }
+    printf("\n%-30s %15s\n", "12th Percentage Above", "Discount (%)");
+    for (int i = feePolicy.tierCount - 1; i >= 0; i--) {
+        printf("%-30.2f %15.2f\n", feePolicy.tierAbove[i], feePolicy.tierDiscount[i + 1]);
+    }
+
+    printf("\n1. Reload policy from '%s'\n", FEE_POLICY_FILENAME);
+    printf("2. Re-price all students with this policy\n");
+    printf("3. Back\n\n");
+    printf("Enter your choice: ");
+
+    int choice;
+    if (scanf("%d", &choice) != 1) {
+        printf("Invalid input. Please enter a number.\n");
+        clearInputBuffer();
+        return;
+    }
+    clearInputBuffer();
+
+    switch (choice) {
+        case 1:
+            if (loadFeePolicy()) printf("Fee policy reloaded. Re-price the roster to apply it to existing students.\n");
+            break;
+        case 2: {
+            double start = nowSeconds();
+            int changed = repriceRoster();
+            if (changed >= 0) printf("Re-priced: %d student(s) changed in %.3f seconds.\n", changed, nowSeconds() - start);
+            break;
+        }
+        case 3: break;
+        default: printf("Invalid choice.\n");
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Fee and enrollment aggregates
+// ---------------------------------------------------------------------------------------------
+// Head counts and fee totals (overall, per course, per domicile). storeAdd, storeUpdate and storeRemove
+// keep them up to date as records change, so a report costs the same whatever the roster size.
+// They are saved to AGG_FILENAME when the program ends, tagged with the size and modification time of
+// the storage files. A later run that finds the storage files unchanged reads the report from there
+// without loading the roster; otherwise the counters are rebuilt while the roster loads.
+
+// Fee in paise, so sums and differences stay exact.
+static long long toPaise(float rupees) {
+    return (long long)(rupees * 100.0 + (rupees < 0 ? -0.5 : 0.5));
+}
+
+// Finds the group for a course or domicile (case-insensitive), creating it if needed.
+// When the table is full, further names share its last group, "(other)".
+static AggregateGroup* aggregateGroup(AggregateGroup* groups, int* count, const char* name) {
+    unsigned int hash = hashString(name, 1);
+    for (int i = 0; i < *count; i++) {
+        if (groups[i].hash == hash && equalsIgnoreCase(groups[i].name, name)) return &groups[i];
+    }
+    if (*count == AGG_MAX_GROUPS) return &groups[AGG_MAX_GROUPS - 1];
+    AggregateGroup* g = &groups[(*count)++];
+    memset(g, 0, sizeof(*g));
+    snprintf(g->name, sizeof(g->name), "%s", *count == AGG_MAX_GROUPS ? "(other)" : name);
+    g->hash = *count == AGG_MAX_GROUPS ? 0 : hash;
+    return g;
+}
+
+static void aggregateApply(AggregateGroup* g, const PackedStudent* s, int sign) {
+    g->count += sign;
+    g->totalFee += sign * toPaise(s->totalFee);
+    g->discount += sign * toPaise(s->discount);
+    g->domicileDiscount += sign * toPaise(s->domicileDiscount);
+    g->finalFee += sign * toPaise(s->finalFee);
+}
+
+// Adds (sign = 1) or subtracts (sign = -1) a live record's contribution to the running totals.
+static void aggregateRecord(const PackedStudent* s, int sign) {
+    Aggregates* agg = &store.totals;
+    aggregateApply(&agg->all, s, sign);
+    // Each code is looked up by name once; after that its group is an array access
+    if (!agg->courseGroup[s->courseCode]) {
+        AggregateGroup* g = aggregateGroup(agg->courses, &agg->courseCount, dictText(&courseDict, s->courseCode));
+        agg->courseGroup[s->courseCode] = (unsigned char)(g - agg->courses + 1);
+    }
+    if (!agg->domicileGroup[s->domicileCode]) {
+        AggregateGroup* g = aggregateGroup(agg->domiciles, &agg->domicileCount, dictText(&domicileDict, s->domicileCode));
+        agg->domicileGroup[s->domicileCode] = (unsigned char)(g - agg->domiciles + 1);
+    }
+    aggregateApply(&agg->courses[agg->courseGroup[s->courseCode] - 1], s, sign);
+    aggregateApply(&agg->domiciles[agg->domicileGroup[s->domicileCode] - 1], s, sign);
+    agg->dirty = 1;
+}
+
+// Describes the current storage files by size and modification time (changes with every write).
+static void storageSignature(char* buf, size_t size) {
+    static const char* files[] = { FILENAME, LOG_FILENAME, BIN_FILENAME };
+    size_t len = 0;
+    buf[0] = 0;
+    for (size_t f = 0; f < sizeof(files) / sizeof(files[0]) && len < size; f++) {
+        struct stat st;
+        if (stat(files[f], &st) == 0) {
+            len += (size_t)snprintf(buf + len, size - len, "%lld:%lld.%09ld;", (long long)st.st_size,
+                                    (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+        } else {
+            len += (size_t)snprintf(buf + len, size - len, "-;");
+        }
+    }
+}
+
+// Reads AGG_FILENAME into *agg if it describes the storage files as they are now (agg may be NULL to
+// only check that). Returns 1 if it does, 0 if it is missing, malformed or out of date.
+static int readAggregatesFile(Aggregates* agg) {
+    char line[MAX_LINE_LEN], signature[AGG_SIGNATURE_LEN], kind[16], name[COURSE_LEN];
+    FILE* fp = openFile(AGG_FILENAME, "r");
+    if (!fp) return 0;
+    storageSignature(signature, sizeof(signature));
+    int ok = fgets(line, sizeof(line), fp) != NULL && strncmp(line, "#AGG|", 5) == 0;
+    if (ok) {
+        line[strcspn(line, "\n")] = 0;
+        ok = strcmp(line + 5, signature) == 0;
+    }
+    if (ok && agg) {
+        memset(agg, 0, sizeof(*agg));
+        while (ok && fgets(line, sizeof(line), fp) != NULL) {
+            AggregateGroup g;
+            memset(&g, 0, sizeof(g));
+            metricsAdd(METRIC_READ, (long long)strlen(line));
+            ok = sscanf(line, "%15[^|]|%49[^|]|%ld|%lld|%lld|%lld|%lld", kind, name, &g.count, &g.totalFee,
+                        &g.discount, &g.domicileDiscount, &g.finalFee) == 7;
+            if (!ok) break;
+            AggregateGroup* dst = NULL;
+            if (strcmp(kind, "all") == 0) dst = &agg->all;
+            else if (strcmp(kind, "course") == 0) dst = aggregateGroup(agg->courses, &agg->courseCount, name);
+            else if (strcmp(kind, "domicile") == 0) dst = aggregateGroup(agg->domiciles, &agg->domicileCount, name);
+            if (!dst) { ok = 0; break; }
+            strcpy(g.name, dst->name);
+            g.hash = dst->hash;
+            *dst = g;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+// Saves the running totals to AGG_FILENAME (via a temporary file) with the current storage signature.
+static int saveAggregates() {
+    const Aggregates* agg = &store.totals;
+    char signature[AGG_SIGNATURE_LEN];
+    FILE* fp = openFile(TEMP_AGG_FILENAME, "w");
+    if (!fp) return 0;
+    storageSignature(signature, sizeof(signature));
+    fprintf(fp, "#AGG|%s\n", signature);
+    fprintf(fp, "all|-|%ld|%lld|%lld|%lld|%lld\n", agg->all.count, agg->all.totalFee, agg->all.discount,
+            agg->all.domicileDiscount, agg->all.finalFee);
+    for (int d = 0; d < 2; d++) {
+        const AggregateGroup* groups = d == 0 ? agg->courses : agg->domiciles;
+        int count = d == 0 ? agg->courseCount : agg->domicileCount;
+        for (int i = 0; i < count; i++) {
+            fprintf(fp, "%s|%s|%ld|%lld|%lld|%lld|%lld\n", d == 0 ? "course" : "domicile", groups[i].name,
+                    groups[i].count, groups[i].totalFee, groups[i].discount, groups[i].domicileDiscount, groups[i].finalFee);
+        }
+    }
+    metricsAdd(METRIC_WRITTEN, ftell(fp));
+    if (fclose(fp) != 0 || renameFile(TEMP_AGG_FILENAME, AGG_FILENAME) != 0) {
+        remove(TEMP_AGG_FILENAME);
+        return 0;
+    }
+    return 1;
+}
+
+// 1 if the snapshot is worth (re)writing: the data file is large enough for a full load to take a while, and
+// more than 1/SNAPSHOT_STALE_RATIO of it would be replayed on top of the last snapshot (all of it if none).
+// Never after a compaction: the records no longer sit at the index of their line, as a load expects.
+static int snapshotDue() {
+    if (!store.loaded || binaryStorage || store.lines || store.baseBytes < SNAPSHOT_MIN_BYTES) return 0;
+    long behind = store.baseBytes - store.snapshotData + store.logBytes - store.snapshotLog;
+    return behind * SNAPSHOT_STALE_RATIO > store.baseBytes;
+}
+
+// Saves the running totals if they changed since they were last saved, and the index snapshot if it is
+// due, then releases the store. Registered with atexit.
+void closeStudentStore() {
+    journalClose(); // Before the totals and the snapshot are tagged with the size of the files
+    if (store.loaded && store.totals.dirty) saveAggregates();
+    if (snapshotDue()) saveSnapshot();
+    freeStudentStore();
+}
+
+// The running totals: those of the loaded store, else the saved ones if still current, else those of the
+// store loaded now. Returns NULL if the roster could not be loaded.
+const Aggregates* currentAggregates() {
+    static Aggregates saved;
+    if (store.loaded) return &store.totals;
+    if (readAggregatesFile(&saved)) return &saved;
+    return loadStudentStore() ? &store.totals : NULL;
+}
+
+// Formats an amount in paise as rupees ("1234.50").
+static const char* paiseText(long long paise, char* buf, size_t size) {
+    snprintf(buf, size, "%s%lld.%02lld", paise < 0 ? "-" : "", (paise < 0 ? -paise : paise) / 100,
+             (paise < 0 ? -paise : paise) % 100);
+    return buf;
+}
+
+static void printAggregateRow(const AggregateGroup* g, const char* label) {
+    char total[32], discounts[32], final[32];
+    printf("| %-24s | %8ld | %18s | %18s | %18s |\n", label, g->count, paiseText(g->totalFee, total, sizeof(total)),
+           paiseText(g->discount + g->domicileDiscount, discounts, sizeof(discounts)),
+           paiseText(g->finalFee, final, sizeof(final)));
+}
+
+// Prints the head count of each age (in years, today) from the youngest student's to the oldest's.
+static void printAgeTable() {
+    static const char* rule = "+--------------------------+----------+\n";
+    long counts[AGE_MAX_YEARS];
+    int n = storeAgeHistogram(todayDate(), AGE_BUCKET_YEARS, counts, (AGE_MAX_YEARS + AGE_BUCKET_YEARS - 1) / AGE_BUCKET_YEARS);
+    if (n < 0) {
+        printf("Error: Not enough memory to count the students by age.\n");
+        return;
+    }
+    char label[32];
+    long placed = 0;
+    printf("%s| %-24s | %8s |\n%s", rule, "Age (years)", "Students", rule);
+    for (int b = 0; b < n; b++) {
+        if (placed == 0 && counts[b] == 0) continue; // Start at the youngest student's age
+        if (AGE_BUCKET_YEARS == 1) snprintf(label, sizeof(label), "%d", b);
+        else snprintf(label, sizeof(label), "%d-%d", b * AGE_BUCKET_YEARS, (b + 1) * AGE_BUCKET_YEARS - 1);
+        printf("| %-24s | %8ld |\n", label, counts[b]);
+        placed += counts[b];
+    }
+    if (placed < store.liveCount) printf("| %-24s | %8ld |\n", "No usable date of birth", store.liveCount - placed);
+    printf("%s\n", rule);
+}
+
+// Shows head counts and fee totals overall, by course and by domicile, and head counts by age.
+void aggregatesReport() {
+    clearScreen();
+    printf("================================\n");
+    printf("  FEE AND ENROLLMENT REPORT\n");
+    printf("================================\n\n");
+    const Aggregates* agg = currentAggregates();
+    if (!agg) return;
+
+    static const char* rule = "+--------------------------+----------+--------------------+--------------------+--------------------+\n";
+    for (int d = 0; d < 3; d++) {
+        const AggregateGroup* groups = d == 0 ? &agg->all : d == 1 ? agg->courses : agg->domiciles;
+        int count = d == 0 ? 1 : d == 1 ? agg->courseCount : agg->domicileCount;
+        printf("%s", rule);
+        printf("| %-24s | %8s | %18s | %18s | %18s |\n", d == 0 ? "All Students" : d == 1 ? "Course" : "Domicile",
+               "Students", "Total Fee (Rs)", "Discounts (Rs)", "Final Fee (Rs)");
+        printf("%s", rule);
+        for (int i = 0; i < count; i++) {
+            if (groups[i].count > 0 || d == 0) printAggregateRow(&groups[i], d == 0 ? "Total" : groups[i].name);
+        }
+        printf("%s\n", rule);
+    }
+    if (loadStudentStore()) printAgeTable(); // Ages need the records themselves, not just the saved totals
+}
+
+// ---------------------------------------------------------------------------------------------
+// Worker threads
+// ---------------------------------------------------------------------------------------------
+
+// Number of worker threads to use: one per online CPU (or WORKERS_ENV if set), capped at MAX_WORKERS.
+int workerCount() {
+    const char* forced = getenv(WORKERS_ENV);
+    long cpus = forced && atoi(forced) > 0 ? atoi(forced) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > MAX_WORKERS ? MAX_WORKERS : (int)cpus;
+}
+
+// Arguments handed to one worker thread by runWorkers.
+typedef struct {
+    void (*fn)(void* ctx, int worker, int workers);
+    void* ctx;
+    int worker, workers;
+} WorkerArgs;
+
+static void* workerMain(void* arg) {
+    WorkerArgs* a = arg;
+    a->fn(a->ctx, a->worker, a->workers);
+    return NULL;
+}
+
+// Runs fn(ctx, i, workers) for i = 0..workers-1 in parallel and waits for all of them.
+// Worker 0 runs on the calling thread; if a thread cannot be started its share runs there too.
+void runWorkers(int workers, void (*fn)(void* ctx, int worker, int workers), void* ctx) {
+    pthread_t threads[MAX_WORKERS];
+    WorkerArgs args[MAX_WORKERS];
+    int started[MAX_WORKERS] = { 0 };
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+    for (int i = 1; i < workers; i++) {
+        args[i].fn = fn;
+        args[i].ctx = ctx;
+        args[i].worker = i;
+        args[i].workers = workers;
+        started[i] = pthread_create(&threads[i], NULL, workerMain, &args[i]) == 0;
+    }
+    fn(ctx, 0, workers);
+    for (int i = 1; i < workers; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        else fn(ctx, i, workers);
+    }
+}
+
+// Shared state for filterWorker.
+typedef struct {
+    int* ids;
+    int count;
+    int (*keep)(const void* ctx, int idx);
+    const void* ctx;
+    int per;                  // Candidates per worker
+    int kept[MAX_WORKERS];    // Matches each worker moved to the front of its share
+} FilterJob;
+
+// Worker: keeps the matching candidates of its contiguous share, in order, at the front of the share.
+static void filterWorker(void* ctx, int worker, int workers) {
+    FilterJob* job = ctx;
+    (void)workers;
+    int start = worker * job->per;
+    int end = start + job->per > job->count ? job->count : start + job->per;
+    int kept = 0;
+    for (int i = start; i < end; i++) {
+        if (job->keep(job->ctx, job->ids[i])) job->ids[start + kept++] = job->ids[i];
+    }
+    job->kept[worker] = kept;
+}
+
+// Keeps the record indices ids[0 .. count) for which keep(ctx, idx) returns 1, in their original order,
+// and returns how many there are. Large candidate sets are split between worker threads; 'keep' must
+// only read the store.
+int filterRecords(int* ids, int count, int (*keep)(const void* ctx, int idx), const void* ctx) {
+    FilterJob job;
+    int workers = workerCount();
+    if (workers > count / SCAN_MIN_ROWS_PER_THREAD) workers = count / SCAN_MIN_ROWS_PER_THREAD;
+    if (workers < 1) workers = 1;
+    job.ids = ids;
+    job.count = count;
+    job.keep = keep;
+    job.ctx = ctx;
+    job.per = (count + workers - 1) / workers;
+    runWorkers(workers, filterWorker, &job);
+
+    int total = 0; // Close the gaps between the shares
+    for (int w = 0; w < workers; w++) {
+        if (job.kept[w] == 0) continue;
+        memmove(ids + total, ids + w * job.per, (size_t)job.kept[w] * sizeof(int));
+        total += job.kept[w];
+    }
+    return total;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Bulk CSV import
+// ---------------------------------------------------------------------------------------------
+// The CSV is read in batches of IMPORT_BATCH_ROWS lines. Worker threads split each batch between
+// them: they parse their rows, validate them with the registration rules and compute the fees.
+// The accepted rows of the batch are then written to storage in one pass.
+// Columns: Name,Mother,Father,Mobile,Percent,Domicile,Course,DOB (an optional header row is skipped).
+
+// One CSV row of the current batch.
+typedef struct {
+    char line[MAX_LINE_LEN]; // Raw CSV line
+    long row;                // Line number in the CSV file
+    StudentForm s;           // Parsed and priced record
+    const char* error;       // Why the row was rejected (NULL if accepted)
+} ImportRow;
+
+// Shared state for the import workers.
+typedef struct {
+    ImportRow* rows;
+    int count;
+} ImportBatch;
+
+// Splits one CSV line into the StudentForm text fields. Quoted fields ("...", with "" for a quote) are supported.
+// Returns NULL on success or a description of the problem.
+static const char* parseCSVStudent(const char* line, StudentForm* s) {
+    static const char* tooLong[STUDENT_TEXT_FIELDS] = {
+        "Name is too long", "Mother's Name is too long", "Father's Name is too long", "Mobile is too long",
+        "12th Percentage is too long", "Domicile is too long", "Course is too long", "DOB is too long"
+    };
+    const char* p = line;
+    for (int field = 0; field < STUDENT_TEXT_FIELDS; field++) {
+        char encoded[DICT_VALUE_LEN]; // Dictionary-encoded fields are collected here, then interned
+        char* dst = studentFields[field].dict ? encoded : (char*)s + studentFields[field].offset;
+        size_t size = studentFields[field].size, n = 0;
+        int quoted = *p == '"';
+        if (quoted) p++;
+        while (*p) {
+            if (quoted && *p == '"') {
+                if (p[1] != '"') { p++; quoted = 0; continue; } // Closing quote
+                p++;                                           // "" is a literal quote
+            } else if (!quoted && (*p == ',' || *p == '\r' || *p == '\n')) {
+                break;
+            }
+            if (*p == '|') return "field contains '|'";
+            if (n + 1 >= size) return tooLong[field];
+            dst[n++] = *p++;
+        }
+        if (quoted) return "unterminated quote";
+        dst[n] = 0;
+        // Trim surrounding spaces, as a spreadsheet export may pad cells
+        char* start = dst;
+        while (*start == ' ') start++;
+        size_t len = strlen(start);
+        while (len > 0 && start[len - 1] == ' ') len--;
+        memmove(dst, start, len);
+        dst[len] = 0;
+        if (len == 0) return "missing field";
+        if (studentFields[field].dict && !setStudentText(s, field, dst, len)) return "too many different courses or domiciles";
+
+        if (field < STUDENT_TEXT_FIELDS - 1) {
+            if (*p != ',') return "too few columns";
+            p++;
+        }
+    }
+    while (*p == ' ' || *p == '\r' || *p == '\n') p++;
+    return *p ? "too many columns" : NULL;
+}
+
+// Worker: parses, validates and prices its contiguous share of the batch.
+static void importWorker(void* ctx, int worker, int workers) {
+    ImportBatch* batch = ctx;
+    int per = (batch->count + workers - 1) / workers;
+    int start = worker * per;
+    int end = start + per > batch->count ? batch->count : start + per;
+    for (int i = start; i < end; i++) {
+        ImportRow* r = &batch->rows[i];
+        r->error = parseCSVStudent(r->line, &r->s);
+        if (!r->error) r->error = validateStudent(&r->s);
+    }
+}
+
+// Returns why 's' duplicates one of the 'n' rows accepted before it in the same batch, or NULL.
+// 'seen' holds their keys; rows accepted here are added to it. Only a "maybe" scans the accepted rows.
+static const char* duplicateInBatch(BloomFilter* seen, const StudentForm* s, const StudentForm* accepted, int n) {
+    unsigned int mobileKey = mobileKeyHash(s->mobile), nameDobKey = nameDobKeyHash(s->name, s->dob);
+    int maybeMobile = bloomProbe(seen, mobileKey, 0), maybeNameDob = bloomProbe(seen, nameDobKey, 0);
+    if (maybeMobile || maybeNameDob) {
+        for (int i = 0; i < n; i++) {
+            if (maybeMobile && strcmp(accepted[i].mobile, s->mobile) == 0) {
+                return "duplicate applicant (mobile number earlier in the file)";
+            }
+            if (maybeNameDob && equalsIgnoreCase(accepted[i].name, s->name) && sameDob(accepted[i].dob, s->dob)) {
+                return "duplicate applicant (same name and date of birth earlier in the file)";
+            }
+        }
+    }
+    bloomProbe(seen, mobileKey, 1);
+    bloomProbe(seen, nameDobKey, 1);
+    return NULL;
+}
+
+// Appends a rejected row to the rejects file and, for the first few, to the screen.
+static void reportRejectedRow(FILE* rejects, const ImportRow* r, long rejected) {
+    char line[MAX_LINE_LEN];
+    strcpy(line, r->line);
+    line[strcspn(line, "\r\n")] = 0;
+    if (rejects) fprintf(rejects, "row %ld: %s: %s\n", r->row, r->error, line);
+    if (rejected <= IMPORT_SHOWN_REJECTS) printf("  Row %ld rejected: %s\n", r->row, r->error);
+}
+
+// Imports every valid row of a CSV file. Rejected rows are listed (with reasons) in IMPORT_REJECTS_FILENAME.
+void importStudentsCSV(const char* path) {
+    if (!loadStudentStore()) return;
+    MetricsSpan span = metricsBegin(OP_IMPORT);
+    FILE* in = openFile(path, "r");
+    if (!in) {
+        printf("Error: Could not open CSV file '%s'.\n", path);
+        perror("Reason");
+        metricsEnd(span);
+        return;
+    }
+    ImportBatch batch;
+    batch.rows = malloc(IMPORT_BATCH_ROWS * sizeof(ImportRow));
+    StudentForm* accepted = malloc(IMPORT_BATCH_ROWS * sizeof(StudentForm));
+    if (!batch.rows || !accepted) {
+        printf("Error: Not enough memory for the import.\n");
+        free(batch.rows);
+        free(accepted);
+        fclose(in);
+        metricsEnd(span);
+        return;
+    }
+    FILE* rejects = openFile(IMPORT_REJECTS_FILENAME, "w");
+    int workers = workerCount();
+    BloomFilter seen; // Duplicate-check keys of the rows accepted from the current batch
+    long row = 0, imported = 0, rejected = 0;
+    int failed = 0;
+    double start = nowSeconds();
+
+    while (!failed) {
+        // Read the next batch of lines
+        batch.count = 0;
+        while (batch.count < IMPORT_BATCH_ROWS) {
+            ImportRow* r = &batch.rows[batch.count];
+            if (fgets(r->line, sizeof(r->line), in) == NULL) break;
+            r->row = ++row;
+            size_t len = strlen(r->line);
+            metricsAdd(METRIC_READ, (long long)len);
+            if (len == sizeof(r->line) - 1 && r->line[len - 1] != '\n') {
+                int c;
+                while ((c = fgetc(in)) != '\n' && c != EOF); // Skip the rest of the overlong line
+                r->error = "line too long";
+                reportRejectedRow(rejects, r, ++rejected);
+                continue;
+            }
+            if (r->line[strspn(r->line, " \r\n")] == 0) continue; // Blank line
+            if (row == 1 && (strncmp(r->line, "Name,", 5) == 0 || strncmp(r->line, "name,", 5) == 0)) continue; // Header
+            batch.count++;
+        }
+        if (batch.count == 0) break;
+        metricsAdd(METRIC_ROWS, batch.count);
+
+        // Validate and price the batch in parallel
+        int batchWorkers = batch.count / IMPORT_MIN_ROWS_PER_THREAD;
+        runWorkers(batchWorkers < workers ? batchWorkers : workers, importWorker, &batch);
+
+        // Write the accepted rows in file order, minus applicants already registered or earlier in the batch
+        int n = 0;
+        bloomInit(&seen, 2L * batch.count);
+        for (int i = 0; i < batch.count; i++) {
+            ImportRow* r = &batch.rows[i];
+            if (!r->error) r->error = duplicateApplicant(&r->s);
+            if (!r->error) r->error = duplicateInBatch(&seen, &r->s, accepted, n);
+            if (r->error) reportRejectedRow(rejects, r, ++rejected);
+            else accepted[n++] = r->s;
+        }
+        free(seen.bits);
+        if (n > 0 && !storageInsertMany(accepted, n)) {
+            failed = 1;
+            break;
+        }
+        imported += n;
+    }
+
+    if (rejects) {
+        metricsAdd(METRIC_WRITTEN, ftell(rejects));
+        fclose(rejects);
+    }
+    fclose(in);
+    free(batch.rows);
+    free(accepted);
+    metricsEnd(span);
+
+    printf("\nImported %ld record(s), rejected %ld row(s) in %.2f seconds.\n", imported, rejected, nowSeconds() - start);
+    if (rejected > IMPORT_SHOWN_REJECTS) printf("  ... %ld more.\n", rejected - IMPORT_SHOWN_REJECTS);
+    if (rejected > 0) printf("All rejected rows are listed in '%s'.\n", IMPORT_REJECTS_FILENAME);
+    if (failed) printf("The import stopped early because the data could not be saved.\n");
+}
+
+// Asks for a CSV file name and imports it.
+void bulkImportMenu() {
+    clearScreen();
+    printf("========================\n");
+    printf("  BULK IMPORT FROM CSV\n");
+    printf("========================\n\n");
+    printf("Columns: Name,Mother,Father,Mobile,Percent,Domicile,Course,DOB\n\n");
+
+    char path[MAX_LINE_LEN];
+    printf("Enter CSV file name: ");
+    fgets(path, sizeof(path), stdin);
+    path[strcspn(path, "\n")] = 0;
+    if (path[0] == 0) return;
+    importStudentsCSV(path);
+}
+
+// Handles the student registration process.
+void studentRegistration() {
+    StudentForm s; // Structure to hold the new student's data
+    if (!loadStudentStore()) { // New records are added to the in-memory store as well as the file
+        return;
+    }
+    clearScreen();
+    printf("    ############## STUDENT REGISTRATION FORM #############\n\n");
+
+    // --- Form Layout using gotoxy (for basic TUI) ---
+    // This section defines the visual layout of the form on the console.
+    int base_row = 3; // Starting row for the form fields
+    int label_col = 5;
+    int input_col = 30;
+    int current_row = base_row;
+
+    gotoxy(current_row, label_col);     printf("+---------------------+------------------------------+");
+    gotoxy(++current_row, label_col);   printf("| Name                |                              |");
     gotoxy(++current_row, label_col);   printf("+---------------------+------------------------------+");
     gotoxy(++current_row, label_col);   printf("| Mother's Name       |                              |");
     gotoxy(++current_row, label_col);   printf("+---------------------+------------------------------+");
@@ -333,538 +5050,2519 @@ void studentRegistration() {
     gotoxy(++current_row, label_col);   printf("+---------------------+------------------------------+");
     gotoxy(++current_row, label_col);   printf("| Domicile            |                              |");
     gotoxy(++current_row, label_col);   printf("+---------------------+------------------------------+");
-    gotoxy(++current_row, label_col);   printf("| Course              |                              |"); // BTech, BCA, BSc
+    gotoxy(++current_row, label_col);   printf("| Course              |                              |"); // A course of the fee policy
     gotoxy(++current_row, label_col);   printf("+---------------------+------------------------------+");
     gotoxy(++current_row, label_col);   printf("| DOB (DD/MM/YYYY)    |                              |");
     gotoxy(++current_row, label_col);   printf("+---------------------+------------------------------+");
 
-    int input_field_row = base_row + 1; // Row for the first input field
-    int error_message_row = current_row + 2; // Row for displaying error messages
+    int input_field_row = base_row + 1; // Row for the first input field
+    int error_message_row = current_row + 2; // Row for displaying error messages
+
+    // --- Get Student Details ---
+
+    // Name
+    gotoxy(input_field_row, input_col); fgets(s.name, sizeof(s.name), stdin); s.name[strcspn(s.name, "\n")] = 0;
+    input_field_row += 2;
+
+    // Mother's Name
+    gotoxy(input_field_row, input_col); fgets(s.mother, sizeof(s.mother), stdin); s.mother[strcspn(s.mother, "\n")] = 0;
+    input_field_row += 2;
+
+    // Father's Name
+    gotoxy(input_field_row, input_col); fgets(s.father, sizeof(s.father), stdin); s.father[strcspn(s.father, "\n")] = 0;
+    input_field_row += 2;
+
+    // Mobile Number (with validation)
+    do {
+        clearLine(input_field_row, input_col, NAME_LEN -1); // Clear previous input area
+        gotoxy(input_field_row, input_col);
+        fgets(s.mobile, sizeof(s.mobile), stdin);
+        s.mobile[strcspn(s.mobile, "\n")] = 0;
+        if (!isValidMobile(s.mobile)) {
+            clearLine(error_message_row, label_col, 70); // Clear previous error message
+            gotoxy(error_message_row, label_col); printf("Invalid mobile number. Please enter 10 digits only.");
+             
+            clearLine(error_message_row, label_col, 70); // Clear the error message after acknowledgment
+        } else {
+            clearLine(error_message_row, label_col, 70); // Clear any lingering error message
+            break; // Exit loop if valid
+        }
+    } while (1);
+    input_field_row += 2;
+
+    // 12th Percentage (with validation)
+    float perc_val; // To store the validated float value of percentage
+    do {
+        clearLine(input_field_row, input_col, PERCENT_LEN -1);
+        gotoxy(input_field_row, input_col);
+        fgets(s.percent, sizeof(s.percent), stdin);
+        s.percent[strcspn(s.percent, "\n")] = 0;
+        if (!isValidPercentage(s.percent, &perc_val)) {
+            clearLine(error_message_row, label_col, 70);
+            gotoxy(error_message_row, label_col); printf("Invalid percentage. Please enter a number between 0 and 100.");
+             
+            clearLine(error_message_row, label_col, 70);
+        } else {
+            clearLine(error_message_row, label_col, 70);
+            break; // Exit loop if valid
+        }
+    } while (1);
+    input_field_row += 2;
+
+    // Domicile (stored as a dictionary code)
+    char domicile[DOMICILE_LEN];
+    do {
+        clearLine(input_field_row, input_col, DOMICILE_LEN -1);
+        gotoxy(input_field_row, input_col);
+        fgets(domicile, sizeof(domicile), stdin);
+        domicile[strcspn(domicile, "\n")] = 0;
+        if (!setStudentField(&s, FIELD_DOMICILE, domicile)) {
+            clearLine(error_message_row, label_col, 70);
+            gotoxy(error_message_row, label_col); printf("Too many different domiciles are on record to add another.");
+             
+            clearLine(error_message_row, label_col, 70);
+        } else {
+            clearLine(error_message_row, label_col, 70);
+            break; // Exit loop if valid
+        }
+    } while (1);
+    input_field_row += 2;
+
+    // Course (with validation for fee calculation)
+    char course[COURSE_LEN];
+    do {
+        clearLine(input_field_row, input_col, COURSE_LEN -1);
+        gotoxy(input_field_row, input_col);
+        fgets(course, sizeof(course), stdin);
+        course[strcspn(course, "\n")] = 0;
+        s.totalFee = getTotalFee(course); // Calculate fee based on course
+        if (s.totalFee == 0.0f || !setStudentField(&s, FIELD_COURSE, course)) { // Check if course was valid (fee would be non-zero)
+            clearLine(error_message_row, label_col, 70);
+            gotoxy(error_message_row, label_col); printf("Invalid course. Please enter one of: %s.", courseListText());
+             
+            clearLine(error_message_row, label_col, 70);
+        } else {
+            clearLine(error_message_row, label_col, 70);
+            break; // Exit loop if valid
+        }
+    } while (1);
+    input_field_row += 2;
+
+    // Date of Birth (with validation; stored as DD/MM/YYYY)
+    do {
+        clearLine(input_field_row, input_col, DOB_LEN -1);
+        gotoxy(input_field_row, input_col);
+        fgets(s.dob, sizeof(s.dob), stdin);
+        s.dob[strcspn(s.dob, "\n")] = 0;
+        if (!isValidDob(s.dob)) {
+            clearLine(error_message_row, label_col, 70);
+            gotoxy(error_message_row, label_col); printf("Invalid date of birth. Please enter a past date as DD/MM/YYYY.");
+             
+            clearLine(error_message_row, label_col, 70);
+        } else {
+            clearLine(error_message_row, label_col, 70);
+            break; // Exit loop if valid
+        }
+    } while (1);
+
+    // --- Calculate Fees ---
+    computeFees(&s, perc_val);
+
+    // --- Display Fee Details (Optional) ---
+    char ch;
+    gotoxy(error_message_row + 1, label_col); printf("Do you want to view fee details? (y/n): ");
+    ch = getchar();
+    clearInputBuffer(); // Consume newline after getchar
+
+    if (tolower((unsigned char)ch) == 'y') {
+        clearScreen();
+        printf("========================\n");
+        printf("      FEE DETAILS\n");
+        printf("========================\n\n");
+        printf("+--------------------------+------------------------+\n");
+        printf("| %-24s | %-20.2f Rs  |\n", "Total Course Fee", s.totalFee);
+        printf("+--------------------------+------------------------+\n");
+        printf("| %-24s | %-20.2f Rs  |\n", "12th Percent. Discount", s.discount);
+        printf("+--------------------------+------------------------+\n");
+        printf("| %-24s | %-20.2f Rs  |\n", "Domicile Discount", s.domicileDiscount);
+        printf("+--------------------------+------------------------+\n");
+        printf("| %-24s | %-20.2f Rs  |\n", "Final Fee (Full Course)", s.finalFee);
+        printf("+--------------------------+------------------------+\n");
+        printf("| %-24s | %-20.2f Rs  |\n", "Fee per Year (Approx)", s.finalFee / 4.0f); // Assuming 4-year course
+        printf("+--------------------------+------------------------+\n\n");
+         
+    }
+
+    // --- Save Student Record to File ---
+    gotoxy(error_message_row + 3, label_col);
+    MetricsSpan span = metricsBegin(OP_REGISTER);
+    const char* duplicate = duplicateApplicant(&s);
+    int saved = !duplicate && storageInsert(&s) != -1 && journalSync(); // Also adds it to the in-memory store; reported once on disk
+    metricsEnd(span);
+    if (duplicate) {
+        printf("Error: Not registered: %s.\n", duplicate);
+        return;
+    }
+    if (!saved) {
+        printf("Error: The student record could not be saved.\n");
+        return;
+    }
+    printf("Student registered successfully! Student ID: #%u\n", s.id);
+     
+}
+
+// The listing is rendered here and written in large chunks, instead of one write per row.
+static char displayBuffer[DISPLAY_BUFFER_SIZE];
+static size_t displayBufferLen;
+
+// Writes out whatever the display buffer holds.
+static void displayFlush() {
+    fwrite(displayBuffer, 1, displayBufferLen, stdout);
+    fflush(stdout);
+    displayBufferLen = 0;
+}
+
+// Renders one table row into the display buffer, flushing it first when it is nearly full.
+static void displayAppendRow(const StudentForm* s) {
+    if (sizeof(displayBuffer) - displayBufferLen < MAX_LINE_LEN) displayFlush();
+    displayBufferLen += (size_t)formatStudentRow(displayBuffer + displayBufferLen, sizeof(displayBuffer) - displayBufferLen, s);
+}
+
+// Asks a question and reads the answer line (without the newline) into buf.
+static void readAnswer(const char* prompt, char* buf, int size) {
+    printf("%s", prompt);
+    if (fgets(buf, size, stdin) == NULL) buf[0] = 0;
+    if (strchr(buf, '\n') == NULL && !feof(stdin)) clearInputBuffer(); // Drop the rest of a long answer
+    buf[strcspn(buf, "\n")] = 0;
+}
+
+// Pages through the records in the order of sort key 'key' (see Sorted views) from position 'first' on.
+static void displaySortedStudents(int key, int reverse, int pageSize, int first) {
+    static const char* keyLabels[SORT_KEYS] = { "12th percentage", "final fee", "name", "date of birth" };
+    int* ids = malloc((size_t)pageSize * sizeof(int));
+    char answer[32];
+    StudentForm row;
+    while (ids) {
+        int total = 0;
+        int shown = sortedPage(key, reverse, first, pageSize, ids, &total);
+        if (shown < 0) break;
+        clearScreen();
+        printStudentTableHeader();
+        for (int i = 0; i < shown; i++) {
+            displayAppendRow(storeRecord(ids[i], &row));
+        }
+        displayFlush();
+        printf("====================================================================================================================================\n");
+        if (shown == 0) {
+            printf("No students from number %d on (there are %d).\n", first + 1, total);
+            free(ids);
+            return;
+        }
+        printf("Students %d-%d of %d by %s%s.\n", first + 1, first + shown, total, keyLabels[key], reverse ? " (reversed)" : "");
+        first += shown;
+        if (first >= total) {
+            free(ids);
+            return;
+        }
+
+        readAnswer("Enter for the next page, a student number to jump to it, q to go back: ", answer, sizeof(answer));
+        if (tolower((unsigned char)answer[0]) == 'q') {
+            free(ids);
+            return;
+        }
+        if (isdigit((unsigned char)answer[0]) && atoi(answer) > 0) {
+            first = atoi(answer) - 1;
+        }
+    }
+    free(ids);
+    printf("Error: Not enough memory to sort the student records.\n");
+}
+
+// Displays the student records from the in-memory store, a page at a time, as registered or sorted.
+// The slot after the last row shown is kept as a cursor, so the next page resumes there.
+void displayStudents() {
+    if (!loadStudentStore()) {
+        return;
+    }
+    if (store.liveCount == 0) {
+        printf("No student records found. The file '%s' may not exist or is empty.\n", FILENAME);
+         
+        return;
+    }
+
+    char answer[32];
+    char prompt[96];
+    readAnswer("Order (Enter: as registered, p: 12th percentage, f: final fee, n: name, d: date of birth; add r to reverse): ",
+               answer, sizeof(answer));
+    int key = tolower((unsigned char)answer[0]) == 'p' ? SORT_PERCENT : tolower((unsigned char)answer[0]) == 'f' ? SORT_FINAL_FEE
+            : tolower((unsigned char)answer[0]) == 'n' ? SORT_NAME : tolower((unsigned char)answer[0]) == 'd' ? SORT_DOB : -1;
+    int reverse = key >= 0 && tolower((unsigned char)answer[1]) == 'r';
+    snprintf(prompt, sizeof(prompt), "%d students. Rows per page (Enter for %d, 0 for all): ", store.liveCount, DISPLAY_PAGE_ROWS);
+    readAnswer(prompt, answer, sizeof(answer));
+    int pageSize = answer[0] ? atoi(answer) : DISPLAY_PAGE_ROWS;
+    if (pageSize <= 0) pageSize = store.liveCount;
+    readAnswer("Start at student number (Enter for 1): ", answer, sizeof(answer));
+    int first = answer[0] && atoi(answer) > 0 ? atoi(answer) - 1 : 0; // 0-based number of the first row on the page
+    if (key >= 0) {
+        displaySortedStudents(key, reverse, pageSize, first);
+        return;
+    }
+
+    int slot = storeSkipLive(first); // Cursor: where the page starts
+    StudentForm row;
+    while (1) {
+        clearScreen();
+        printStudentTableHeader();
+        int shown = 0;
+        for (; slot < store.count && shown < pageSize; slot++) {
+            if (store.alive[slot]) {
+                displayAppendRow(storeRecord(slot, &row));
+                shown++;
+            }
+        }
+        displayFlush();
+        printf("====================================================================================================================================\n");
+        if (shown == 0) {
+            printf("No students from number %d on (there are %d).\n", first + 1, store.liveCount);
+            return;
+        }
+        printf("Students %d-%d of %d.\n", first + 1, first + shown, store.liveCount);
+        first += shown;
+        slot = storeNextLive(slot);
+        if (slot >= store.count) {
+            return;
+        }
+
+        readAnswer("Enter for the next page, a student number to jump to it, q to go back: ", answer, sizeof(answer));
+        if (tolower((unsigned char)answer[0]) == 'q') {
+            return;
+        }
+        if (isdigit((unsigned char)answer[0]) && atoi(answer) > 0) {
+            first = atoi(answer) - 1;
+            slot = storeSkipLive(first);
+        }
+    }
+}
+
+
+// Searches for student records based on various criteria.
+// Mobile number lookups use the mobile index; the other fields are partial, case-insensitive matches
+// answered from the trigram index. Option 7 runs a compound query through the query planner.
+void searchStudent() {
+    clearScreen();
+    printf("========================\n");
+    printf("  SEARCH STUDENT RECORD\n");
+    printf("========================\n\n");
+
+    if (!loadStudentStore()) {
+        return;
+    }
+    if (store.liveCount == 0) {
+        printf("No student records found to search. File '%s' is missing or empty.\n", FILENAME);
+         
+        return;
+    }
+
+    int choice;
+    char searchTerm[NAME_LEN]; // Buffer for the search term
+
+    printf("Search By:\n");
+    printf("1. Name\n");
+    printf("2. Course\n");
+    printf("3. Mother's Name\n");
+    printf("4. Father's Name\n");
+    printf("5. Mobile Number\n");
+    printf("6. Domicile\n");
+    printf("7. Compound query (several fields, numeric ranges)\n");
+    printf("Enter your choice (1-7): ");
+
+    if (scanf("%d", &choice) != 1) {
+        printf("Invalid input. Please enter a number.\n");
+        clearInputBuffer();
+         
+        return;
+    }
+    clearInputBuffer(); // Clear newline
+
+    if (choice < 1 || choice > 7) {
+        printf("Invalid search option.\n");
+         
+        return;
+    }
+    if (choice == 7) {
+        queryStudents();
+        return;
+    }
+
+    printf("Enter search term: ");
+    fgets(searchTerm, sizeof(searchTerm), stdin);
+    searchTerm[strcspn(searchTerm, "\n")] = 0; // Remove trailing newline
+
+    // For case-insensitive string searches, convert search term to lowercase
+    char lowerSearchTerm[NAME_LEN];
+    if (choice != 5) { // Mobile number search is exact match, not case-sensitive
+        strncpy(lowerSearchTerm, searchTerm, sizeof(lowerSearchTerm) - 1);
+        lowerSearchTerm[sizeof(lowerSearchTerm) - 1] = '\0';
+        str_to_lower(lowerSearchTerm);
+    }
+
+
+    clearScreen();
+    printf("SEARCH RESULTS FOR: '%s'\n", searchTerm);
+    printStudentTableHeader();
+
+    int found = 0;
+    StudentForm row;
+    MetricsSpan span = metricsBegin(OP_SEARCH);
+
+    if (choice == 5) { // Search by Mobile Number (exact match) - served by the mobile index
+        for (int i = storeNextByMobile(searchTerm, -1); i != -1; i = storeNextByMobile(searchTerm, i)) {
+            printStudentRow(storeRecord(i, &row));
+            found = 1;
+        }
+    } else {
+        int field = FIELD_NAME; // Field selected by the search option
+        switch (choice) {
+            case 1: field = FIELD_NAME; break;     // Search by Name
+            case 2: field = FIELD_COURSE; break;   // Search by Course
+            case 3: field = FIELD_MOTHER; break;   // Search by Mother's Name
+            case 4: field = FIELD_FATHER; break;   // Search by Father's Name
+            case 6: field = FIELD_DOMICILE; break; // Search by Domicile
+        }
+
+        int* matches;
+        int n = storeFindContaining(field, lowerSearchTerm, &matches); // Partial, case-insensitive match
+        if (n < 0) {
+            metricsEnd(span);
+            printf("Error: Not enough memory to search.\n");
+            return;
+        }
+        for (int m = 0; m < n; m++) {
+            printStudentRow(storeRecord(matches[m], &row));
+        }
+        found = n > 0;
+        free(matches);
+    }
+    metricsEnd(span);
+
+    if (!found) {
+        printf("| %-126s |\n", "No matching record found.");
+    }
+
+    printf("====================================================================================================================================\n");
+     
+}
+
+// Reads "#<student ID>" (as the modify and delete prompts and batch commands accept in place of a name)
+// into *id. Returns 0 if 'text' is not of that form.
+static int parseStudentId(const char* text, unsigned int* id) {
+    char* end;
+    if (text[0] != '#' || !isdigit((unsigned char)text[1])) return 0;
+    unsigned long value = strtoul(text + 1, &end, 10);
+    if (*end != 0 || value == 0 || value >= UINT_MAX) return 0;
+    *id = (unsigned int)value;
+    return 1;
+}
+
+// When no student has the name typed, offers the closest names (see Fuzzy name lookup) and lets the
+// admin pick one, which replaces 'name'. Returns 0 if the admin cancelled, 1 to go on with 'name'.
+static int offerSimilarNames(char* name, size_t size) {
+    if (storeNextByName(name, -1) != -1) return 1;
+    NameMatch matches[FUZZY_CANDIDATES];
+    int n = storeSimilarNames(name, matches, FUZZY_CANDIDATES);
+    if (n <= 0) return 1; // Nothing close: the caller reports the name as not found
+    printf("\nNo student is named '%s'. Closest names:\n", name);
+    for (int m = 0; m < n; m++) {
+        printf("  %d. %s (%d student(s), %d edit(s) away)\n", m + 1,
+               storeText(storeNextByName(matches[m].name, -1), FIELD_NAME), matches[m].students, matches[m].distance);
+    }
+    char answer[16];
+    readAnswer("Choose a number (Enter to cancel): ", answer, sizeof(answer));
+    int choice = atoi(answer);
+    if (choice < 1 || choice > n) return 0;
+    snprintf(name, size, "%s", storeText(storeNextByName(matches[choice - 1].name, -1), FIELD_NAME));
+    return 1;
+}
+
+// Modifies an existing student record.
+// Looks the student up by student ID ("#<id>": one record, through the ID index) or by full name
+// (case-insensitive, every match, through the name index), updates the matching records in memory
+// and saves just those records (change log or binary slot).
+void modifyStudent() {
+    clearScreen();
+    printf("========================\n");
+    printf(" MODIFY STUDENT RECORD\n");
+    printf("========================\n\n");
+
+    if (!loadStudentStore()) {
+        return;
+    }
+    if (store.liveCount == 0) {
+        printf("No student records found to modify. File '%s' is missing or empty.\n", FILENAME);
+         
+        return;
+    }
+
+    char searchName[NAME_LEN];
+    unsigned int id;
+    printf("Enter the FULL NAME or #ID of the student to modify: ");
+    fgets(searchName, sizeof(searchName), stdin);
+    searchName[strcspn(searchName, "\n")] = 0; // Remove newline
+    int byId = parseStudentId(searchName, &id);
+    if (!byId && !offerSimilarNames(searchName, sizeof(searchName))) return;
+
+    int found = 0;
+    int saveFailed = 0; // 1: not saved (record unchanged), 2: saved but not synced to disk
+    StudentForm s; // To hold the updated student data
+    StudentForm original_s; // To hold original data of the student being modified for display
+
+    printf("\nProcessing records...\n");
+
+    // Collect the matches first: modifying a record may change its name and move it within the name index
+    int matchCount = 0;
+    for (int i = storeNextByName(searchName, -1); !byId && i != -1; i = storeNextByName(searchName, i)) {
+        matchCount++;
+    }
+    int* matches = malloc((size_t)(matchCount > 0 ? matchCount : 1) * sizeof(int));
+    if (!matches) {
+        printf("Error: Not enough memory.\n");
+        return;
+    }
+    matchCount = 0;
+    for (int i = storeNextByName(searchName, -1); !byId && i != -1; i = storeNextByName(searchName, i)) {
+        matches[matchCount++] = i;
+    }
+    if (byId && storeFindById(id) != -1) matches[matchCount++] = storeFindById(id);
+
+    for (int m = 0; m < matchCount; m++) {
+        found = 1;
+        storeRecord(matches[m], &original_s); // Store original data for display prompts
+        s = original_s;
+
+        printf("\n--- Student Found: %s (#%u) ---\n", original_s.name, original_s.id);
+        printf("Enter new details (leave blank and press Enter to keep current value):\n\n");
+
+        char buffer[NAME_LEN]; // Temporary buffer for inputs
+
+        // Helper macro for conditional update
+        #define GET_MODIFIED_INPUT(prompt, current_value, target_field, max_len) \
+            printf(prompt, current_value); \
+            fgets(buffer, max_len, stdin); \
+            buffer[strcspn(buffer, "\n")] = 0; \
+            if (strlen(buffer) > 0) strcpy(target_field, buffer);
+
+        GET_MODIFIED_INPUT("New Name (current: %s): ", original_s.name, s.name, sizeof(s.name));
+        GET_MODIFIED_INPUT("New Mother's Name (current: %s): ", original_s.mother, s.mother, sizeof(s.mother));
+        GET_MODIFIED_INPUT("New Father's Name (current: %s): ", original_s.father, s.father, sizeof(s.father));
+
+        // Mobile Number (with validation)
+        do {
+            printf("New Mobile Number (10-digits, current: %s): ", original_s.mobile);
+            fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
+            if (strlen(buffer) == 0) { break; } // Keep current if blank
+            if (isValidMobile(buffer)) { strcpy(s.mobile, buffer); break; }
+            printf("Invalid mobile number. Please enter 10 digits only, or leave blank to keep current.\n");
+        } while (1);
+
+        // 12th Percentage (with validation)
+        float perc_new_val;
+        do {
+            printf("New 12th Percentage (0-100, current: %s): ", original_s.percent);
+            fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
+            if (strlen(buffer) == 0) { perc_new_val = strtof(s.percent, NULL); break; } // Keep current
+            if (isValidPercentage(buffer, &perc_new_val)) { strcpy(s.percent, buffer); break; }
+            printf("Invalid percentage. Please enter a number between 0-100, or leave blank.\n");
+        } while (1);
+
+
+        // Domicile (stored as a dictionary code)
+        do {
+            printf("New Domicile (current: %s): ", studentFieldText(&original_s, FIELD_DOMICILE));
+            fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
+            if (strlen(buffer) == 0 || setStudentField(&s, FIELD_DOMICILE, buffer)) break; // Blank keeps current
+            printf("Domicile is too long, or too many different domiciles are on record; try again or leave blank.\n");
+        } while (1);
+
+        // Course (with validation for fee calculation)
+        do {
+            printf("New Course (%s, current: %s): ", courseListText(), studentFieldText(&original_s, FIELD_COURSE));
+            fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
+            if (strlen(buffer) == 0) { s.totalFee = getTotalFee(studentFieldText(&s, FIELD_COURSE)); break; } // Keep current
+            s.totalFee = getTotalFee(buffer);
+            if (s.totalFee != 0.0f && setStudentField(&s, FIELD_COURSE, buffer)) break;
+            printf("Invalid course. Please enter one of: %s, or leave blank.\n", courseListText());
+        } while (1);
+
+        // Date of Birth (with validation)
+        do {
+            printf("New DOB (DD/MM/YYYY, current: %s): ", original_s.dob);
+            fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
+            if (strlen(buffer) == 0) { break; } // Keep current if blank
+            if (isValidDob(buffer)) { strcpy(s.dob, buffer); break; }
+            printf("Invalid date of birth. Please enter a past date as DD/MM/YYYY, or leave blank.\n");
+        } while (1);
+
+        // Recalculate fees with potentially new data
+        computeFees(&s, perc_new_val);
+
+        MetricsSpan span = metricsBegin(OP_MODIFY);
+        int updated = storageUpdate(matches[m], &s); // Persist just this record, then update and re-index it in memory
+        int synced = updated && journalSync();       // Reported once on disk
+        metricsEnd(span);
+        if (!updated) {
+            saveFailed = 1;
+            break;
+        }
+        if (!synced) {
+            saveFailed = 2;
+            break;
+        }
+        printf("\nRecord updated.\n");
+    }
+    free(matches);
+
+    if (found && !saveFailed) {
+        printf("\nStudent record modified successfully!\n");
+        storageMaintain();
+    } else if (saveFailed == 2) {
+        printf("\nError: The change could not be written to disk and may be lost.\n");
+    } else if (found) {
+        printf("\nThe record could not be saved and was left unchanged.\n");
+    } else if (byId) {
+        printf("\nNo student found with the ID #%u to modify.\n", id);
+    } else {
+        printf("\nNo student found with the name '%s' to modify.\n", searchName);
+    }
+     
+}
+
+
+// Deletes a student record.
+// Looks the student up by student ID ("#<id>") or by full name (case-insensitive, every match), as
+// modifyStudent does, removes the matching records from memory and saves a tombstone for each
+// (change log or binary slot flag).
+void deleteStudent() {
+    clearScreen();
+    printf("========================\n");
+    printf(" DELETE STUDENT RECORD\n");
+    printf("========================\n\n");
+
+    if (!loadStudentStore()) {
+        return;
+    }
+    if (store.liveCount == 0) {
+        printf("No student records found to delete. File '%s' is missing or empty.\n", FILENAME);
+         
+        return;
+    }
+
+    char deleteName[NAME_LEN];
+    unsigned int id;
+    printf("Enter the FULL NAME or #ID of the student to delete: ");
+    fgets(deleteName, sizeof(deleteName), stdin);
+    deleteName[strcspn(deleteName, "\n")] = 0; // Remove newline
+    int byId = parseStudentId(deleteName, &id);
+    if (!byId && !offerSimilarNames(deleteName, sizeof(deleteName))) return;
+
+    int found = 0;
+
+    printf("\nProcessing records...\n");
+
+    MetricsSpan span = metricsBegin(OP_DELETE);
+    int i = byId ? storeFindById(id) : storeNextByName(deleteName, -1);
+    while (i != -1) {
+        int nextMatch = byId ? -1 : storeNextByName(deleteName, i); // Find the next match before unlinking this one
+        printf("Found student '%s' (#%u). Deleting record...\n", storeText(i, FIELD_NAME), store.records[i].id);
+        if (!storageDelete(i)) { // Persist the deletion, then drop the record from memory
+            break;
+        }
+        found = 1;
+        i = nextMatch;
+    }
+    int synced = !found || journalSync(); // Reported once on disk
+    metricsEnd(span);
+
+    if (found && !synced) {
+        printf("\nError: The deletion could not be written to disk and may be lost.\n");
+    } else if (found) {
+        printf("\nStudent record deleted successfully!\n");
+        storageMaintain();
+    } else if (i != -1) {
+        // The change log could not be written; nothing was deleted
+    } else if (byId) {
+        printf("\nNo student found with the ID #%u to delete.\n", id);
+    } else {
+        printf("\nNo student found with the name '%s' to delete.\n", deleteName);
+    }
+     
+}
+
+// ---------------------------------------------------------------------------------------------
+// Compound queries
+// ---------------------------------------------------------------------------------------------
+// A query is predicates joined by "and", each "<field> <op> <value>", for example
+//   course ~ btech and percent > 85 and domicile = uttarakhand
+// Operators: ~ (contains), = (equals), and < <= > >= on the numeric fields (percent and the fees) and on
+// dob, whose values are dates (DD/MM/YYYY): its comparisons together make one date range, answered from
+// the dob view (see Date of birth ranges). Text comparisons ignore case. The planner estimates how many
+// records each predicate's index would produce, drives the query from the most selective one and checks
+// the other predicates on those candidates only. Without a usable index it scans every record.
+
+// Field names used by queries and batch commands, indexed by FIELD_*.
+static const char* fieldKeys[STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS] = {
+    "name", "mother", "father", "mobile", "percent", "domicile", "course", "dob",
+    "totalfee", "discount", "domicilediscount", "finalfee"
+};
+
+static const char* queryOpText[] = { "~", "=", "<", "<=", ">", ">=" };
+static const char* queryAccessText[] = { "full scan", "name index", "mobile index", "trigram index", "dob index" };
+
+// Returns the FIELD_* number of a field name (case-insensitive), or -1.
+static int fieldNumber(const char* key) {
+    for (int f = 0; f < STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS; f++) {
+        if (equalsIgnoreCase(fieldKeys[f], key)) return f;
+    }
+    return -1;
+}
+
+// 1 if predicates compare field 'field' as a number (the date of birth as a packed date).
+static int queryNumeric(int field) {
+    return field == FIELD_PERCENT || field == FIELD_DOB || field >= STUDENT_TEXT_FIELDS;
+}
 
-    // --- Get Student Details ---
+// Numeric value of field 'field' of record 'idx' (the percentage is stored as text).
+static float storeNumber(int idx, int field) {
+    const PackedStudent* p = &store.records[idx];
+    switch (field) {
+        case FIELD_PERCENT:           return strtof(storeText(idx, FIELD_PERCENT), NULL);
+        case FIELD_DOB:               return (float)p->dob;
+        case FIELD_TOTAL_FEE:         return p->totalFee;
+        case FIELD_DISCOUNT:          return p->discount;
+        case FIELD_DOMICILE_DISCOUNT: return p->domicileDiscount;
+        default:                      return p->finalFee;
+    }
+}
 
-    // Name
-    gotoxy(input_field_row, input_col); fgets(s.name, sizeof(s.name), stdin); s.name[strcspn(s.name, "\n")] = 0;
-    input_field_row += 2;
+// Parses a query into predicates. Returns NULL on success or a description of the problem.
+const char* parseQuery(const char* text, Query* q) {
+    static __thread char message[96]; // One per thread: the server parses queries on several threads at once
+    char buf[MAX_LINE_LEN];
+    if (strlen(text) >= sizeof(buf)) return "query is too long";
+    strcpy(buf, text);
+    str_to_lower(buf); // Fields, "and" and values are all case-insensitive
+    q->count = 0;
 
-    // Mother's Name
-    gotoxy(input_field_row, input_col); fgets(s.mother, sizeof(s.mother), stdin); s.mother[strcspn(s.mother, "\n")] = 0;
-    input_field_row += 2;
+    char* p = buf;
+    while (1) {
+        char* end = strstr(p, " and ");
+        if (end) *end = 0;
+        if (q->count == QUERY_MAX_PREDICATES) return "too many predicates";
+        QueryPredicate* pred = &q->preds[q->count];
 
-    // Father's Name
-    gotoxy(input_field_row, input_col); fgets(s.father, sizeof(s.father), stdin); s.father[strcspn(s.father, "\n")] = 0;
-    input_field_row += 2;
+        while (*p == ' ') p++;
+        char* key = p;
+        while (isalpha((unsigned char)*p)) p++;
+        char keyEnd = *p;
+        *p = 0;
+        pred->field = fieldNumber(key);
+        if (pred->field < 0) {
+            snprintf(message, sizeof(message), "unknown field '%.40s'", key);
+            return message;
+        }
+        *p = keyEnd;
+        while (*p == ' ') p++;
+        pred->op = -1;
+        for (int op = QUERY_GE; op >= 0 && pred->op < 0; op--) { // Longest operators first
+            size_t len = strlen(queryOpText[op]);
+            if (strncmp(p, queryOpText[op], len) == 0) {
+                pred->op = op;
+                p += len;
+            }
+        }
+        if (pred->op < 0) {
+            snprintf(message, sizeof(message), "expected an operator (~ = < <= > >=) after '%s'", fieldKeys[pred->field]);
+            return message;
+        }
 
-    // Mobile Number (with validation)
-    do {
-        clearLine(input_field_row, input_col, NAME_LEN -1); // Clear previous input area
-        gotoxy(input_field_row, input_col);
-        fgets(s.mobile, sizeof(s.mobile), stdin);
-        s.mobile[strcspn(s.mobile, "\n")] = 0;
-        if (!isValidMobile(s.mobile)) {
-            clearLine(error_message_row, label_col, 70); // Clear previous error message
-            gotoxy(error_message_row, label_col); printf("Invalid mobile number. Please enter 10 digits only.");
-             
-            clearLine(error_message_row, label_col, 70); // Clear the error message after acknowledgment
-        } else {
-            clearLine(error_message_row, label_col, 70); // Clear any lingering error message
-            break; // Exit loop if valid
+        while (*p == ' ') p++;
+        size_t len = strlen(p);
+        while (len > 0 && p[len - 1] == ' ') len--;
+        if (len >= 2 && p[0] == '"' && p[len - 1] == '"') { p++; len -= 2; } // Optional quotes
+        if (len == 0) {
+            snprintf(message, sizeof(message), "missing value for '%s'", fieldKeys[pred->field]);
+            return message;
         }
-    } while (1);
-    input_field_row += 2;
+        if (len >= sizeof(pred->text)) return "value is too long";
+        memcpy(pred->text, p, len);
+        pred->text[len] = 0;
 
-    // 12th Percentage (with validation)
-    float perc_val; // To store the validated float value of percentage
-    do {
-        clearLine(input_field_row, input_col, PERCENT_LEN -1);
-        gotoxy(input_field_row, input_col);
-        fgets(s.percent, sizeof(s.percent), stdin);
-        s.percent[strcspn(s.percent, "\n")] = 0;
-        if (!isValidPercentage(s.percent, &perc_val)) {
-            clearLine(error_message_row, label_col, 70);
-            gotoxy(error_message_row, label_col); printf("Invalid percentage. Please enter a number between 0 and 100.");
-             
-            clearLine(error_message_row, label_col, 70);
+        int numeric = queryNumeric(pred->field);
+        if (pred->field == FIELD_DOB && pred->op != QUERY_CONTAINS) {
+            pred->number = (float)dobDate(pred->text);
+            if (pred->number == 0.0f) return "'dob' needs a date (DD/MM/YYYY)";
+        } else if (numeric && pred->op != QUERY_CONTAINS) {
+            char* numEnd;
+            pred->number = strtof(pred->text, &numEnd);
+            if (numEnd == pred->text || *numEnd != 0) {
+                snprintf(message, sizeof(message), "'%s' needs a number", fieldKeys[pred->field]);
+                return message;
+            }
+        } else if (pred->op != QUERY_CONTAINS && pred->op != QUERY_EQ) {
+            snprintf(message, sizeof(message), "'%s' is not numeric; use ~ or =", fieldKeys[pred->field]);
+            return message;
+        }
+        if (numeric && pred->op == QUERY_CONTAINS && pred->field >= STUDENT_TEXT_FIELDS) {
+            snprintf(message, sizeof(message), "'%s' is numeric; use = < <= > >=", fieldKeys[pred->field]);
+            return message;
+        }
+        q->count++;
+
+        if (!end) break;
+        p = end + 5;
+    }
+    return NULL;
+}
+
+static int compareInts(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Returns 1 if record 'idx' satisfies a predicate.
+static int queryMatches(const QueryPredicate* pred, int idx) {
+    if (studentFields[pred->field].dict) return codeMatches(pred->codes, storeCode(idx, pred->field));
+    if (pred->op == QUERY_CONTAINS) return fieldContains(idx, pred->field, pred->text);
+    if (queryNumeric(pred->field)) {
+        float value = storeNumber(idx, pred->field);
+        if (pred->field == FIELD_DOB && value == 0.0f) return 0; // Not a date: outside every date range
+        switch (pred->op) {
+            case QUERY_EQ: return value == pred->number;
+            case QUERY_LT: return value < pred->number;
+            case QUERY_LE: return value <= pred->number;
+            case QUERY_GT: return value > pred->number;
+            default:       return value >= pred->number;
+        }
+    }
+    return equalsIgnoreCase(storeText(idx, pred->field), pred->text);
+}
+
+// Cost class of checking a predicate on one record: numbers and dictionary codes, then equality, then substrings.
+static int queryCheckCost(const QueryPredicate* pred) {
+    if (studentFields[pred->field].dict) return 0;
+    if (pred->op == QUERY_CONTAINS) return 2;
+    return queryNumeric(pred->field) ? 0 : 1;
+}
+
+// Narrows [*from, *to] to the dates of birth a dob comparison allows.
+static void queryDobRange(const QueryPredicate* pred, unsigned int* from, unsigned int* to) {
+    unsigned int date = (unsigned int)pred->number;
+    if ((pred->op == QUERY_EQ || pred->op == QUERY_GT || pred->op == QUERY_GE) && date + (pred->op == QUERY_GT) > *from) {
+        *from = date + (pred->op == QUERY_GT);
+    }
+    if ((pred->op == QUERY_EQ || pred->op == QUERY_LT || pred->op == QUERY_LE) && date - (pred->op == QUERY_LT) < *to) {
+        *to = date - (pred->op == QUERY_LT);
+    }
+}
+
+// Chooses how to run a query: estimates the records each predicate's index would produce,
+// picks the smallest as the driver and orders the other predicates cheapest first.
+void planQuery(Query* q) {
+    q->driver = -1;
+    q->access = QUERY_SCAN;
+    q->estimate = store.liveCount;
+    q->dobFrom = 1;
+    q->dobTo = UINT_MAX;
+    for (int i = 0; i < q->count; i++) {
+        if (q->preds[i].field == FIELD_DOB && q->preds[i].op != QUERY_CONTAINS) queryDobRange(&q->preds[i], &q->dobFrom, &q->dobTo);
+    }
+    for (int i = 0; i < q->count; i++) {
+        QueryPredicate* pred = &q->preds[i];
+        int access = QUERY_SCAN;
+        long estimate = -1;
+        if (studentFields[pred->field].dict) { // The values are few: match them once, then compare codes
+            pred->codeCount = dictMatchCodes(studentFields[pred->field].dict, pred->text, pred->op == QUERY_EQ, pred->codes);
+        } else if (pred->op == QUERY_EQ && (pred->field == FIELD_NAME || pred->field == FIELD_MOBILE)) {
+            access = pred->field == FIELD_NAME ? QUERY_NAME_INDEX : QUERY_MOBILE_INDEX;
+            estimate = 0; // Exact count: walk the chain
+            for (int k = pred->field == FIELD_NAME ? storeNextByName(pred->text, -1) : storeNextByMobile(pred->text, -1);
+                 k != -1;
+                 k = pred->field == FIELD_NAME ? storeNextByName(pred->text, k) : storeNextByMobile(pred->text, k)) {
+                estimate++;
+            }
+        } else if (pred->field == FIELD_DOB && pred->op != QUERY_CONTAINS) {
+            unsigned int from = 1, to = UINT_MAX;
+            queryDobRange(pred, &from, &to);
+            pred->estimate = storeFindBorn(from, to, NULL); // Exact counts: two binary searches each
+            estimate = storeFindBorn(q->dobFrom, q->dobTo, NULL); // The range of all the dob comparisons
+            if (estimate >= 0) access = QUERY_DOB_INDEX;
+        } else if (pred->op == QUERY_CONTAINS || pred->op == QUERY_EQ) {
+            estimate = storeEstimateContaining(pred->field, pred->text); // Equality implies containment
+            if (estimate >= 0) access = QUERY_TRIGRAM_INDEX;
+        }
+        if (access != QUERY_DOB_INDEX) pred->estimate = access == QUERY_SCAN ? store.liveCount : estimate;
+        else if (pred->estimate < 0) pred->estimate = store.liveCount;
+        if (access != QUERY_SCAN && estimate < q->estimate) {
+            q->driver = i;
+            q->access = access;
+            q->estimate = estimate;
+        }
+    }
+
+    q->checkCount = 0;
+    for (int cost = 0; cost < 3; cost++) {
+        for (int i = 0; i < q->count; i++) {
+            // The hash indexes and the trigram search verify their own predicate; trigram candidates
+            // for an equality still need the equality checked. The date range verifies every dob comparison.
+            int verified = i == q->driver && !(q->access == QUERY_TRIGRAM_INDEX && q->preds[i].op == QUERY_EQ);
+            if (q->access == QUERY_DOB_INDEX && q->preds[i].field == FIELD_DOB && q->preds[i].op != QUERY_CONTAINS) verified = 1;
+            if (!verified && queryCheckCost(&q->preds[i]) == cost) q->checks[q->checkCount++] = i;
+        }
+    }
+}
+
+// filterRecords callback: 1 if record 'idx' passes every check of the query.
+static int queryCandidate(const void* ctx, int idx) {
+    const Query* q = ctx;
+    for (int k = 0; k < q->checkCount; k++) {
+        if (!queryMatches(&q->preds[q->checks[k]], idx)) return 0;
+    }
+    return 1;
+}
+
+// Runs a planned query; the checks on the candidates run on worker threads when there are many. Stores a
+// malloc'd array of the matching record indices (in record order) in *out (free it) and returns the count,
+// or -1 if out of memory. q->candidates is set to the records examined.
+int runQuery(Query* q, int** out) {
+    int* ids;
+    int n = 0;
+    const QueryPredicate* driver = q->driver >= 0 ? &q->preds[q->driver] : NULL;
+    if (q->access == QUERY_TRIGRAM_INDEX || q->access == QUERY_DOB_INDEX) {
+        n = q->access == QUERY_TRIGRAM_INDEX ? storeFindContaining(driver->field, driver->text, &ids)
+                                             : storeFindBorn(q->dobFrom, q->dobTo, &ids);
+        if (n < 0) return -1;
+        if (q->access == QUERY_DOB_INDEX) qsort(ids, (size_t)n, sizeof(int), compareInts); // The range is in date order
+    } else {
+        ids = malloc((size_t)(q->estimate > 0 ? q->estimate : 1) * sizeof(int));
+        if (!ids) return -1;
+        if (q->access == QUERY_NAME_INDEX) {
+            for (int k = storeNextByName(driver->text, -1); k != -1; k = storeNextByName(driver->text, k)) ids[n++] = k;
+        } else if (q->access == QUERY_MOBILE_INDEX) {
+            for (int k = storeNextByMobile(driver->text, -1); k != -1; k = storeNextByMobile(driver->text, k)) ids[n++] = k;
         } else {
-            clearLine(error_message_row, label_col, 70);
-            break; // Exit loop if valid
+            for (int k = storeNextLive(0); k < store.count; k = storeNextLive(k + 1)) ids[n++] = k;
         }
-    } while (1);
-    input_field_row += 2;
+        if (q->access != QUERY_SCAN) qsort(ids, (size_t)n, sizeof(int), compareInts); // Chains are not in record order
+    }
 
-    // Domicile
-    gotoxy(input_field_row, input_col); fgets(s.domicile, sizeof(s.domicile), stdin); s.domicile[strcspn(s.domicile, "\n")] = 0;
-    input_field_row += 2;
+    q->candidates = n;
+    *out = ids;
+    return q->checkCount > 0 ? filterRecords(ids, n, queryCandidate, q) : n;
+}
 
-    // Course (with validation for fee calculation)
+// Writes the plan of a query, one step per line, each line starting with 'prefix'.
+void explainQuery(FILE* out, const char* prefix, const Query* q) {
+    int step = 1;
+    if (q->access == QUERY_DOB_INDEX) { // One range for all the dob comparisons
+        fprintf(out, "%s%d. %s:", prefix, step++, queryAccessText[q->access]);
+        const char* joint = " ";
+        for (int i = 0; i < q->count; i++) {
+            const QueryPredicate* pred = &q->preds[i];
+            if (pred->field != FIELD_DOB || pred->op == QUERY_CONTAINS) continue;
+            fprintf(out, "%sdob %s '%s'", joint, queryOpText[pred->op], pred->text);
+            joint = " and ";
+        }
+        fprintf(out, " (estimated %ld of %d records)\n", q->estimate, store.liveCount);
+    } else if (q->driver >= 0) {
+        const QueryPredicate* pred = &q->preds[q->driver];
+        fprintf(out, "%s%d. %s: %s %s '%s' (estimated %ld of %d records)\n", prefix, step++, queryAccessText[q->access],
+                fieldKeys[pred->field], queryOpText[pred->op], pred->text, q->estimate, store.liveCount);
+    } else {
+        fprintf(out, "%s%d. full scan of %d records (no predicate can use an index)\n", prefix, step++, store.liveCount);
+    }
+    for (int k = 0; k < q->checkCount; k++) {
+        const QueryPredicate* pred = &q->preds[q->checks[k]];
+        fprintf(out, "%s%d. check %s %s '%s'", prefix, step++, fieldKeys[pred->field], queryOpText[pred->op], pred->text);
+        if (studentFields[pred->field].dict) fprintf(out, " (code compare: %d matching value(s))", pred->codeCount);
+        else if (pred->estimate != store.liveCount) fprintf(out, " (index would give %ld)", pred->estimate);
+        fprintf(out, "\n");
+    }
+}
+
+// Asks for a compound query, shows its plan and lists the matching students.
+void queryStudents() {
+    char text[MAX_LINE_LEN];
+    Query q;
+    printf("Enter query (e.g. course ~ btech and percent > 85 and domicile = uttarakhand):\n> ");
+    if (fgets(text, sizeof(text), stdin) == NULL) return;
+    text[strcspn(text, "\n")] = 0;
+
+    const char* error = parseQuery(text, &q);
+    if (error) {
+        printf("Invalid query: %s.\n", error);
+        return;
+    }
+    MetricsSpan span = metricsBegin(OP_QUERY);
+    double start = nowSeconds();
+    planQuery(&q);
+    int* matches;
+    int n = runQuery(&q, &matches);
+    double seconds = nowSeconds() - start;
+    metricsEnd(span);
+    if (n < 0) {
+        printf("Error: Not enough memory to run the query.\n");
+        return;
+    }
+
+    clearScreen();
+    printf("QUERY: %s\nPlan:\n", text);
+    explainQuery(stdout, "  ", &q);
+    printf("\n");
+    printStudentTableHeader();
+    StudentForm row;
+    for (int m = 0; m < n; m++) {
+        printStudentRow(storeRecord(matches[m], &row));
+    }
+    if (n == 0) {
+        printf("| %-126s |\n", "No matching record found.");
+    }
+    printf("====================================================================================================================================\n");
+    printf("%d matching student(s); %d candidate(s) examined in %.3f ms.\n", n, q.candidates, seconds * 1000.0);
+    free(matches);
+}
+
+// ---------------------------------------------------------------------------------------------
+// CSV and JSON export
+// ---------------------------------------------------------------------------------------------
+// Writes the roster, or the results of a search or query, in a form other programs can read:
+//   CSV   a header row of field names ("id", then fieldKeys), then one row per student. Fields holding a
+//         comma, quote or line break are quoted, with "" for a quote (as bulk import reads them).
+//   JSON  an array with one object per student, keyed by the same field names. Text fields are strings,
+//         the student ID and fees are numbers.
+// Rows are rendered straight from the store into one buffer of EXPORT_BUFFER_SIZE bytes, which is written
+// out each time it fills, so memory use is the same whatever the roster size. A file is unbuffered in
+// stdio, so each block goes to the disk in a single write().
+
+enum { EXPORT_CSV, EXPORT_JSON };
+static const char* const exportFormatNames[] = { "csv", "json" };
+
+typedef struct {
+    FILE* fp;
+    char* buf;
+    size_t len;     // Bytes rendered but not yet written
+    int format;
+    int failed;     // A write failed
+} ExportWriter;
+
+// Returns the EXPORT_* number of a format name (case-insensitive), or -1.
+static int exportFormatNumber(const char* name) {
+    for (int f = EXPORT_CSV; f <= EXPORT_JSON; f++) {
+        if (equalsIgnoreCase(exportFormatNames[f], name)) return f;
+    }
+    return -1;
+}
+
+// Writes out whatever the buffer holds.
+static void exportFlush(ExportWriter* w) {
+    if (w->len > 0 && fwrite(w->buf, 1, w->len, w->fp) != w->len) w->failed = 1;
+    metricsAdd(METRIC_WRITTEN, (long long)w->len);
+    w->len = 0;
+}
+
+// Formats a fee like "%.2f" does, without the cost of printf: a float times 100 is exact in a double,
+// which is rounded to whole cents with halves to even, as printf does. Returns the length written.
+static int exportFee(char* out, float fee) {
+    double cents = (double)fee * 100.0;
+    if (!(cents > -1e15 && cents < 1e15)) return sprintf(out, "%.2f", fee); // Huge, infinite or NaN
+    unsigned int bits;
+    memcpy(&bits, &fee, sizeof(bits));
+    int negative = bits >> 31; // printf writes "-0.00" for -0 and for what rounds to it
+    if (negative) cents = -cents;
+    unsigned long long v = (unsigned long long)cents;
+    double fraction = cents - (double)v;
+    if (fraction > 0.5 || (fraction == 0.5 && (v & 1))) v++;
+    char digits[24];
+    int n = 0, len = 0;
     do {
-        clearLine(input_field_row, input_col, COURSE_LEN -1);
-        gotoxy(input_field_row, input_col);
-        fgets(s.course, sizeof(s.course), stdin);
-        s.course[strcspn(s.course, "\n")] = 0;
-        s.totalFee = getTotalFee(s.course); // Calculate fee based on course
-        if (s.totalFee == 0.0f) { // Check if course was valid (fee would be non-zero)
-            clearLine(error_message_row, label_col, 70);
-            gotoxy(error_message_row, label_col); printf("Invalid course. Please enter BTech, BCA, or BSc.");
-             
-            clearLine(error_message_row, label_col, 70);
-        } else {
-            clearLine(error_message_row, label_col, 70);
-            break; // Exit loop if valid
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0 || n < 3); // At least one digit before the point
+    if (negative) out[len++] = '-';
+    while (n > 2) out[len++] = digits[--n];
+    out[len++] = '.';
+    out[len++] = digits[1];
+    out[len++] = digits[0];
+    return len;
+}
+
+static void exportPut(ExportWriter* w, const char* text, size_t len) {
+    memcpy(w->buf + w->len, text, len);
+    w->len += len;
+}
+
+// Appends a text field, quoted and escaped as the format requires.
+static void exportText(ExportWriter* w, const char* text) {
+    char* out = w->buf + w->len;
+    if (w->format == EXPORT_CSV) {
+        if (!strpbrk(text, ",\"\r\n")) {
+            size_t len = strlen(text);
+            memcpy(out, text, len);
+            w->len += len;
+            return;
+        }
+        *out++ = '"';
+        for (const char* p = text; *p; p++) {
+            if (*p == '"') *out++ = '"';
+            *out++ = *p;
+        }
+        *out++ = '"';
+    } else {
+        *out++ = '"';
+        for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+            if (*p == '"' || *p == '\\') {
+                *out++ = '\\';
+                *out++ = (char)*p;
+            } else if (*p < 0x20) {
+                out += sprintf(out, "\\u%04x", *p);
+            } else {
+                *out++ = (char)*p;
+            }
+        }
+        *out++ = '"';
+    }
+    w->len = (size_t)(out - w->buf);
+}
+
+// Appends record 'idx' as one row (CSV) or object (JSON), reading its fields in place.
+static void exportRecord(ExportWriter* w, int idx, int first) {
+    static const char* const jsonKeys[STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS] = { // fieldKeys as object keys
+        ",\"name\":", ",\"mother\":", ",\"father\":", ",\"mobile\":", ",\"percent\":", ",\"domicile\":",
+        ",\"course\":", ",\"dob\":", ",\"totalfee\":", ",\"discount\":", ",\"domicilediscount\":", ",\"finalfee\":"
+    };
+    const PackedStudent* p = &store.records[idx];
+    const float fees[STUDENT_FEE_FIELDS] = { p->totalFee, p->discount, p->domicileDiscount, p->finalFee };
+    if (EXPORT_BUFFER_SIZE - w->len < EXPORT_ROW_BYTES) exportFlush(w);
+    int json = w->format == EXPORT_JSON;
+    if (json && !first) exportPut(w, ",", 1);
+    if (json) exportPut(w, "\n  {\"id\":", 9);
+    w->len += (size_t)sprintf(w->buf + w->len, "%u", p->id);
+    for (int f = 0; f < STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS; f++) {
+        if (json) exportPut(w, jsonKeys[f], strlen(jsonKeys[f]));
+        else exportPut(w, ",", 1);
+        if (f < STUDENT_TEXT_FIELDS) exportText(w, storeText(idx, f));
+        else w->len += (size_t)exportFee(w->buf + w->len, fees[f - STUDENT_TEXT_FIELDS]);
+    }
+    exportPut(w, json ? "}" : "\n", 1);
+}
+
+// Writes records ids[0 .. count) in that order, or every live record if ids is NULL, to fp in 'format'.
+// Returns the number of records written, or -1 if out of memory or a write failed.
+long exportStudents(FILE* fp, int format, const int* ids, int count) {
+    ExportWriter w = { fp, malloc(EXPORT_BUFFER_SIZE), 0, format, 0 };
+    if (!w.buf) return -1;
+    long rows = 0;
+    if (format == EXPORT_CSV) {
+        exportPut(&w, "id", 2);
+        for (int f = 0; f < STUDENT_TEXT_FIELDS + STUDENT_FEE_FIELDS; f++) {
+            w.len += (size_t)sprintf(w.buf + w.len, ",%s", fieldKeys[f]);
+        }
+        exportPut(&w, "\n", 1);
+    } else {
+        exportPut(&w, "[", 1);
+    }
+    if (ids) {
+        for (int m = 0; m < count && !w.failed; m++) exportRecord(&w, ids[m], rows++ == 0);
+    } else {
+        for (int i = 0; i < store.count && !w.failed; i++) {
+            if (store.alive[i]) exportRecord(&w, i, rows++ == 0);
+        }
+    }
+    if (format == EXPORT_JSON) exportPut(&w, rows > 0 ? "\n]\n" : "]\n", rows > 0 ? 3 : 2);
+    exportFlush(&w);
+    free(w.buf);
+    metricsAdd(METRIC_ROWS, rows);
+    return w.failed ? -1 : rows;
+}
+
+// Exports to the file at 'path' (replaced if it exists). A failed export removes the partial file.
+// Returns the number of records written, or -1 on failure (after printing why).
+static long exportStudentsToFile(const char* path, int format, const int* ids, int count) {
+    FILE* fp = openFile(path, "w");
+    if (!fp) {
+        printf("Error: Could not create export file '%s'.\n", path);
+        perror("Reason");
+        return -1;
+    }
+    setvbuf(fp, NULL, _IONBF, 0); // exportStudents does its own buffering
+    long rows = exportStudents(fp, format, ids, count);
+    if (fclose(fp) != 0 || rows < 0) {
+        printf("Error: Could not write export file '%s'.\n", path);
+        perror("Reason");
+        remove(path);
+        return -1;
+    }
+    return rows;
+}
+
+// Indices of the live records matching a search on 'field' for 'term' (mobile: exact, other fields:
+// partial and case-insensitive, as in searchStudent). Returns the count (*out is malloc'd), or -1.
+static int exportSearch(int field, const char* term, int** out) {
+    if (field != FIELD_MOBILE) {
+        char lowerTerm[NAME_LEN];
+        snprintf(lowerTerm, sizeof(lowerTerm), "%s", term);
+        str_to_lower(lowerTerm);
+        return storeFindContaining(field, lowerTerm, out);
+    }
+    int n = 0;
+    for (int i = storeNextByMobile(term, -1); i != -1; i = storeNextByMobile(term, i)) n++;
+    *out = malloc((size_t)(n > 0 ? n : 1) * sizeof(int));
+    if (!*out) return -1;
+    n = 0;
+    for (int i = storeNextByMobile(term, -1); i != -1; i = storeNextByMobile(term, i)) (*out)[n++] = i;
+    return n;
+}
+
+// Asks for a format, a file and optionally a search, and exports the matching students.
+void exportMenu() {
+    char answer[MAX_LINE_LEN], path[MAX_LINE_LEN], term[NAME_LEN];
+    readAnswer("Format (csv or json): ", answer, sizeof(answer));
+    int format = exportFormatNumber(answer);
+    if (format < 0) {
+        printf("Unknown format '%s'.\n", answer);
+        return;
+    }
+    readAnswer("Export to file: ", path, sizeof(path));
+    if (path[0] == 0) {
+        printf("No file name given.\n");
+        return;
+    }
+    readAnswer("Only students matching a search on field (name, mother, father, mobile, percent, domicile, course, dob;\n"
+               "Enter for every student): ", answer, sizeof(answer));
+    int field = answer[0] ? fieldNumber(answer) : -1;
+    if (answer[0] && (field < 0 || field >= STUDENT_TEXT_FIELDS)) {
+        printf("Unknown field '%s'.\n", answer);
+        return;
+    }
+    if (field >= 0) {
+        readAnswer("Search term: ", term, sizeof(term));
+        if (term[0] == 0) {
+            printf("No search term given.\n");
+            return;
+        }
+    }
+
+    MetricsSpan span = metricsBegin(OP_EXPORT);
+    double start = nowSeconds();
+    int* matches = NULL;
+    int n = field >= 0 ? exportSearch(field, term, &matches) : 0;
+    long rows = n < 0 ? -1 : exportStudentsToFile(path, format, matches, n);
+    double seconds = nowSeconds() - start;
+    metricsEnd(span);
+    free(matches);
+    if (n < 0) {
+        printf("Error: Not enough memory to search.\n");
+    } else if (rows >= 0) {
+        printf("Exported %ld student(s) to '%s' as %s in %.3f s.\n", rows, path, exportFormatNames[format], seconds);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Batch mode
+// ---------------------------------------------------------------------------------------------
+// Runs admin operations without the menus or screen control, so scripts and pipelines can drive them:
+//   01ProjectAlok --batch [file]             one command per line from 'file' (stdin if omitted or "-")
+//   01ProjectAlok --run <command> [args...]  a single command, each argument a separate word
+// In a script a command and its arguments are separated by '|'; blank lines and '#' comments are skipped.
+//   register|<name>|<mother>|<father>|<mobile>|<percent>|<domicile>|<course>|<dob>
+//   display[|<limit>|<cursor>]                    at most <limit> records from <cursor> (0 = the start); the
+//                                                  answer is OK|display|<n>|<next cursor, or "end">
+//   search|<field>|<term>                          mobile is an exact match, other fields partial and case-insensitive
+//   modify|<full name>|<field>=<value>[|...]       fees are recomputed; nothing is saved if any result is invalid
+//   delete|<full name>                             every student with that name; "#<student ID>" in place of the
+//                                                  name modifies or deletes just that student
+//   suggest|<name>[|<count>]                       the closest names of students (see Fuzzy name lookup), as
+//                                                  NAME|<case-folded name>|<edits away>|<students> lines
+//   query|<compound query>                         see Compound queries
+//   explain|<compound query>                       the plan, as PLAN|<step> lines, without running the query
+//   top|<key>|<k>[|reverse]                        the first <k> records in the order of <key> (a merit list)
+//   sorted|<key>[|reverse][|<limit>|<position>]    the records in the order of <key>; with a limit, at most <limit>
+//                                                  from <position> (0 = the first), answered with
+//                                                  OK|sorted|<n>|<next position, or "end">
+//   stats                                          head counts and fee totals (in paise) as
+//                                                  AGG|<all, course or domicile>|<name>|<students>|<total fee>|
+//                                                  <discount>|<domicile discount>|<final fee> lines
+//   ages[|<years per bucket>[|<date>]]             students by age on <date> (DD/MM/YYYY; today if omitted) as
+//                                                  AGE|<from age>|<to age>|<students> lines, youngest first,
+//                                                  then AGE|-|-|<students> for the rest (no usable date of birth,
+//                                                  or born after <date>)
+//   metrics[|save|reset]                           the operation metrics as METRIC lines (see Metrics); "save"
+//                                                  also writes them to METRICS_FILENAME, "reset" then clears them
+//   export|<csv or json>|<file>[|<field>|<term>]   the roster, or the results of that search, written to <file>
+//   export|<csv or json>|<file>|query|<query>      (see CSV and JSON export); with <file> "-" the data takes the
+//                                                  place of the ROW lines. OK|export|<number of records>
+// Sort keys: percent and finalfee (highest first), dob (youngest first), name (A-Z); "reverse" lists the
+// other way round.
+// Fields: name, mother, father, mobile, percent, domicile, course, dob. Every command answers with
+//   ROW|<record as stored in the data file>   per record registered, listed, modified (new contents) or deleted;
+//                                             its last field is the student ID
+//   OK|<command>|<number of records>          or   ERR|<command>|<reason>
+// Answers to register, modify and delete are held back until the change is on disk: a consumer never reads
+// OK for a write a crash could still lose. They are released in groups, before the next reading command
+// and at the end, so a script of many writes still syncs once per group.
+// Other lines are diagnostics from the storage layer. A summary with the throughput goes to stderr.
+
+// Returns 1 for the batch commands that change the roster.
+static int batchCommandWrites(const char* name) {
+    return strcmp(name, "register") == 0 || strcmp(name, "modify") == 0 || strcmp(name, "delete") == 0;
+}
+
+// Returns the FIELD_* number of a text field name (see fieldKeys), or -1.
+static int batchFieldNumber(const char* name) {
+    int field = fieldNumber(name);
+    return field < STUDENT_TEXT_FIELDS ? field : -1;
+}
+
+// Writes a record as a ROW line.
+static void batchPrintRow(FILE* out, const StudentForm* s) {
+    char line[MAX_LINE_LEN];
+    formatStudentLine(line, sizeof(line), s); // Ends with a newline
+    fprintf(out, "ROW|%s", line);
+}
+
+// Writes record 'idx' of the store as a ROW line.
+static void batchPrintRecord(FILE* out, int idx) {
+    StudentForm s;
+    batchPrintRow(out, storeRecord(idx, &s));
+}
+
+// Indices of the live records with this full name (case-insensitive), or of the one with this student ID
+// if 'name' is "#<id>", collected up front because modifying or deleting a record changes the name index.
+// Returns the count (*out is malloc'd), or -1.
+static int collectStudents(const char* name, int** out) {
+    unsigned int id;
+    int byId = parseStudentId(name, &id), n = 0;
+    for (int i = storeNextByName(name, -1); !byId && i != -1; i = storeNextByName(name, i)) n++;
+    *out = malloc((size_t)(n > 0 ? n : 1) * sizeof(int));
+    if (!*out) return -1;
+    if (byId) {
+        (*out)[0] = storeFindById(id);
+        return (*out)[0] != -1;
+    }
+    n = 0;
+    for (int i = storeNextByName(name, -1); i != -1; i = storeNextByName(name, i)) (*out)[n++] = i;
+    return n;
+}
+
+static int batchRegister(FILE* out, int argc, char** argv) {
+    StudentForm s;
+    if (argc != 1 + STUDENT_TEXT_FIELDS) {
+        fprintf(out, "ERR|register|expected %d fields, got %d\n", STUDENT_TEXT_FIELDS, argc - 1);
+        return 0;
+    }
+    for (int f = 0; f < STUDENT_TEXT_FIELDS; f++) {
+        if (!setStudentField(&s, f, argv[1 + f])) {
+            fprintf(out, "ERR|register|%s %s\n", studentFields[f].label, setFieldProblem(f, argv[1 + f]));
+            return 0;
+        }
+    }
+    const char* error = validateStudent(&s);
+    if (!error) error = duplicateApplicant(&s);
+    if (error) {
+        fprintf(out, "ERR|register|%s\n", error);
+        return 0;
+    }
+    if (storageInsert(&s) == -1) {
+        fprintf(out, "ERR|register|the record could not be saved\n");
+        return 0;
+    }
+    batchPrintRow(out, &s);
+    fprintf(out, "OK|register|1\n");
+    return 1;
+}
+
+// A cursor is a record slot: it stays valid across registrations, modifications and deletions,
+// but not across a compaction of the text data file.
+static int batchDisplay(FILE* out, int argc, char** argv) {
+    if (argc == 1) {
+        for (int i = 0; i < store.count; i++) {
+            if (store.alive[i]) batchPrintRecord(out, i);
+        }
+        fprintf(out, "OK|display|%d\n", store.liveCount);
+        return 1;
+    }
+    int limit = argc == 3 ? atoi(argv[1]) : 0;
+    int slot = argc == 3 ? atoi(argv[2]) : -1;
+    if (limit <= 0 || slot < 0) {
+        fprintf(out, "ERR|display|usage: display|<limit>|<cursor>\n");
+        return 0;
+    }
+    int shown = 0;
+    for (slot = storeNextLive(slot); slot < store.count && shown < limit; slot = storeNextLive(slot + 1)) {
+        batchPrintRecord(out, slot);
+        shown++;
+    }
+    if (slot < store.count) fprintf(out, "OK|display|%d|%d\n", shown, slot);
+    else fprintf(out, "OK|display|%d|end\n", shown);
+    return 1;
+}
+
+static int batchSearch(FILE* out, int argc, char** argv) {
+    int field = argc == 3 ? batchFieldNumber(argv[1]) : -1;
+    if (field < 0) {
+        fprintf(out, "ERR|search|usage: search|<field>|<term>\n");
+        return 0;
+    }
+    int found = 0;
+    if (field == FIELD_MOBILE) { // Exact match, served by the mobile index
+        for (int i = storeNextByMobile(argv[2], -1); i != -1; i = storeNextByMobile(argv[2], i)) {
+            batchPrintRecord(out, i);
+            found++;
+        }
+    } else {
+        char lowerTerm[NAME_LEN];
+        if (strlen(argv[2]) >= sizeof(lowerTerm)) {
+            fprintf(out, "ERR|search|search term is too long\n");
+            return 0;
+        }
+        strcpy(lowerTerm, argv[2]);
+        str_to_lower(lowerTerm);
+        int* matches;
+        found = storeFindContaining(field, lowerTerm, &matches);
+        if (found < 0) {
+            fprintf(out, "ERR|search|not enough memory\n");
+            return 0;
+        }
+        for (int m = 0; m < found; m++) {
+            batchPrintRecord(out, matches[m]);
+        }
+        free(matches);
+    }
+    fprintf(out, "OK|search|%d\n", found);
+    return 1;
+}
+
+static int batchModify(FILE* out, int argc, char** argv) {
+    StudentForm changes;
+    int changed[STUDENT_TEXT_FIELDS] = { 0 };
+    if (argc < 3) {
+        fprintf(out, "ERR|modify|usage: modify|<full name or #id>|<field>=<value>[|...]\n");
+        return 0;
+    }
+    for (int a = 2; a < argc; a++) {
+        char* eq = strchr(argv[a], '=');
+        int field = -1;
+        if (eq) {
+            *eq = 0;
+            field = batchFieldNumber(argv[a]);
+        }
+        if (field < 0) {
+            fprintf(out, "ERR|modify|'%s' is not <field>=<value> with a known field\n", argv[a]);
+            return 0;
+        }
+        if (!setStudentField(&changes, field, eq + 1)) {
+            fprintf(out, "ERR|modify|%s %s\n", studentFields[field].label, setFieldProblem(field, eq + 1));
+            return 0;
+        }
+        changed[field] = 1;
+    }
+
+    int* matches;
+    int n = collectStudents(argv[1], &matches);
+    StudentForm* updated = n >= 0 ? malloc((size_t)(n > 0 ? n : 1) * sizeof(StudentForm)) : NULL;
+    if (!updated) {
+        if (n >= 0) free(matches);
+        fprintf(out, "ERR|modify|not enough memory\n");
+        return 0;
+    }
+    const char* error = NULL;
+    for (int m = 0; m < n && !error; m++) { // Validate every result before saving any of them
+        storeRecord(matches[m], &updated[m]);
+        for (int f = 0; f < STUDENT_TEXT_FIELDS; f++) {
+            if (changed[f]) setStudentField(&updated[m], f, studentFieldText(&changes, f));
+        }
+        error = validateStudent(&updated[m]);
+    }
+    int saved = 0;
+    if (error) {
+        fprintf(out, "ERR|modify|%s\n", error);
+    } else {
+        for (; saved < n; saved++) {
+            if (!storageUpdate(matches[saved], &updated[saved])) break;
+            batchPrintRow(out, &updated[saved]);
+        }
+        if (saved < n) fprintf(out, "ERR|modify|saved %d of %d records\n", saved, n);
+        else fprintf(out, "OK|modify|%d\n", n);
+    }
+    free(matches);
+    free(updated);
+    if (saved > 0) storageMaintain();
+    return !error && saved == n;
+}
+
+static int batchQuery(FILE* out, int argc, char** argv, int explainOnly) {
+    const char* command = explainOnly ? "explain" : "query";
+    Query q;
+    if (argc != 2) {
+        fprintf(out, "ERR|%s|usage: %s|<compound query>\n", command, command);
+        return 0;
+    }
+    const char* error = parseQuery(argv[1], &q);
+    if (error) {
+        fprintf(out, "ERR|%s|%s\n", command, error);
+        return 0;
+    }
+    planQuery(&q);
+    if (explainOnly) {
+        explainQuery(out, "PLAN|", &q);
+        fprintf(out, "OK|explain|%ld\n", q.estimate);
+        return 1;
+    }
+    int* matches;
+    int n = runQuery(&q, &matches);
+    if (n < 0) {
+        fprintf(out, "ERR|query|not enough memory\n");
+        return 0;
+    }
+    for (int m = 0; m < n; m++) {
+        batchPrintRecord(out, matches[m]);
+    }
+    free(matches);
+    fprintf(out, "OK|query|%d\n", n);
+    return 1;
+}
+
+static int batchDelete(FILE* out, int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(out, "ERR|delete|usage: delete|<full name or #id>\n");
+        return 0;
+    }
+    int* matches;
+    int n = collectStudents(argv[1], &matches);
+    if (n < 0) {
+        fprintf(out, "ERR|delete|not enough memory\n");
+        return 0;
+    }
+    int deleted = 0;
+    for (; deleted < n; deleted++) {
+        StudentForm s;
+        storeRecord(matches[deleted], &s);
+        if (!storageDelete(matches[deleted])) break;
+        batchPrintRow(out, &s);
+    }
+    if (deleted < n) fprintf(out, "ERR|delete|deleted %d of %d records\n", deleted, n);
+    else fprintf(out, "OK|delete|%d\n", n);
+    free(matches);
+    if (deleted > 0) storageMaintain();
+    return deleted == n;
+}
+
+// top|<key>|<k>[|reverse]
+static int batchTop(FILE* out, int argc, char** argv) {
+    int reverse = argc == 4 && strcmp(argv[3], "reverse") == 0;
+    int key = argc == 3 + reverse ? sortKeyNumber(argv[1]) : -1;
+    int k = key >= 0 ? atoi(argv[2]) : 0;
+    if (k <= 0) {
+        fprintf(out, "ERR|top|usage: top|<percent, finalfee, dob or name>|<count>[|reverse]\n");
+        return 0;
+    }
+    int* ids = malloc((size_t)(k < store.liveCount ? k : store.liveCount > 0 ? store.liveCount : 1) * sizeof(int));
+    int n = ids ? sortedTop(key, reverse, k, ids) : -1;
+    if (n < 0) {
+        free(ids);
+        fprintf(out, "ERR|top|not enough memory\n");
+        return 0;
+    }
+    for (int i = 0; i < n; i++) batchPrintRecord(out, ids[i]);
+    free(ids);
+    fprintf(out, "OK|top|%d\n", n);
+    return 1;
+}
+
+// sorted|<key>[|reverse][|<limit>|<position>]
+static int batchSorted(FILE* out, int argc, char** argv) {
+    int reverse = argc >= 3 && strcmp(argv[2], "reverse") == 0;
+    int paged = argc == 4 + reverse;
+    int key = argc == 2 + reverse || paged ? sortKeyNumber(argv[1]) : -1;
+    int limit = paged ? atoi(argv[2 + reverse]) : store.liveCount;
+    int first = paged ? atoi(argv[3 + reverse]) : 0;
+    if (key < 0 || (paged && (limit <= 0 || first < 0))) {
+        fprintf(out, "ERR|sorted|usage: sorted|<percent, finalfee, dob or name>[|reverse][|<limit>|<position>]\n");
+        return 0;
+    }
+    if (limit > store.liveCount) limit = store.liveCount;
+    int total = 0;
+    int* ids = malloc((size_t)(limit > 0 ? limit : 1) * sizeof(int));
+    int n = ids ? sortedPage(key, reverse, first, limit, ids, &total) : -1;
+    if (n < 0) {
+        free(ids);
+        fprintf(out, "ERR|sorted|not enough memory\n");
+        return 0;
+    }
+    for (int i = 0; i < n; i++) batchPrintRecord(out, ids[i]);
+    free(ids);
+    if (!paged) fprintf(out, "OK|sorted|%d\n", n);
+    else if (first + n < total) fprintf(out, "OK|sorted|%d|%d\n", n, first + n);
+    else fprintf(out, "OK|sorted|%d|end\n", n);
+    return 1;
+}
+
+static int batchStats(FILE* out, int argc) {
+    if (argc != 1) {
+        fprintf(out, "ERR|stats|takes no arguments\n");
+        return 0;
+    }
+    const Aggregates* agg = currentAggregates(); // Usually read from AGG_FILENAME without loading the roster
+    if (!agg) {
+        fprintf(out, "ERR|stats|the student records could not be loaded\n");
+        return 0;
+    }
+    int groups = 0;
+    for (int d = 0; d < 3; d++) {
+        const AggregateGroup* g = d == 0 ? &agg->all : d == 1 ? agg->courses : agg->domiciles;
+        int count = d == 0 ? 1 : d == 1 ? agg->courseCount : agg->domicileCount;
+        for (int i = 0; i < count; i++) {
+            if (d > 0 && g[i].count == 0) continue;
+            fprintf(out, "AGG|%s|%s|%ld|%lld|%lld|%lld|%lld\n", d == 0 ? "all" : d == 1 ? "course" : "domicile",
+                    d == 0 ? "-" : g[i].name, g[i].count, g[i].totalFee, g[i].discount, g[i].domicileDiscount, g[i].finalFee);
+            groups++;
+        }
+    }
+    fprintf(out, "OK|stats|%d\n", groups);
+    return 1;
+}
+
+// ages[|<years per bucket>[|<date>]]
+static int batchAges(FILE* out, int argc, char** argv) {
+    int width = argc >= 2 && argv[1][0] ? atoi(argv[1]) : AGE_BUCKET_YEARS;
+    unsigned int on = argc == 3 ? dobDate(argv[2]) : todayDate();
+    if (argc > 3 || width <= 0 || width > AGE_MAX_YEARS || on == 0) {
+        fprintf(out, "ERR|ages|usage: ages[|<years per bucket>[|<date, DD/MM/YYYY>]]\n");
+        return 0;
+    }
+    long counts[AGE_MAX_YEARS];
+    int n = storeAgeHistogram(on, width, counts, (AGE_MAX_YEARS + width - 1) / width);
+    if (n < 0) {
+        fprintf(out, "ERR|ages|not enough memory\n");
+        return 0;
+    }
+    int first = 0, lines = 0;
+    long placed = 0;
+    while (first < n && counts[first] == 0) first++; // Start at the youngest student's bucket
+    for (int b = first; b < n; b++, lines++) {
+        fprintf(out, "AGE|%d|%d|%ld\n", b * width, (b + 1) * width - 1, counts[b]);
+        placed += counts[b];
+    }
+    if (placed < store.liveCount) {
+        fprintf(out, "AGE|-|-|%ld\n", store.liveCount - placed);
+        lines++;
+    }
+    fprintf(out, "OK|ages|%d\n", lines);
+    return 1;
+}
+
+static int batchSuggest(FILE* out, int argc, char** argv) {
+    int max = argc == 3 ? atoi(argv[2]) : FUZZY_CANDIDATES;
+    if (argc < 2 || argc > 3 || max <= 0) {
+        fprintf(out, "ERR|suggest|usage: suggest|<name>[|<count>]\n");
+        return 0;
+    }
+    NameMatch* matches = malloc((size_t)max * sizeof(NameMatch));
+    int n = matches ? storeSimilarNames(argv[1], matches, max) : -1;
+    if (n < 0) {
+        free(matches);
+        fprintf(out, "ERR|suggest|not enough memory\n");
+        return 0;
+    }
+    for (int m = 0; m < n; m++) {
+        fprintf(out, "NAME|%s|%d|%d\n", matches[m].name, matches[m].distance, matches[m].students);
+    }
+    free(matches);
+    fprintf(out, "OK|suggest|%d\n", n);
+    return 1;
+}
+
+static int batchExport(FILE* out, int argc, char** argv) {
+    int format = argc >= 3 ? exportFormatNumber(argv[1]) : -1;
+    int byQuery = argc == 5 && strcmp(argv[3], "query") == 0;
+    int field = argc == 5 && !byQuery ? batchFieldNumber(argv[3]) : -1;
+    if (format < 0 || (argc != 3 && !byQuery && field < 0) || argc > 5) {
+        fprintf(out, "ERR|export|usage: export|<csv or json>|<file or ->[|<field>|<term>] or [|query|<compound query>]\n");
+        return 0;
+    }
+    int* matches = NULL;
+    int n = 0;
+    if (byQuery) {
+        Query q;
+        const char* error = parseQuery(argv[4], &q);
+        if (error) {
+            fprintf(out, "ERR|export|%s\n", error);
+            return 0;
         }
-    } while (1);
-    input_field_row += 2;
+        planQuery(&q);
+        n = runQuery(&q, &matches);
+    } else if (field >= 0) {
+        if (strlen(argv[4]) >= NAME_LEN) {
+            fprintf(out, "ERR|export|search term is too long\n");
+            return 0;
+        }
+        n = exportSearch(field, argv[4], &matches);
+    }
+    if (n < 0) {
+        fprintf(out, "ERR|export|not enough memory\n");
+        return 0;
+    }
+    long rows = strcmp(argv[2], "-") == 0 ? exportStudents(out, format, matches, n)
+                                          : exportStudentsToFile(argv[2], format, matches, n);
+    free(matches);
+    if (rows < 0) {
+        fprintf(out, "ERR|export|the export could not be written\n");
+        return 0;
+    }
+    fprintf(out, "OK|export|%ld\n", rows);
+    return 1;
+}
 
-    // Date of Birth (DOB)
-    gotoxy(input_field_row, input_col); fgets(s.dob, sizeof(s.dob), stdin); s.dob[strcspn(s.dob, "\n")] = 0;
+static int batchMetrics(FILE* out, int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "save") != 0 && strcmp(argv[1], "reset") != 0)) {
+        fprintf(out, "ERR|metrics|expected metrics, metrics|save or metrics|reset\n");
+        return 0;
+    }
+    if (!metricsOn) {
+        fprintf(out, "ERR|metrics|metrics are disabled (set %s=1)\n", METRICS_ENV);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "save") == 0 && !saveMetrics()) {
+        fprintf(out, "ERR|metrics|could not write '%s'\n", METRICS_FILENAME);
+        return 0;
+    }
+    int lines = metricsWrite(out);
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) metricsReset();
+    fprintf(out, "OK|metrics|%d\n", lines);
+    return 1;
+}
 
-    // --- Calculate Fees ---
-    s.discount = s.totalFee * (getPercentDiscount(perc_val) / 100.0f);
-    s.domicileDiscount = (s.totalFee - s.discount) * (getDomicileDiscount(s.domicile) / 100.0f);
-    s.finalFee = s.totalFee - s.discount - s.domicileDiscount;
+// Runs a batch command that needs the loaded store.
+static int runStoreCommand(FILE* out, int argc, char** argv) {
+    if (strcmp(argv[0], "register") == 0) return batchRegister(out, argc, argv);
+    if (strcmp(argv[0], "display") == 0) return batchDisplay(out, argc, argv);
+    if (strcmp(argv[0], "search") == 0) return batchSearch(out, argc, argv);
+    if (strcmp(argv[0], "modify") == 0) return batchModify(out, argc, argv);
+    if (strcmp(argv[0], "delete") == 0) return batchDelete(out, argc, argv);
+    if (strcmp(argv[0], "query") == 0) return batchQuery(out, argc, argv, 0);
+    if (strcmp(argv[0], "explain") == 0) return batchQuery(out, argc, argv, 1);
+    if (strcmp(argv[0], "top") == 0) return batchTop(out, argc, argv);
+    if (strcmp(argv[0], "sorted") == 0) return batchSorted(out, argc, argv);
+    if (strcmp(argv[0], "export") == 0) return batchExport(out, argc, argv);
+    if (strcmp(argv[0], "suggest") == 0) return batchSuggest(out, argc, argv);
+    if (strcmp(argv[0], "ages") == 0) return batchAges(out, argc, argv);
+    fprintf(out, "ERR|%s|unknown command\n", argv[0]);
+    return 0;
+}
 
-    // --- Display Fee Details (Optional) ---
-    char ch;
-    gotoxy(error_message_row + 1, label_col); printf("Do you want to view fee details? (y/n): ");
-    ch = getchar();
-    clearInputBuffer(); // Consume newline after getchar
+// Runs one batch command; argv[0] is its name. Returns 1 on success, 0 on failure (an ERR line was written).
+// The command is timed by the metrics; loading the store first is timed as a load of its own.
+int runBatchCommand(FILE* out, int argc, char** argv) {
+    if (strcmp(argv[0], "metrics") == 0) return batchMetrics(out, argc, argv);
+    int ok;
+    if (strcmp(argv[0], "stats") == 0) {
+        MetricsSpan span = metricsBegin(OP_STATS);
+        ok = batchStats(out, argc);
+        metricsEnd(span);
+        return ok;
+    }
+    if (!loadStudentStore()) {
+        fprintf(out, "ERR|%s|the student records could not be loaded\n", argv[0]);
+        return 0;
+    }
+    MetricsSpan span = metricsBegin(metricsCommandOp(argv[0]));
+    ok = runStoreCommand(out, argc, argv);
+    metricsEnd(span);
+    return ok;
+}
 
-    if (tolower((unsigned char)ch) == 'y') {
-        clearScreen();
-        printf("========================\n");
-        printf("      FEE DETAILS\n");
-        printf("========================\n\n");
-        printf("+--------------------------+------------------------+\n");
-        printf("| %-24s | %-20.2f Rs  |\n", "Total Course Fee", s.totalFee);
-        printf("+--------------------------+------------------------+\n");
-        printf("| %-24s | %-20.2f Rs  |\n", "12th Percent. Discount", s.discount);
-        printf("+--------------------------+------------------------+\n");
-        printf("| %-24s | %-20.2f Rs  |\n", "Domicile Discount", s.domicileDiscount);
-        printf("+--------------------------+------------------------+\n");
-        printf("| %-24s | %-20.2f Rs  |\n", "Final Fee (Full Course)", s.finalFee);
-        printf("+--------------------------+------------------------+\n");
-        printf("| %-24s | %-20.2f Rs  |\n", "Fee per Year (Approx)", s.finalFee / 4.0f); // Assuming 4-year course
-        printf("+--------------------------+------------------------+\n\n");
-         
+// Splits one script line (without its newline) into a command and its arguments and runs it with 'run'.
+// Returns 1 if it succeeded, 0 if it failed and -1 for a blank or comment line.
+static int runBatchLine(FILE* out, char* line, int (*run)(FILE* out, int argc, char** argv)) {
+    char* args[BATCH_MAX_ARGS];
+    if (line[0] == '#' || line[strspn(line, " \t")] == 0) return -1;
+    int argc = 0;
+    char* p = line;
+    while (argc < BATCH_MAX_ARGS) {
+        args[argc++] = p;
+        p = strchr(p, '|');
+        if (!p) break;
+        *p++ = 0;
     }
+    if (p) {
+        fprintf(out, "ERR|%s|more than %d fields\n", args[0], BATCH_MAX_ARGS);
+        return 0;
+    }
+    return run(out, argc, args);
+}
 
-    // --- Save Student Record to File ---
-    fprintf(fp, "%s|%s|%s|%s|%s|%s|%s|%s|%.2f|%.2f|%.2f|%.2f\n",
-            s.name, s.mother, s.father, s.mobile, s.percent, s.domicile, s.course, s.dob,
-            s.totalFee, s.discount, s.domicileDiscount, s.finalFee);
+static FILE* batchHeld;          // Answers to writes not yet on disk (a memory stream)
+static char* batchHeldText;
+static size_t batchHeldSize;
 
-    fclose(fp); // Close the file
-    gotoxy(error_message_row + 3, label_col); printf("Student registered successfully!\n");
-     
+// Makes the changes answered so far durable, then writes their held answers to stdout.
+// Returns 0 if the changes could not be synced (an ERR line follows the answers).
+static int batchRelease() {
+    if (!batchHeld) return journalSync();
+    int synced = journalSync();
+    if (!synced) fprintf(batchHeld, "ERR|sync|changes could not be saved\n");
+    fflush(batchHeld);
+    fwrite(batchHeldText, 1, batchHeldSize, stdout);
+    fseek(batchHeld, 0, SEEK_SET);
+    return synced;
 }
 
-// Displays all student records from the file.
-void displayStudents() {
-    FILE *fp = fopen(FILENAME, "r"); // Open file in read mode
-    if (!fp) {
-        printf("No student records found. The file '%s' may not exist or is empty.\n", FILENAME);
-         
-        return;
-    }
+// Releases the held answers and frees the stream. Returns 0 if the changes could not be synced.
+static int batchReleaseAll() {
+    int synced = batchRelease();
+    if (batchHeld) fclose(batchHeld);
+    free(batchHeldText);
+    batchHeld = NULL;
+    batchHeldText = NULL;
+    batchHeldSize = 0;
+    return synced;
+}
 
-    clearScreen();
-    printf("====================================================================================================================================\n");
-    printf("| %-20s | %-15s | %-15s | %-12s | %-10s | %-15s | %-10s | %-15s |\n", "Name", "Mother's Name", "Father's Name", "Mobile", "12th %", "Domicile", "Course", "Final Fee");
-    printf("====================================================================================================================================\n");
+// runBatchLine callback: runs a command with its answers going to stdout, those of a write once it is
+// on disk. Returns 0 if the command failed or earlier changes could not be synced.
+static int runBatchHeld(FILE* out, int argc, char** argv) {
+    (void)out;
+    if (!batchCommandWrites(argv[0])) {
+        int synced = batchRelease();
+        return runBatchCommand(stdout, argc, argv) && synced;
+    }
+    if (!batchHeld && !(batchHeld = open_memstream(&batchHeldText, &batchHeldSize))) {
+        printf("ERR|%s|not enough memory\n", argv[0]);
+        return 0;
+    }
+    int ok = runBatchCommand(batchHeld, argc, argv);
+    if (ftell(batchHeld) >= BATCH_OUTPUT_BUFFER && !batchRelease()) ok = 0; // One group at most per buffer
+    return ok;
+}
 
-    StudentForm s;
-    char line[MAX_LINE_LEN];
-    int recordsFound = 0;
+// Runs one command given on the command line (--run), writing its answers to stdout.
+// Returns 1 on success, 0 on failure.
+int runCommand(int argc, char** argv) {
+    int ok = runBatchHeld(stdout, argc, argv);
+    ok = batchReleaseAll() && ok;
+    fflush(stdout);
+    return ok;
+}
 
-    while (fgets(line, sizeof(line), fp) != NULL) { // Read file line by line
-        line[strcspn(line, "\n")] = 0; // Remove trailing newline for parsing
-        if (parseStudentLine(line, &s)) { // Parse the line into StudentForm struct
-            printf("| %-20s | %-15s | %-15s | %-12s | %-10s | %-15s | %-10s | Rs %-12.2f |\n",
-                   s.name, s.mother, s.father, s.mobile, s.percent, s.domicile, s.course, s.finalFee);
-            recordsFound = 1;
-        }
+// Runs every command of a script file ("-" for stdin), writing the answers to stdout.
+// Returns the number of commands that failed, or -1 if the script could not be opened.
+long runBatch(const char* path) {
+    FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Could not open batch file '%s'.\n", path);
+        perror("Reason");
+        return -1;
     }
+    setvbuf(stdout, NULL, _IOFBF, BATCH_OUTPUT_BUFFER); // Answers are flushed in large blocks, not per line
 
-    if (!recordsFound) {
-        // Adjust colspan for the "No records" message to fit the table width
-        printf("| %-126s |\n", "No student records to display.");
+    char line[MAX_LINE_LEN];
+    long commands = 0, failed = 0;
+    double start = nowSeconds();
+    while (fgets(line, sizeof(line), in) != NULL) {
+        size_t len = strcspn(line, "\r\n");
+        if (line[len] == 0 && !feof(in)) { // No newline: the line did not fit
+            fprintf(batchHeld ? batchHeld : stdout, "ERR|%.16s|line is longer than %d characters\n", line, MAX_LINE_LEN - 2);
+            int c;
+            while ((c = fgetc(in)) != '\n' && c != EOF);
+            commands++;
+            failed++;
+            continue;
+        }
+        line[len] = 0;
+        int result = runBatchLine(batchHeld ? batchHeld : stdout, line, runBatchHeld); // Errors in order with held answers
+        if (result >= 0) commands++;
+        if (result == 0) failed++;
     }
+    if (in != stdin) fclose(in);
+    if (!batchReleaseAll()) failed++;
+    fflush(stdout);
 
-    printf("====================================================================================================================================\n");
-    fclose(fp); // Close the file
-     
+    double seconds = nowSeconds() - start;
+    fprintf(stderr, "batch: %ld commands, %ld failed, %.3f seconds (%.0f commands/sec)\n",
+            commands, failed, seconds, seconds > 0 ? commands / seconds : 0.0);
+    return failed;
 }
 
+// ---------------------------------------------------------------------------------------------
+// Server mode
+// ---------------------------------------------------------------------------------------------
+// One process owns the roster and serves any number of admin clients over a Unix domain socket,
+// instead of every admin running a process of their own against the same files:
+//   01ProjectAlok --serve [socket]    serves the roster on 'socket' (SERVER_SOCKET by default) until SIGINT/SIGTERM
+//   01ProjectAlok --client [socket]   sends the batch commands on stdin and prints the answers
+// A connection speaks the batch protocol (see Batch mode). Commands that only read the roster run in
+// parallel under a shared lock; register, modify and delete hold it exclusively, one at a time, so
+// concurrent writes are applied in turn and none is lost. Answers to a write are sent once it is on disk.
 
-// Searches for student records based on various criteria.
-void searchStudent() {
-    clearScreen();
-    printf("========================\n");
-    printf("  SEARCH STUDENT RECORD\n");
-    printf("========================\n\n");
+static pthread_rwlock_t storeLock = PTHREAD_RWLOCK_INITIALIZER; // Shared: reading commands, exclusive: writes
+static pthread_mutex_t storeLockGate = PTHREAD_MUTEX_INITIALIZER; // Held by a writer waiting for storeLock
+static volatile sig_atomic_t serverStopping;
 
-    FILE *fp = fopen(FILENAME, "r");
-    if (!fp) {
-        printf("No student records found to search. File '%s' is missing or empty.\n", FILENAME);
-         
-        return;
+// Takes the store lock. A waiting writer holds the gate, so new readers queue behind it instead of
+// keeping the lock shared forever.
+static void lockStore(int exclusive) {
+    pthread_mutex_lock(&storeLockGate);
+    if (exclusive) pthread_rwlock_wrlock(&storeLock);
+    else pthread_rwlock_rdlock(&storeLock);
+    pthread_mutex_unlock(&storeLockGate);
+}
+
+// One client connection.
+typedef struct {
+    int fd;
+    FILE* out;                  // Answers (on fd)
+    char in[BATCH_OUTPUT_BUFFER]; // Commands received but not yet run
+    size_t start, end;
+    int unsynced;               // A write was answered that journalSync has not yet made durable
+} ServerClient;
+
+// Runs one command of a client under the store lock.
+static int serverCommand(ServerClient* client, int argc, char** argv) {
+    int writes = batchCommandWrites(argv[0]);
+    lockStore(writes);
+    if (!writes && !store.loaded) { // Only a writer may (re)load the store
+        pthread_rwlock_unlock(&storeLock);
+        lockStore(1);
     }
+    int ok = runBatchCommand(client->out, argc, argv);
+    pthread_rwlock_unlock(&storeLock);
+    client->unsynced |= writes;
+    return ok;
+}
 
-    int choice;
-    char searchTerm[NAME_LEN]; // Buffer for the search term
+static __thread ServerClient* currentClient; // The connection served by this thread
 
-    printf("Search By:\n");
-    printf("1. Name\n");
-    printf("2. Course\n");
-    printf("3. Mother's Name\n");
-    printf("4. Father's Name\n");
-    printf("5. Mobile Number\n");
-    printf("6. Domicile\n");
-    printf("Enter your choice (1-6): ");
+// runBatchLine callback: runs a command for the connection of the calling thread.
+static int runServerCommand(FILE* out, int argc, char** argv) {
+    (void)out;
+    return serverCommand(currentClient, argc, argv);
+}
 
-    if (scanf("%d", &choice) != 1) {
-        printf("Invalid input. Please enter a number.\n");
-        clearInputBuffer();
-        fclose(fp);
-         
-        return;
+// Reads the next command line of a client (without the newline) into 'line'. Before waiting for more
+// input, the answers so far are made durable and sent, so a client streaming commands gets its writes
+// synced in groups. Returns 0 at the end of the input, -1 for a line longer than 'size' (skipped).
+static int serverReadLine(ServerClient* client, char* line, size_t size) {
+    size_t len = 0;
+    int tooLong = 0;
+    while (1) {
+        if (client->start == client->end) {
+            if (client->unsynced && !journalSync()) fprintf(client->out, "ERR|sync|changes could not be saved\n");
+            client->unsynced = 0;
+            fflush(client->out);
+            ssize_t got = read(client->fd, client->in, sizeof(client->in));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                if (len == 0) return 0;
+                break; // Last line without a newline
+            }
+            client->start = 0;
+            client->end = (size_t)got;
+        }
+        char c = client->in[client->start++];
+        if (c == '\n') break;
+        if (len + 1 < size) line[len++] = c;
+        else tooLong = 1;
     }
-    clearInputBuffer(); // Clear newline
+    if (len > 0 && line[len - 1] == '\r') len--;
+    line[len] = 0;
+    return tooLong ? -1 : 1;
+}
 
-    if (choice < 1 || choice > 6) {
-        printf("Invalid search option.\n");
-        fclose(fp);
-         
-        return;
+// Thread serving one connection until the client closes it.
+static void* serverClientMain(void* arg) {
+    ServerClient* client = arg;
+    currentClient = client;
+    char line[MAX_LINE_LEN];
+    int result;
+    while ((result = serverReadLine(client, line, sizeof(line))) != 0) {
+        if (result < 0) fprintf(client->out, "ERR|%.16s|line is longer than %d characters\n", line, MAX_LINE_LEN - 2);
+        else runBatchLine(client->out, line, runServerCommand);
     }
+    fclose(client->out); // Also closes the socket
+    free(client);
+    return NULL;
+}
 
-    printf("Enter search term: ");
-    fgets(searchTerm, sizeof(searchTerm), stdin);
-    searchTerm[strcspn(searchTerm, "\n")] = 0; // Remove trailing newline
+// SIGINT/SIGTERM handler of the server: stops accepting connections.
+static void stopServer(int sig) {
+    (void)sig;
+    serverStopping = 1;
+}
 
-    // For case-insensitive string searches, convert search term to lowercase
-    char lowerSearchTerm[NAME_LEN];
-    if (choice != 5) { // Mobile number search is exact match, not case-sensitive
-        strncpy(lowerSearchTerm, searchTerm, sizeof(lowerSearchTerm) - 1);
-        lowerSearchTerm[sizeof(lowerSearchTerm) - 1] = '\0';
-        str_to_lower(lowerSearchTerm);
+// Fills a socket address for 'path'. Returns 0 if the path is too long.
+static int serverAddress(const char* path, struct sockaddr_un* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        printf("Error: Socket path '%s' is too long.\n", path);
+        return 0;
     }
+    strcpy(addr->sun_path, path);
+    return 1;
+}
 
+// Serves the roster on the socket 'path' until SIGINT or SIGTERM. Returns 0 if the server could not start.
+int serveStudents(const char* path) {
+    struct sockaddr_un addr;
+    if (!serverAddress(path, &addr) || !loadStudentStore()) return 0;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("Error: Could not create the server socket.\n");
+        perror("Reason");
+        return 0;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        printf("Error: A server is already running on '%s'.\n", path);
+        close(fd);
+        return 0;
+    }
+    unlink(path); // Left behind by a server that did not shut down cleanly
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        printf("Error: Could not listen on '%s'.\n", path);
+        perror("Reason");
+        close(fd);
+        return 0;
+    }
 
-    clearScreen();
-    printf("SEARCH RESULTS FOR: '%s'\n", searchTerm);
-    printf("====================================================================================================================================\n");
-    printf("| %-20s | %-15s | %-15s | %-12s | %-10s | %-15s | %-10s | %-15s |\n", "Name", "Mother's Name", "Father's Name", "Mobile", "12th %", "Domicile", "Course", "Final Fee");
-    printf("====================================================================================================================================\n");
+    struct sigaction stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = stopServer; // No SA_RESTART: accept() returns with EINTR
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+    signal(SIGPIPE, SIG_IGN); // A client that disconnects early only ends its own connection
+    printf("Serving %d records on '%s'. Stop with Ctrl+C.\n", store.liveCount, path);
+    fflush(stdout);
 
-    int found = 0;
-    StudentForm s;
-    char line[MAX_LINE_LEN];
-    char compareStrLower[NAME_LEN]; // Buffer for lowercase version of student data field
-
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        line[strcspn(line, "\n")] = 0; // Remove newline for parsing
-
-        if (parseStudentLine(line, &s)) {
-            int match = 0; // Flag to indicate if current record matches search criteria
-
-            switch (choice) {
-                case 1: // Search by Name
-                    strncpy(compareStrLower, s.name, sizeof(compareStrLower) - 1); compareStrLower[sizeof(compareStrLower)-1] = '\0'; str_to_lower(compareStrLower);
-                    if (strstr(compareStrLower, lowerSearchTerm) != NULL) match = 1; // Use strstr for partial match
-                    break;
-                case 2: // Search by Course
-                    strncpy(compareStrLower, s.course, sizeof(compareStrLower) - 1); compareStrLower[sizeof(compareStrLower)-1] = '\0'; str_to_lower(compareStrLower);
-                    if (strstr(compareStrLower, lowerSearchTerm) != NULL) match = 1;
-                    break;
-                case 3: // Search by Mother's Name
-                    strncpy(compareStrLower, s.mother, sizeof(compareStrLower) - 1); compareStrLower[sizeof(compareStrLower)-1] = '\0'; str_to_lower(compareStrLower);
-                    if (strstr(compareStrLower, lowerSearchTerm) != NULL) match = 1;
-                    break;
-                case 4: // Search by Father's Name
-                    strncpy(compareStrLower, s.father, sizeof(compareStrLower) - 1); compareStrLower[sizeof(compareStrLower)-1] = '\0'; str_to_lower(compareStrLower);
-                    if (strstr(compareStrLower, lowerSearchTerm) != NULL) match = 1;
-                    break;
-                case 5: // Search by Mobile Number (exact match)
-                    if (strcmp(searchTerm, s.mobile) == 0) match = 1;
-                    break;
-                case 6: // Search by Domicile
-                    strncpy(compareStrLower, s.domicile, sizeof(compareStrLower) - 1); compareStrLower[sizeof(compareStrLower)-1] = '\0'; str_to_lower(compareStrLower);
-                    if (strstr(compareStrLower, lowerSearchTerm) != NULL) match = 1;
-                    break;
-            }
+    while (!serverStopping) {
+        int clientFd = accept(fd, NULL, NULL);
+        if (clientFd < 0) {
+            if (errno != EINTR) perror("accept");
+            continue;
+        }
+        ServerClient* client = malloc(sizeof(ServerClient));
+        FILE* out = client ? fdopen(clientFd, "w") : NULL;
+        pthread_t thread;
+        if (!out) {
+            free(client);
+            close(clientFd);
+            continue;
+        }
+        setvbuf(out, NULL, _IOFBF, BATCH_OUTPUT_BUFFER);
+        client->fd = clientFd;
+        client->out = out;
+        client->start = client->end = 0;
+        client->unsynced = 0;
+        if (pthread_create(&thread, NULL, serverClientMain, client) != 0) {
+            fclose(out);
+            free(client);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    close(fd);
+    unlink(path);
+    lockStore(1); // Waits for the commands in progress; the store is saved at exit (closeStudentStore)
+    printf("Server stopped.\n");
+    return 1;
+}
+
+// Context of the thread that sends the client's commands to the server.
+typedef struct {
+    int fd;
+    FILE* in;
+} ClientSender;
 
-            if (match) {
-                 printf("| %-20s | %-15s | %-15s | %-12s | %-10s | %-15s | %-10s | Rs %-12.2f |\n",
-                   s.name, s.mother, s.father, s.mobile, s.percent, s.domicile, s.course, s.finalFee);
-                found = 1;
+// Copies the commands to the socket, then closes its sending side so the server sees the end of input.
+static void* clientSendMain(void* arg) {
+    ClientSender* sender = arg;
+    char buf[BATCH_OUTPUT_BUFFER];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), sender->in)) > 0) {
+        size_t sent = 0;
+        while (sent < got) {
+            ssize_t n = write(sender->fd, buf + sent, got - sent);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                shutdown(sender->fd, SHUT_WR);
+                return NULL;
             }
+            sent += (size_t)n;
         }
     }
+    shutdown(sender->fd, SHUT_WR);
+    return NULL;
+}
 
-    if (!found) {
-        printf("| %-126s |\n", "No matching record found.");
+// Sends the commands on stdin to the server on 'path' and prints its answers.
+// Returns the number of commands that failed (ERR answers), or -1 if the server could not be reached.
+long runClient(const char* path) {
+    struct sockaddr_un addr;
+    if (!serverAddress(path, &addr)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Error: Could not connect to the server on '%s'.\n", path);
+        perror("Reason");
+        if (fd >= 0) close(fd);
+        return -1;
     }
-
-    printf("====================================================================================================================================\n");
-    fclose(fp);
-     
+    // Commands are sent while answers are read: with both in one thread, a long script could fill the
+    // socket buffers in both directions and wait forever
+    ClientSender sender = { fd, stdin };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, clientSendMain, &sender) != 0) {
+        fprintf(stderr, "Error: Could not start the client.\n");
+        close(fd);
+        return -1;
+    }
+    FILE* answers = fdopen(fd, "r");
+    setvbuf(stdout, NULL, _IOFBF, BATCH_OUTPUT_BUFFER);
+    char line[MAX_LINE_LEN + 32];
+    long failed = 0;
+    int lineStart = 1;
+    while (answers && fgets(line, sizeof(line), answers) != NULL) {
+        if (lineStart && strncmp(line, "ERR|", 4) == 0) failed++;
+        lineStart = strchr(line, '\n') != NULL;
+        fputs(line, stdout);
+    }
+    fflush(stdout);
+    pthread_join(thread, NULL);
+    if (answers) fclose(answers);
+    else close(fd);
+    return failed;
 }
 
-// Modifies an existing student record.
-// Searches by student name (case-insensitive).
-// Reads all records, writes non-matching and modified records to a temporary file,
-// then replaces the original file with the temporary file.
-void modifyStudent() {
-    clearScreen();
-    printf("========================\n");
-    printf(" MODIFY STUDENT RECORD\n");
-    printf("========================\n\n");
+// ---------------------------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------------------------
 
-    FILE *fp_read = fopen(FILENAME, "r");
-    if (!fp_read) {
-        printf("No student records found to modify. File '%s' is missing or empty.\n", FILENAME);
-         
+// Micro-benchmark: parses 'rows' synthetic student lines with the sscanf parser and with
+// parseStudentFields, checks that both agree, and prints rows/sec for each.
+void benchParse(long rows) {
+    static const char* courses[] = { "BTech", "BCA", "BSc" };
+    static const char* domiciles[] = { "Uttarakhand", "Delhi", "Uttar Pradesh", "Haryana", "Punjab" };
+    enum { DISTINCT_LINES = 4096 }; // Cycled through so the input stays in cache, like a hot file buffer
+    if (rows <= 0) rows = BENCH_PARSE_DEFAULT_ROWS;
+
+    char (*lines)[MAX_LINE_LEN] = malloc(DISTINCT_LINES * sizeof(*lines));
+    size_t* lengths = malloc(DISTINCT_LINES * sizeof(size_t));
+    if (!lines || !lengths) {
+        printf("Error: Not enough memory for the benchmark.\n");
+        free(lines);
+        free(lengths);
         return;
     }
+    unsigned int seed = 12345u;
+    for (int i = 0; i < DISTINCT_LINES; i++) {
+        StudentForm s;
+        seed = seed * 1103515245u + 12345u;
+        snprintf(s.name, sizeof(s.name), "Student Number %d", i);
+        snprintf(s.mother, sizeof(s.mother), "Mother Of %d", i);
+        snprintf(s.father, sizeof(s.father), "Father Of %d", i);
+        snprintf(s.mobile, sizeof(s.mobile), "9%09u", seed % 1000000000u);
+        snprintf(s.percent, sizeof(s.percent), "%u.%u", 40 + seed % 60, seed % 10);
+        setStudentField(&s, FIELD_DOMICILE, domiciles[(seed >> 8) % 5]);
+        setStudentField(&s, FIELD_COURSE, courses[(seed >> 16) % 3]);
+        snprintf(s.dob, sizeof(s.dob), "%02u/%02u/%u", 1 + seed % 28, 1 + (seed >> 4) % 12, 2000 + (seed >> 12) % 8);
+        computeFees(&s, strtof(s.percent, NULL));
+        s.id = (unsigned int)i + 1;
+        lengths[i] = (size_t)formatStudentLine(lines[i], MAX_LINE_LEN, &s) - 1;
+        lines[i][lengths[i]] = 0; // Drop the newline, as the loaders do
+    }
 
-    FILE *fp_write = fopen(TEMP_FILENAME, "w"); // Open temporary file for writing
-    if (!fp_write) {
-        printf("Error: Could not create temporary file ('%s') for modification.\n", TEMP_FILENAME);
-        perror("Reason");
-        fclose(fp_read);
-         
-        return;
+    StudentForm a, b;
+    long mismatches = 0;
+    for (int i = 0; i < DISTINCT_LINES; i++) {
+        int okA = parseStudentLineScanf(lines[i], &a);
+        int okB = parseStudentFields(lines[i], lengths[i], &b) == 0;
+        int same = okA == okB && a.totalFee == b.totalFee && a.discount == b.discount &&
+                   a.domicileDiscount == b.domicileDiscount && a.finalFee == b.finalFee;
+        for (int f = 0; same && f < STUDENT_TEXT_FIELDS; f++) {
+            same = strcmp(studentFieldText(&a, f), studentFieldText(&b, f)) == 0;
+        }
+        mismatches += !same;
     }
 
-    char searchName[NAME_LEN];
-    printf("Enter the FULL NAME of the student to modify: ");
-    fgets(searchName, sizeof(searchName), stdin);
-    searchName[strcspn(searchName, "\n")] = 0; // Remove newline
+    volatile float sink = 0.0f; // Keeps the compiler from discarding the parse results
+    double start = nowSeconds();
+    for (long r = 0; r < rows; r++) {
+        parseStudentLineScanf(lines[r % DISTINCT_LINES], &a);
+        sink += a.finalFee;
+    }
+    double scanfSeconds = nowSeconds() - start;
 
-    // Convert search name to lowercase for case-insensitive comparison
-    char lowerSearchName[NAME_LEN];
-    strncpy(lowerSearchName, searchName, sizeof(lowerSearchName) - 1);
-    lowerSearchName[sizeof(lowerSearchName) - 1] = '\0';
-    str_to_lower(lowerSearchName);
+    start = nowSeconds();
+    for (long r = 0; r < rows; r++) {
+        parseStudentFields(lines[r % DISTINCT_LINES], lengths[r % DISTINCT_LINES], &b);
+        sink += b.finalFee;
+    }
+    double fastSeconds = nowSeconds() - start;
+    (void)sink;
 
-    int found = 0;
-    StudentForm s; // To hold current student data
-    StudentForm original_s; // To hold original data of the student being modified for display
-    char line[MAX_LINE_LEN];
+    printf("parser      rows        seconds     rows/sec\n");
+    printf("sscanf      %-11ld %-11.3f %.0f\n", rows, scanfSeconds, rows / scanfSeconds);
+    printf("tokenizer   %-11ld %-11.3f %.0f\n", rows, fastSeconds, rows / fastSeconds);
+    printf("speedup     %.2fx\n", scanfSeconds / fastSeconds);
+    printf("mismatches  %ld of %d distinct lines\n", mismatches, DISTINCT_LINES);
 
-    printf("\nProcessing records...\n");
+    free(lines);
+    free(lengths);
+}
 
-    while (fgets(line, sizeof(line), fp_read) != NULL) {
-        // It's important to work with a copy of 'line' for parsing if 'line' itself is needed later (e.g. for writing unparsed lines)
-        // However, here we parse, and if it's the target, we modify 's', then write 's'. If not target, write original 'line'.
-        char original_line_for_writing[MAX_LINE_LEN]; // Keep the original line with its newline for writing if not modified
-        strcpy(original_line_for_writing, line);
-
-
-        char parse_line[MAX_LINE_LEN]; // Copy of line for parsing (to strip newline safely)
-        strcpy(parse_line, line);
-        parse_line[strcspn(parse_line, "\n")] = 0; // Remove newline for parseStudentLine
-
-
-        if (parseStudentLine(parse_line, &s)) {
-            char lowerStudentName[NAME_LEN];
-            strncpy(lowerStudentName, s.name, sizeof(lowerStudentName) - 1);
-            lowerStudentName[sizeof(lowerStudentName) - 1] = '\0';
-            str_to_lower(lowerStudentName);
-
-            if (strcmp(lowerSearchName, lowerStudentName) == 0) { // Found the student to modify
-                found = 1;
-                original_s = s; // Store original data for display prompts
-
-                printf("\n--- Student Found: %s ---\n", original_s.name);
-                printf("Enter new details (leave blank and press Enter to keep current value):\n\n");
-
-                char buffer[NAME_LEN]; // Temporary buffer for inputs
-
-                // Helper macro for conditional update
-                #define GET_MODIFIED_INPUT(prompt, current_value, target_field, max_len) \
-                    printf(prompt, current_value); \
-                    fgets(buffer, max_len, stdin); \
-                    buffer[strcspn(buffer, "\n")] = 0; \
-                    if (strlen(buffer) > 0) strcpy(target_field, buffer);
-
-                GET_MODIFIED_INPUT("New Name (current: %s): ", original_s.name, s.name, sizeof(s.name));
-                GET_MODIFIED_INPUT("New Mother's Name (current: %s): ", original_s.mother, s.mother, sizeof(s.mother));
-                GET_MODIFIED_INPUT("New Father's Name (current: %s): ", original_s.father, s.father, sizeof(s.father));
-
-                // Mobile Number (with validation)
-                do {
-                    printf("New Mobile Number (10-digits, current: %s): ", original_s.mobile);
-                    fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
-                    if (strlen(buffer) == 0) { break; } // Keep current if blank
-                    if (isValidMobile(buffer)) { strcpy(s.mobile, buffer); break; }
-                    printf("Invalid mobile number. Please enter 10 digits only, or leave blank to keep current.\n");
-                } while (1);
-
-                // 12th Percentage (with validation)
-                float perc_new_val;
-                do {
-                    printf("New 12th Percentage (0-100, current: %s): ", original_s.percent);
-                    fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
-                    if (strlen(buffer) == 0) { perc_new_val = strtof(s.percent, NULL); break; } // Keep current
-                    if (isValidPercentage(buffer, &perc_new_val)) { strcpy(s.percent, buffer); break; }
-                    printf("Invalid percentage. Please enter a number between 0-100, or leave blank.\n");
-                } while (1);
-
-
-                GET_MODIFIED_INPUT("New Domicile (current: %s): ", original_s.domicile, s.domicile, sizeof(s.domicile));
-
-                // Course (with validation for fee calculation)
-                do {
-                    printf("New Course (BTech, BCA, BSc, current: %s): ", original_s.course);
-                    fgets(buffer, sizeof(buffer), stdin); buffer[strcspn(buffer, "\n")] = 0;
-                    if (strlen(buffer) == 0) { s.totalFee = getTotalFee(s.course); break; } // Keep current
-                    s.totalFee = getTotalFee(buffer);
-                    if (s.totalFee != 0.0f) { strcpy(s.course, buffer); break;}
-                    printf("Invalid course. Please enter BTech, BCA, or BSc, or leave blank.\n");
-                } while (1);
-
-                GET_MODIFIED_INPUT("New DOB (DD/MM/YYYY, current: %s): ", original_s.dob, s.dob, sizeof(s.dob));
-
-                // Recalculate fees with potentially new data
-                s.discount = s.totalFee * (getPercentDiscount(perc_new_val) / 100.0f);
-                s.domicileDiscount = (s.totalFee - s.discount) * (getDomicileDiscount(s.domicile) / 100.0f);
-                s.finalFee = s.totalFee - s.discount - s.domicileDiscount;
-
-                // Write the modified record to the temporary file
-                fprintf(fp_write, "%s|%s|%s|%s|%s|%s|%s|%s|%.2f|%.2f|%.2f|%.2f\n",
-                        s.name, s.mother, s.father, s.mobile, s.percent, s.domicile, s.course, s.dob,
-                        s.totalFee, s.discount, s.domicileDiscount, s.finalFee);
-                printf("\nRecord updated.\n");
+// Name and place pools for the synthetic rosters of the operation benchmark.
+static const char* benchFirstNames[] = {
+    "Aarav", "Vivaan", "Aditya", "Vihaan", "Arjun", "Sai", "Reyansh", "Ayaan", "Krishna", "Ishaan",
+    "Shaurya", "Atharv", "Advik", "Pranav", "Rohan", "Kabir", "Ansh", "Dhruv", "Kartik", "Rahul",
+    "Amit", "Nikhil", "Harsh", "Manish", "Deepak", "Sandeep", "Varun", "Yash", "Tushar", "Gaurav",
+    "Alok", "Mohit", "Aadhya", "Ananya", "Diya", "Pari", "Saanvi", "Myra", "Anika", "Navya",
+    "Aarohi", "Kiara", "Ira", "Riya", "Sara", "Avni", "Kavya", "Meera", "Isha", "Pooja",
+    "Neha", "Priya", "Shreya", "Tanvi", "Sneha", "Nisha", "Komal", "Divya", "Simran", "Anjali",
+    "Khushi", "Jiya", "Tara", "Mahi"
+};
+static const char* benchMotherNames[] = {
+    "Sunita", "Anita", "Kavita", "Rekha", "Geeta", "Seema", "Poonam", "Meena", "Asha", "Usha",
+    "Nirmala", "Savita", "Suman", "Kiran", "Lata", "Manju"
+};
+static const char* benchFatherNames[] = {
+    "Rajesh", "Suresh", "Ramesh", "Mahesh", "Dinesh", "Mukesh", "Rakesh", "Anil", "Sunil", "Vijay",
+    "Sanjay", "Ajay", "Manoj", "Ashok", "Pradeep", "Vinod"
+};
+static const char* benchLastNames[] = {
+    "Sharma", "Verma", "Gupta", "Singh", "Kumar", "Joshi", "Negi", "Rawat", "Bisht", "Pant",
+    "Bhatt", "Pandey", "Mishra", "Tiwari", "Chauhan", "Thakur", "Yadav", "Agarwal", "Bansal", "Mehta",
+    "Shah", "Patel", "Reddy", "Nair", "Iyer", "Rao", "Das", "Bose", "Sen", "Ghosh",
+    "Chopra", "Kapoor", "Malhotra", "Saxena", "Srivastava", "Dubey", "Tripathi", "Shukla", "Dwivedi", "Upadhyay",
+    "Rana", "Chand", "Kandpal", "Bhandari", "Dhami", "Butola", "Semwal", "Uniyal", "Nautiyal", "Dobhal",
+    "Kothari", "Jain", "Goel", "Mittal", "Arora", "Khanna", "Sethi", "Bhatia", "Ahuja", "Grover",
+    "Mathur", "Bhargava", "Rastogi", "Kohli"
+};
+static const struct { const char* name; int weight; } benchDomiciles[] = { // Weights in percent
+    { "Uttarakhand", 40 }, { "Uttar Pradesh", 20 }, { "Delhi", 15 }, { "Haryana", 10 },
+    { "Himachal Pradesh", 5 }, { "Punjab", 5 }, { "Bihar", 5 }
+};
 
-            } else {
-                // If not the record to modify, write the original line (with its newline) to the temporary file
-                fprintf(fp_write, "%s", original_line_for_writing);
-            }
-        } else {
-            // If line cannot be parsed (e.g., corrupted data), write it as is to preserve file integrity as much as possible
-            fprintf(fp_write, "%s", original_line_for_writing);
-        }
+#define BENCH_POOL(pool, r) pool[(r) % (sizeof(pool) / sizeof(pool[0]))]
+
+// Next value of the benchmark's pseudo-random sequence (deterministic for a given seed).
+static unsigned int benchRandom(unsigned int* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+// Fills in synthetic student number 'i'. Names repeat as in a real roster (first name, middle initial
+// and surname), domiciles and courses are skewed, percentages cluster around 72 and mobiles are unique.
+static void benchStudent(long i, unsigned int* seed, StudentForm* s) {
+    const char* last = BENCH_POOL(benchLastNames, benchRandom(seed));
+    snprintf(s->name, sizeof(s->name), "%s %c %s", BENCH_POOL(benchFirstNames, benchRandom(seed)),
+             'A' + benchRandom(seed) % 26, last);
+    snprintf(s->mother, sizeof(s->mother), "%s %s", BENCH_POOL(benchMotherNames, benchRandom(seed)), last);
+    snprintf(s->father, sizeof(s->father), "%s %s", BENCH_POOL(benchFatherNames, benchRandom(seed)), last);
+    // 3^18 is coprime with 10^9, so the multiplication permutes the 9-digit numbers: no two students share a mobile
+    snprintf(s->mobile, sizeof(s->mobile), "%u%09llu", 6 + (unsigned int)(i % 4),
+             (unsigned long long)i * 387420489ull % 1000000000ull);
+
+    int tenths = 0; // Sum of four uniform draws: roughly normal, mean 72, clipped to 33.0 .. 99.9
+    for (int d = 0; d < 4; d++) tenths += 55 + (int)(benchRandom(seed) % 250);
+    tenths = tenths < 330 ? 330 : tenths > 999 ? 999 : tenths;
+    snprintf(s->percent, sizeof(s->percent), "%d.%d", tenths / 10, tenths % 10);
+
+    int pick = (int)(benchRandom(seed) % 100), d = 0;
+    while (pick >= benchDomiciles[d].weight) pick -= benchDomiciles[d++].weight;
+    setStudentField(s, FIELD_DOMICILE, benchDomiciles[d].name);
+
+    int c = 0; // Course i is chosen with weight 1 / (i + 1)
+    if (feePolicy.courses.count > 1) {
+        float total = 0.0f, r;
+        for (int k = 0; k < feePolicy.courses.count; k++) total += 1.0f / (k + 1);
+        r = total * (benchRandom(seed) % 10000) / 10000.0f;
+        while (c < feePolicy.courses.count - 1 && (r -= 1.0f / (c + 1)) >= 0.0f) c++;
     }
+    setStudentField(s, FIELD_COURSE, feePolicy.courses.names[c]);
 
-    fclose(fp_read);
-    fclose(fp_write);
+    snprintf(s->dob, sizeof(s->dob), "%02u/%02u/%u", 1 + benchRandom(seed) % 28, 1 + benchRandom(seed) % 12,
+             2003 + benchRandom(seed) % 5);
+    computeFees(s, tenths / 10.0f);
+    s->id = (unsigned int)i + 1;
+}
 
-    if (found) {
-        if (remove(FILENAME) != 0) { // Delete the original file
-            printf("\nError: Could not delete the original file '%s'.\n", FILENAME);
-            perror("Reason");
-            // Attempt to remove temp file to clean up
-            remove(TEMP_FILENAME);
-        } else {
-            if (rename(TEMP_FILENAME, FILENAME) == 0) { // Rename the temporary file to the original filename
-                printf("\nStudent record modified successfully!\n");
-            } else {
-                printf("\nError: Could not rename temporary file '%s' to '%s'.\n", TEMP_FILENAME, FILENAME);
-                perror("Reason");
-                printf("The modified data might be in '%s'. Manual intervention may be needed.\n", TEMP_FILENAME);
-            }
-        }
-    } else {
-        remove(TEMP_FILENAME); // Delete the temporary file if no record was found/modified
-        printf("\nNo student found with the name '%s' to modify.\n", searchName);
+// Writes a synthetic roster of 'rows' students to FILENAME. Returns 1 on success.
+static int benchGenerate(long rows) {
+    FILE* fp = fopen(FILENAME, "w");
+    if (!fp) {
+        printf("Error: Could not create '%s'.\n", FILENAME);
+        perror("Reason");
+        return 0;
     }
-     
+    setvbuf(fp, NULL, _IOFBF, IMPORT_WRITE_BUFFER);
+    unsigned int seed = 20240601u; // Same seed for every size, so a smaller roster is a prefix of a larger one
+    StudentForm s;
+    for (long i = 0; i < rows; i++) {
+        benchStudent(i, &seed, &s);
+        writeStudentLine(fp, &s);
+    }
+    if (fclose(fp) != 0) {
+        printf("Error: Could not write '%s'.\n", FILENAME);
+        perror("Reason");
+        return 0;
+    }
+    return 1;
 }
 
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
 
-// Deletes a student record from the file.
-// Searches by student name (case-insensitive).
-// Writes all records except the one to be deleted to a temporary file,
-// then replaces the original file with the temporary file.
-void deleteStudent() {
-    clearScreen();
-    printf("========================\n");
-    printf(" DELETE STUDENT RECORD\n");
-    printf("========================\n\n");
+// Prints one result line: latency percentiles of the 'n' timed operations, their rate,
+// the rate of records they produced or stored, and the peak resident set size so far.
+static void benchReport(long rows, const char* op, double* seconds, int n, long records) {
+    struct rusage usage;
+    double total = 0.0;
+    qsort(seconds, (size_t)n, sizeof(double), compareDoubles);
+    for (int i = 0; i < n; i++) total += seconds[i];
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%-10ld %-14s %8d %12.1f %12.1f %14.1f %14.1f %12ld\n", rows, op, n,
+           seconds[n / 2] * 1e6, seconds[(n * 99) / 100] * 1e6, n / total, records / total, usage.ru_maxrss);
+    fflush(stdout);
+}
 
-    FILE *fp_read = fopen(FILENAME, "r");
-    if (!fp_read) {
-        printf("No student records found to delete. File '%s' is missing or empty.\n", FILENAME);
-         
-        return;
+// Runs one batch command line through runBatchCommand, answers discarded. Returns the elapsed seconds.
+// A write is timed until it is synced to disk, the point at which the batch and server modes answer it.
+static double benchCommand(FILE* sink, char* line) {
+    char* args[BATCH_MAX_ARGS];
+    int argc = 0;
+    for (char* p = line; p && argc < BATCH_MAX_ARGS; ) {
+        args[argc++] = p;
+        if ((p = strchr(p, '|')) != NULL) *p++ = 0;
     }
+    double start = nowSeconds();
+    runBatchCommand(sink, argc, args);
+    if (batchCommandWrites(args[0])) journalSync();
+    return nowSeconds() - start;
+}
 
-    FILE *fp_write = fopen(TEMP_FILENAME, "w"); // Open temporary file for writing
-    if (!fp_write) {
-        printf("Error: Could not create temporary file ('%s') for deletion.\n", TEMP_FILENAME);
-        perror("Reason");
-        fclose(fp_read);
-         
-        return;
+// Number of records a search returns (counted outside the timed command).
+static long benchCountMatches(int field, char* term) {
+    long n = 0;
+    if (field == FIELD_MOBILE) {
+        for (int i = storeNextByMobile(term, -1); i != -1; i = storeNextByMobile(term, i)) n++;
+        return n;
     }
+    int* matches;
+    str_to_lower(term);
+    n = storeFindContaining(field, term, &matches);
+    if (n >= 0) free(matches);
+    return n;
+}
 
-    char deleteName[NAME_LEN];
-    printf("Enter the FULL NAME of the student to delete: ");
-    fgets(deleteName, sizeof(deleteName), stdin);
-    deleteName[strcspn(deleteName, "\n")] = 0; // Remove newline
+// Index of a live record chosen pseudo-randomly, or -1 if there is none.
+static int benchPickRecord(unsigned int* seed) {
+    if (store.liveCount == 0) return -1;
+    int idx = (int)(benchRandom(seed) % (unsigned int)store.count);
+    while (!store.alive[idx]) idx = (idx + 1) % store.count;
+    return idx;
+}
 
-    // Convert delete name to lowercase for case-insensitive comparison
-    char lowerDeleteName[NAME_LEN];
-    strncpy(lowerDeleteName, deleteName, sizeof(lowerDeleteName) - 1);
-    lowerDeleteName[sizeof(lowerDeleteName) - 1] = '\0';
-    str_to_lower(lowerDeleteName);
+// Operation benchmark: for each roster size, generates a deterministic synthetic FILENAME in BENCH_DIR, then
+// times loading it and each admin operation through the batch command path (display, export, searches, modify, delete).
+// Prints one line per operation in a fixed format, so runs of two versions can be diffed.
+void benchOperations(const long* sizes, int sizeCount) {
+    FILE* sink = fopen("/dev/null", "w"); // Operations format their answers as usual; the text is discarded
+    if (!sink || (mkdir(BENCH_DIR, 0755) != 0 && access(BENCH_DIR, F_OK) != 0) || chdir(BENCH_DIR) != 0) {
+        printf("Error: Could not prepare the benchmark directory '%s'.\n", BENCH_DIR);
+        perror("Reason");
+        if (sink) fclose(sink);
+        return;
+    }
+    double* seconds = malloc(BENCH_QUERIES * sizeof(double));
+    if (!seconds) {
+        printf("Error: Not enough memory for the benchmark.\n");
+        fclose(sink);
+        return;
+    }
+    printf("# bench-ops v1, data in '%s'. rows_per_sec counts records loaded, listed, returned or changed.\n", BENCH_DIR);
+    printf("%-10s %-14s %8s %12s %12s %14s %14s %12s\n",
+           "rows", "operation", "ops", "p50_us", "p99_us", "ops_per_sec", "rows_per_sec", "peak_rss_kb");
 
-    int found = 0;
-    StudentForm s;
     char line[MAX_LINE_LEN];
+    for (int z = 0; z < sizeCount; z++) {
+        long rows = sizes[z];
+        unsigned int seed = 777u;
+        freeStudentStore();
+        remove(LOG_FILENAME);
+        remove(BIN_FILENAME); // Text storage, the default
+        remove(SNAPSHOT_FILENAME);
+        double start = nowSeconds();
+        if (!benchGenerate(rows)) break;
+        seconds[0] = nowSeconds() - start;
+        benchReport(rows, "generate", seconds, 1, rows);
 
-    printf("\nProcessing records...\n");
+        start = nowSeconds();
+        if (!loadStudentStore()) break;
+        seconds[0] = nowSeconds() - start;
+        benchReport(rows, "load", seconds, 1, store.liveCount);
 
-    while (fgets(line, sizeof(line), fp_read) != NULL) {
-        char original_line_for_writing[MAX_LINE_LEN];
-        strcpy(original_line_for_writing, line);
+        start = nowSeconds();
+        if (!saveSnapshot()) break;
+        seconds[0] = nowSeconds() - start;
+        benchReport(rows, "snapshot_save", seconds, 1, store.liveCount);
+        freeStudentStore(); // Load again, from the snapshot this time
+        start = nowSeconds();
+        if (!loadStudentStore()) break;
+        seconds[0] = nowSeconds() - start;
+        benchReport(rows, "load_snapshot", seconds, 1, store.liveCount);
 
-        char parse_line[MAX_LINE_LEN];
-        strcpy(parse_line, line);
-        parse_line[strcspn(parse_line, "\n")] = 0; // Remove newline for parsing
+        for (int r = 0; r < BENCH_DISPLAY_REPS; r++) {
+            strcpy(line, "display");
+            seconds[r] = benchCommand(sink, line);
+        }
+        benchReport(rows, "display", seconds, BENCH_DISPLAY_REPS, (long)BENCH_DISPLAY_REPS * store.liveCount);
 
-        if (parseStudentLine(parse_line, &s)) {
-            char lowerStudentName[NAME_LEN];
-            strncpy(lowerStudentName, s.name, sizeof(lowerStudentName) - 1);
-            lowerStudentName[sizeof(lowerStudentName) - 1] = '\0';
-            str_to_lower(lowerStudentName);
+        for (int f = EXPORT_CSV; f <= EXPORT_JSON; f++) { // To a file, so rows_per_sec includes the writes
+            snprintf(line, sizeof(line), "export|%s|export.%s", exportFormatNames[f], exportFormatNames[f]);
+            seconds[0] = benchCommand(sink, line);
+            benchReport(rows, f == EXPORT_CSV ? "export_csv" : "export_json", seconds, 1, store.liveCount);
+        }
 
-            if (strcmp(lowerDeleteName, lowerStudentName) == 0) { // Found the student to delete
-                printf("Found student '%s'. Deleting record...\n", s.name);
-                found = 1;
-                // Do NOT write this record to the temporary file, effectively deleting it
-            } else {
-                // Write other records (those not being deleted) to the temporary file
-                fprintf(fp_write, "%s", original_line_for_writing); // Write with original newline
+        static const char* searches[] = { "search_name", "search_surname", "search_mobile" };
+        for (int q = 0; q < 3; q++) {
+            long returned = 0;
+            for (int i = 0; i < BENCH_QUERIES; i++) {
+                StudentForm picked;
+                const StudentForm* s = storeRecord(benchPickRecord(&seed), &picked);
+                char term[NAME_LEN];
+                strcpy(term, q == 2 ? s->mobile : q == 1 ? strrchr(s->name, ' ') + 1 : s->name);
+                snprintf(line, sizeof(line), "search|%s|%s", q == 2 ? "mobile" : "name", term);
+                seconds[i] = benchCommand(sink, line);
+                returned += benchCountMatches(q == 2 ? FIELD_MOBILE : FIELD_NAME, term);
             }
-        } else {
-            // If line cannot be parsed, write it as is to preserve file integrity
-            fprintf(fp_write, "%s", original_line_for_writing);
+            benchReport(rows, searches[q], seconds, BENCH_QUERIES, returned);
         }
-    }
 
-    fclose(fp_read);
-    fclose(fp_write);
+        // Duplicate check of a registration: the first one builds the Bloom filter, the rest use it.
+        // Every other applicant copies a registered record (a duplicate), the others are new.
+        int field;
+        StudentForm applicant;
+        storeRecord(benchPickRecord(&seed), &applicant);
+        start = nowSeconds();
+        storeFindDuplicate(&applicant, &field);
+        seconds[0] = nowSeconds() - start;
+        benchReport(rows, "dup_build", seconds, 1, store.liveCount);
+        long duplicates = 0;
+        for (int i = 0; i < BENCH_QUERIES; i++) {
+            storeRecord(benchPickRecord(&seed), &applicant);
+            if (i % 2) snprintf(applicant.mobile, sizeof(applicant.mobile), "5%09u", benchRandom(&seed) % 1000000000u);
+            if (i % 2) snprintf(applicant.dob, sizeof(applicant.dob), "31/12/1899");
+            start = nowSeconds();
+            duplicates += storeFindDuplicate(&applicant, &field) != -1;
+            seconds[i] = nowSeconds() - start;
+        }
+        benchReport(rows, "dup_check", seconds, BENCH_QUERIES, duplicates);
 
-    if (found) {
-        if (remove(FILENAME) != 0) { // Delete the original file
-             printf("\nError: Could not delete the original file '%s'.\n", FILENAME);
-            perror("Reason");
-            remove(TEMP_FILENAME); // Attempt to clean up
-        } else {
-             if (rename(TEMP_FILENAME, FILENAME) == 0) { // Rename the temporary file
-                printf("\nStudent record deleted successfully!\n");
+        // Fuzzy name lookup of a name with one typo: the first one builds the BK-tree, the rest use it
+        for (int i = 0; i <= BENCH_QUERIES; i++) {
+            StudentForm picked;
+            storeRecord(benchPickRecord(&seed), &picked);
+            size_t len = strlen(picked.name);
+            picked.name[benchRandom(&seed) % len] = 'q';
+            snprintf(line, sizeof(line), "suggest|%s", picked.name);
+            if (i == 0) {
+                seconds[0] = benchCommand(sink, line);
+                benchReport(rows, "suggest_build", seconds, 1, store.liveCount);
             } else {
-                printf("\nError: Could not rename temporary file '%s' to '%s'.\n", TEMP_FILENAME, FILENAME);
-                perror("Reason");
-                printf("The data excluding the deleted record might be in '%s'. Manual intervention may be needed.\n", TEMP_FILENAME);
+                seconds[i - 1] = benchCommand(sink, line);
             }
         }
-    } else {
-        remove(TEMP_FILENAME); // Delete temp file if no record was found/deleted
-        printf("\nNo student found with the name '%s' to delete.\n", deleteName);
+        benchReport(rows, "suggest", seconds, BENCH_QUERIES, BENCH_QUERIES);
+
+        // Merit lists: top-K with a bounded heap (no order is kept yet), then the first sorted listing,
+        // which sorts the roster once, and pages of the kept order
+        int topCount = store.liveCount < 100 ? store.liveCount : 100;
+        for (int i = 0; i < BENCH_QUERIES; i++) {
+            strcpy(line, "top|percent|100");
+            seconds[i] = benchCommand(sink, line);
+        }
+        benchReport(rows, "top_k", seconds, BENCH_QUERIES, (long)BENCH_QUERIES * topCount);
+        strcpy(line, "sorted|percent|25|0");
+        seconds[0] = benchCommand(sink, line);
+        benchReport(rows, "sort_build", seconds, 1, store.liveCount);
+        for (int i = 0; i < BENCH_QUERIES; i++) {
+            snprintf(line, sizeof(line), "sorted|percent|25|%u", benchRandom(&seed) % (unsigned int)(store.liveCount > 0 ? store.liveCount : 1));
+            seconds[i] = benchCommand(sink, line);
+        }
+        benchReport(rows, "sorted_page", seconds, BENCH_QUERIES, (long)BENCH_QUERIES * 25);
+
+        // Dates of birth: the first age histogram sorts the dob view, then histograms and one-month date
+        // range queries are binary searches of it
+        strcpy(line, "ages");
+        seconds[0] = benchCommand(sink, line);
+        benchReport(rows, "dob_build", seconds, 1, store.liveCount);
+        for (int i = 0; i < BENCH_QUERIES; i++) {
+            strcpy(line, "ages|5");
+            seconds[i] = benchCommand(sink, line);
+        }
+        benchReport(rows, "ages", seconds, BENCH_QUERIES, BENCH_QUERIES);
+        long born = 0;
+        for (int i = 0; i < BENCH_QUERIES; i++) {
+            unsigned int month = 1 + benchRandom(&seed) % 12, year = 2003 + benchRandom(&seed) % 5;
+            snprintf(line, sizeof(line), "query|dob >= 01/%02u/%u and dob <= 28/%02u/%u", month, year, month, year);
+            born += storeFindBorn(packDate((int)year, (int)month, 1), packDate((int)year, (int)month, 28), NULL);
+            seconds[i] = benchCommand(sink, line);
+        }
+        benchReport(rows, "query_dob", seconds, BENCH_QUERIES, born);
+
+        long changed = 0;
+        for (int i = 0; i < BENCH_WRITES; i++) {
+            StudentForm picked;
+            const StudentForm* s = storeRecord(benchPickRecord(&seed), &picked);
+            snprintf(line, sizeof(line), "modify|%s|percent=%u", s->name, 40 + benchRandom(&seed) % 60);
+            long matches = 0;
+            for (int k = storeNextByName(s->name, -1); k != -1; k = storeNextByName(s->name, k)) matches++;
+            seconds[i] = benchCommand(sink, line);
+            changed += matches;
+        }
+        benchReport(rows, "modify", seconds, BENCH_WRITES, changed);
+
+        for (int i = 0; i < BENCH_WRITES; i++) {
+            snprintf(line, sizeof(line), "modify|#%u|percent=%u", store.records[benchPickRecord(&seed)].id,
+                     40 + benchRandom(&seed) % 60);
+            seconds[i] = benchCommand(sink, line);
+        }
+        benchReport(rows, "modify_id", seconds, BENCH_WRITES, BENCH_WRITES);
+
+        changed = 0;
+        for (int i = 0; i < BENCH_WRITES && store.liveCount > 0; i++) {
+            StudentForm picked;
+            const StudentForm* s = storeRecord(benchPickRecord(&seed), &picked);
+            snprintf(line, sizeof(line), "delete|%s", s->name);
+            long before = store.liveCount;
+            seconds[i] = benchCommand(sink, line);
+            changed += before - store.liveCount;
+        }
+        benchReport(rows, "delete", seconds, BENCH_WRITES, changed);
+
+        changed = 0;
+        for (int i = 0; i < BENCH_WRITES && store.liveCount > 0; i++) {
+            snprintf(line, sizeof(line), "delete|#%u", store.records[benchPickRecord(&seed)].id);
+            long before = store.liveCount;
+            seconds[i] = benchCommand(sink, line);
+            changed += before - store.liveCount;
+        }
+        benchReport(rows, "delete_id", seconds, BENCH_WRITES, changed);
+
+        // The next sorted listing merges the records modified and deleted above into the kept order
+        strcpy(line, "sorted|percent|25|0");
+        seconds[0] = benchCommand(sink, line);
+        benchReport(rows, "sort_merge", seconds, 1, store.liveCount);
     }
-     
+    freeStudentStore();
+    free(seconds);
+    fclose(sink);
 }